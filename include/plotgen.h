@@ -7,6 +7,19 @@
 #include <functional>
 #include <algorithm>
 #include <iostream>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <deque>
+#include <future>
+#include <exception>
+#include <tuple>
+#include <cstring>
+#include <cstdint>
+#include <fstream>
 
 // Include simple_svg library for better SVG export
 #include "simple_svg_1.0.0.hpp"
@@ -40,6 +53,7 @@ public:
         std::string legend;
         std::string symbol_type; // "none", "circle", "square", "triangle", "diamond", "star"
         double symbol_size;      // Symbol size in pixels
+        std::string colormap = "viridis"; // Color scale of density plots, see colormap_lut()
 
         Style(
             sf::Color color_ = sf::Color::Blue,
@@ -51,6 +65,213 @@ public:
         );
     };
 
+    // Multi-level summary of a curve with sorted x values, used to draw long series with
+    // O(pixels) work at any zoom level
+    struct LodPyramid {
+        struct Bucket {
+            double first, last, ymin, ymax; // y values of the first, last, lowest and highest samples
+            size_t imin, imax;              // Sample indices of the lowest and highest samples
+        };
+        static const unsigned int BASE_SHIFT = 4;  // Level 0 buckets hold 16 samples
+        std::vector<std::vector<Bucket>> levels;   // Buckets of levels[k] hold 2^(BASE_SHIFT + k) samples
+        bool unsorted = false;                     // x is not sorted: no pyramid, append() does not try again
+    };
+
+    class LogTail;
+
+    // Live series: producers push samples from any thread through a lock-free bounded queue (never blocking),
+    // the renderer drains it into a ring buffer holding the last samples
+    class Stream {
+    public:
+        Stream(size_t capacity, double window);
+
+        // Queue a sample; returns false (and counts it as dropped) if the queue is full
+        bool push(double x, double y);
+        // Queue several samples, returns the number accepted
+        size_t push(const double* x, const double* y, size_t count);
+
+        size_t capacity() const { return ring_capacity; }
+        size_t dropped() const { return dropped_count.load(std::memory_order_relaxed); }
+
+    private:
+        friend class PlotGen;
+        friend class LogTail;
+
+        // Queue a sample without counting it as dropped when the queue is full
+        bool enqueue(double x, double y);
+
+        // Bounded multi-producer queue (D. Vyukov), with a single consumer
+        struct Cell {
+            std::atomic<size_t> sequence;
+            double x, y;
+        };
+        std::unique_ptr<Cell[]> cells;
+        size_t mask;
+        alignas(64) std::atomic<size_t> enqueue_pos;
+        alignas(64) size_t dequeue_pos = 0;
+        std::atomic<size_t> dropped_count;
+
+        // Consumer side: mirrored ring (each sample is stored at i and i + capacity, so the
+        // window [head, head + size) is always contiguous) and monotonic deques for the sliding y range
+        size_t ring_capacity;
+        double window;
+        std::vector<double> ring_x, ring_y;
+        size_t head = 0, size = 0;
+        size_t total = 0; // Samples received since the creation
+        std::deque<std::pair<size_t, double>> min_deque, max_deque;
+
+        // Move the queued samples into the ring, returns false if there were none
+        bool drain();
+        const double* window_x() const { return ring_x.data() + head; }
+        const double* window_y() const { return ring_y.data() + head; }
+    };
+
+    // Columns of a CSV file read by load_csv(), to be moved into plot() or scatter()
+    struct CsvData {
+        std::vector<std::string> names;            // From the header line (empty without header)
+        std::vector<std::vector<double>> columns;  // NaN for empty or invalid fields
+        size_t rows = 0;
+        size_t bytes = 0;
+        double seconds = 0;                        // Parse time
+        double gb_per_second = 0;
+
+        std::vector<double>& column(const std::string& name);
+    };
+
+    // Column of numbers read in place from a memory-mapped file: .npy (float32/float64, 1-D or 2-D)
+    // or raw little-endian values. Curves of plot_mapped() share it, so the file stays mapped while
+    // a figure uses it.
+    class MappedArray {
+    public:
+        static std::shared_ptr<MappedArray> open_npy(const std::string& filename, size_t column = 0);
+        // Raw file of `columns` interleaved values per row ("float32" or "float64"), after `offset` bytes
+        static std::shared_ptr<MappedArray> open_raw(const std::string& filename, const std::string& dtype = "float64",
+                                                     size_t offset = 0, size_t columns = 1, size_t column = 0);
+
+        size_t size() const { return count; }
+        double operator[](size_t i) const
+        {
+            const char* p = base + i * stride;
+            if (is_float32)
+            {
+                float value;
+                std::memcpy(&value, p, sizeof(value));
+                return value;
+            }
+            double value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+    private:
+        std::shared_ptr<const void> mapping; // Unmaps the file with the last reference
+        const char* base = nullptr;
+        size_t count = 0, stride = sizeof(double);
+        bool is_float32 = false;
+    };
+
+    // Samples read chunk by chunk, for the out-of-core plot_source(), hist_source() and
+    // scatter_density_source(). next() may be called from a worker thread, never concurrently.
+    class DataSource {
+    public:
+        virtual ~DataSource() = default;
+        // Go back to the first sample
+        virtual void rewind() = 0;
+        // Replace x and y with the next samples (at most max_count); x may be left empty to number
+        // the samples. Returns false when there are no more samples.
+        virtual bool next(std::vector<double>& x, std::vector<double>& y, size_t max_count) = 0;
+    };
+
+    // Two columns of a CSV file, read through a fixed-size buffer (x_column -1: sample index)
+    class CsvSource : public DataSource {
+    public:
+        CsvSource(const std::string& filename, int x_column, int y_column, char delimiter = ',', bool header = true);
+        void rewind() override;
+        bool next(std::vector<double>& x, std::vector<double>& y, size_t max_count) override;
+
+    private:
+        std::string filename;
+        int x_column, y_column;
+        char delimiter;
+        bool header;
+        std::ifstream file;
+        std::vector<char> buffer;
+        std::string partial_line;
+    };
+
+    // Chunks of mapped arrays (x may be null)
+    class MappedSource : public DataSource {
+    public:
+        MappedSource(std::shared_ptr<MappedArray> x, std::shared_ptr<MappedArray> y);
+        void rewind() override { position = 0; }
+        bool next(std::vector<double>& x, std::vector<double>& y, size_t max_count) override;
+
+    private:
+        std::shared_ptr<MappedArray> x_array, y_array;
+        size_t position = 0;
+    };
+
+    // Layout of the lines of a file followed by tail()
+    struct LogColumns {
+        int x = -1;                       // Column of the x values (from 0), -1 to number the parsed lines
+        std::vector<int> y;               // Columns plotted, one stream each
+        std::string delimiters = " \t,;"; // Field separators
+        std::string prefix;               // If set, only the lines starting with it are parsed (after the prefix)
+    };
+
+    // Follows a growing file from a background thread (inotify on Linux, polling elsewhere) and pushes
+    // the values of each new complete line into streams. Only the appended bytes are read.
+    class LogTail {
+    public:
+        LogTail(const std::string& filename, const LogColumns& columns, const std::vector<std::shared_ptr<Stream>>& streams);
+        ~LogTail();
+
+        void stop();
+        size_t lines() const { return parsed_lines.load(std::memory_order_relaxed); }
+
+    private:
+        void run();
+        void read_new_data();
+        void parse_line(const char* begin, const char* end);
+
+        std::string filename;
+        LogColumns columns;
+        std::vector<std::shared_ptr<Stream>> streams;
+        std::atomic<bool> running;
+        std::atomic<size_t> parsed_lines;
+        std::thread worker;
+
+        // Reader state, used by the worker thread only
+        unsigned long long offset = 0, inode = 0;
+        std::string partial_line;
+        std::vector<double> fields;
+    };
+
+    // One output of render_batch(): a configured instance, or a function that configures
+    // a new PlotGen of the given size on the worker thread
+    struct BatchJob {
+        PlotGen* plot = nullptr;
+        std::function<void(PlotGen&)> build;
+        unsigned int width = 1200, height = 900, rows = 1, cols = 1;
+        std::string filename; // .png, .jpg or .svg
+    };
+
+    // Settings of the PNG encoder, see save_png()
+    struct PngOptions {
+        int compression = 8;           // 0: stored without compression (fastest), 1 to 9: deeper match search
+        std::string filter = "auto";   // "auto" ("sub-up" for rgb, "none" for indexed), "sub-up", "adaptive", "none", "sub", "up", "average" or "paeth"
+        std::string color_type = "rgb"; // "rgb" (24 bits) or "indexed" (8-bit palette)
+        unsigned int palette_size = 256; // Maximum number of colors of "indexed", 2 to 256
+        unsigned int threads = 0;        // Threads filtering and compressing each band, 0: one per core
+    };
+
+    struct BatchResult {
+        std::string filename;
+        bool ok = false;
+        std::string error;  // Message of the exception when !ok
+        double build_ms = 0, render_ms = 0, encode_ms = 0;
+    };
+
     struct Figure {
         std::string title, xlabel, ylabel;
         double xmin = -10, xmax = 10, ymin = -10, ymax = 10;
@@ -63,23 +284,67 @@ public:
         sf::Color minor_grid_color = sf::Color(230, 230, 230); // Very light gray for minor grid
         bool is_polar = false; // Indicates if the graph is in polar coordinates
         bool equal_axes = false; // Option for axes of the same dimension
+        bool use_lod = false;       // Build LOD pyramids for the curves added by plot()
+        bool follow_streams = true; // Limits follow the data of the "STREAM" curves
+        bool log_y = false;         // Logarithmic y axis (ymin must be positive)
+        bool show_colorbar = false; // Color scale drawn in the right margin
+        std::string colorbar_map = "viridis";
+        double colorbar_min = 0, colorbar_max = 1;
+        std::string colorbar_label;
         struct Curve {
             std::vector<double> x, y;
             Style style;
             double bar_width_ratio = 0.9f; // Field to store width ratio
             std::string text_content; // For storing text to display at a position
             double head_size = 10.0;  // For storing arrow head size
+
+            // Per-pixel aggregation grid for "DENSITY" curves (row 0 is the top of the grid)
+            std::vector<double> grid;             // NaN marks empty cells
+            unsigned int grid_w = 0, grid_h = 0;
+            double grid_xmin = 0, grid_xmax = 0, grid_ymin = 0, grid_ymax = 0; // Data extent covered by the grid
+            std::string aggregation = "count";    // "count" or "mean"
+            std::string normalization = "eq_hist"; // "linear", "log" or "eq_hist"
+
+            // Per-point columns of "SCATTER" curves (empty: style.color / style.symbol_size)
+            std::vector<double> color_values, sizes;
+            double color_min = 0, color_max = 1; // Range mapped onto the colormap
+
+            LodPyramid lod; // Built for "2D" curves with sorted x when the figure uses LOD
+
+            std::shared_ptr<Stream> stream; // Data of "STREAM" curves (x and y stay empty)
+            std::shared_ptr<MappedArray> mapped_x, mapped_y; // Data of "MAPPED" curves (no mapped_x: sample index)
         };
         std::vector<Curve> curves;
         std::vector<std::string> curve_types;
     };
 
-    // Constructor
-    PlotGen(unsigned int width = 1200, unsigned int height = 900, unsigned int rows = 1, unsigned int cols = 1);
+    // Constructor. The render texture is created on the first raster save or show(); with
+    // vector_only, raster output is disabled and no OpenGL resource is ever created (save_svg only)
+    PlotGen(unsigned int width = 1200, unsigned int height = 900, unsigned int rows = 1, unsigned int cols = 1,
+            bool vector_only = false);
+
+    // Waits for the pending save_async() calls and for the window opened by show_async() to be closed:
+    // it blocks until the user closes the window, unless close() was called
+    ~PlotGen();
+
+    // Font used for raster rendering. Fonts are loaded once and shared by all instances;
+    // by default the first found of fonts/arial.ttf, build/arial.ttf, Liberation Sans and DejaVu Sans.
+    void set_font_path(const std::string& path);
+    static void set_default_font_path(const std::string& path);
+
+    // Images larger than the render texture (the GPU maximum texture size, or size when not 0) are
+    // rendered tile by tile when saved; PNG output is then streamed one row of tiles at a time
+    void set_tile_size(unsigned int size);
 
     // Add a figure at position (row, col)
     Figure& subplot(unsigned int row, unsigned int col);
 
+    // Remove all curves and restore the default settings of the figures, keeping the render
+    // texture, the fonts and the memory of the curves for the next plots (e.g. one image per frame)
+    void clear();
+    // Same, with a new grid of subplots and image size; the render texture is recreated only if the size changes
+    void reset(unsigned int rows, unsigned int cols, unsigned int width, unsigned int height);
+
     // Figure configuration methods
     void set_title(Figure& fig, const std::string& title);
     void set_xlabel(Figure& fig, const std::string& label);
@@ -91,13 +356,81 @@ public:
     void set_grid_color(Figure& fig, sf::Color major_color, sf::Color minor_color);
     void set_equal_axes(Figure& fig, bool equal = true);
     void set_legend_position(Figure& fig, const std::string& position);
+    // Logarithmic y axis, refused for figures with histograms or density plots
+    void set_log_y(Figure& fig, bool log = true);
+
+    // Colorbar showing the colormap for values between vmin and vmax
+    void colorbar(Figure& fig, const std::string& colormap, double vmin, double vmax, const std::string& label = "");
 
-    // 2D curve plotting
+    // 2D curve plotting. The rvalue overload takes the vectors without copying them.
     void plot(Figure& fig, const std::vector<double>& x, const std::vector<double>& y, const Style& style = Style());
+    void plot(Figure& fig, std::vector<double>&& x, std::vector<double>&& y, const Style& style = Style());
+
+    // 2D curve read in place from mapped files (x may be null to use the sample index, otherwise its
+    // values must increase). Drawing reads at most 512 samples per pixel column, so the extrema shown
+    // are approximate until the zoom leaves fewer samples than that per column.
+    void plot_mapped(Figure& fig, std::shared_ptr<MappedArray> x, std::shared_ptr<MappedArray> y, const Style& style = Style());
+
+    // Out-of-core plots: the source is read twice, chunk by chunk with the next chunk read ahead on
+    // a worker thread, to find the bounds and then to aggregate. Memory depends on the plot area only.
+    // plot_source() keeps the first, last, lowest and highest samples of each pixel column;
+    // hist_source() bins the y values.
+    void plot_source(Figure& fig, DataSource& source, const Style& style = Style(), size_t chunk_size = 1 << 20);
+    void hist_source(Figure& fig, DataSource& source, int bins = 10, const Style& style = Style(),
+                     double bar_width_ratio = 0.9f, size_t chunk_size = 1 << 20);
+    void scatter_density_source(Figure& fig, DataSource& source, const std::string& normalization = "eq_hist",
+                                const Style& style = Style(), size_t chunk_size = 1 << 20);
+
+    // Read the numeric columns of a CSV file, memory-mapped and parsed by several threads
+    static CsvData load_csv(const std::string& filename, char delimiter = ',', bool header = true);
+
+    // Append samples to a 2D curve of a figure (x values must keep increasing), updating its LOD pyramid
+    void append(Figure& fig, size_t curve_index, const std::vector<double>& x, const std::vector<double>& y);
+
+    // Build LOD pyramids for the long curves with sorted x values of a figure, now and when they are
+    // added or appended, so that drawing reads O(pixels) buckets instead of every sample
+    void enable_lod(Figure& fig, bool enable = true);
+
+    // Live series keeping the last `capacity` samples (and, if window > 0, only those with x > newest x - window).
+    // Samples are pushed from any thread through the returned handle, and shown by the window at each frame.
+    std::shared_ptr<Stream> stream(Figure& fig, size_t capacity, const Style& style = Style(), double window = 0);
+
+    // Follow a log file, plotting the given columns of each new line as live series (see LogColumns).
+    // The file is followed as long as the returned handle is kept.
+    [[nodiscard]] std::shared_ptr<LogTail> tail(Figure& fig, const std::string& filename, const LogColumns& columns,
+                                                const std::vector<Style>& styles = {}, size_t capacity = 1000000);
 
     // Histogram
     void hist(Figure& fig, const std::vector<double>& data, int bins = 10, const Style& style = Style(), double bar_width_ratio = 0.9f);
 
+    // Scatter plot with optional per-point color values (mapped through style.colormap) and sizes in pixels.
+    // All markers are drawn in a single batch.
+    void scatter(Figure& fig, const std::vector<double>& x, const std::vector<double>& y,
+                 const std::vector<double>& color_values = {}, const std::vector<double>& sizes = {},
+                 const Style& style = Style());
+    void scatter(Figure& fig, std::vector<double>&& x, std::vector<double>&& y,
+                 const std::vector<double>& color_values = {}, const std::vector<double>& sizes = {},
+                 const Style& style = Style());
+
+    // Density scatter plot: points are aggregated per output pixel (count) and shaded,
+    // so the cost is O(N) and independent of marker size
+    void scatter_density(Figure& fig, const std::vector<double>& x, const std::vector<double>& y,
+                         const std::string& normalization = "eq_hist", const Style& style = Style());
+
+    // Density scatter plot shading the mean of a value column per output pixel
+    void scatter_density(Figure& fig, const std::vector<double>& x, const std::vector<double>& y,
+                         const std::vector<double>& values, const std::string& normalization = "eq_hist",
+                         const Style& style = Style());
+
+    // Line density plot: many series are rasterized into a per-pixel hit-count buffer and shaded as a heatmap.
+    // With normalize_series, each series adds a total weight of 1 per pixel column so steep segments don't dominate.
+    void line_density(Figure& fig, const std::vector<std::vector<double>>& x, const std::vector<std::vector<double>>& y,
+                      bool normalize_series = true, const std::string& normalization = "eq_hist", const Style& style = Style());
+
+    // Line density plot of series sharing the same x values
+    void line_density(Figure& fig, const std::vector<double>& x, const std::vector<std::vector<double>>& y,
+                      bool normalize_series = true, const std::string& normalization = "eq_hist", const Style& style = Style());
+
     // Polar plot
     void polar_plot(Figure& fig, const std::vector<double>& theta, const std::vector<double>& r, const Style& style = Style());
 
@@ -133,60 +466,250 @@ public:
     void cardinal_spline(Figure& fig, const std::vector<double>& x, const std::vector<double>& y, 
                          double tension = 0.5, const Style& style = Style(), int num_points = 100);
 
+    // Colormaps: "viridis", "magma", "cividis", "coolwarm", "grayscale", "rainbow"
+    static const unsigned int COLORMAP_SIZE = 256;
+
+    // Lookup table of a colormap: COLORMAP_SIZE RGBA entries ('viridis' for an unknown name; colorbar()
+    // and the plotting functions warn about unknown names when they are given)
+    static const sf::Uint8* colormap_lut(const std::string& name);
+
+    // Map values to RGBA pixels through a colormap (NaN values become transparent)
+    static void map_to_rgba(const std::string& colormap, const double* values, size_t count,
+                            double vmin, double vmax, sf::Uint8* rgba);
+
     // Display and render
     void show();
+
+    // Open the window on a background thread and return immediately. While it is open,
+    // figures must only be changed through update().
+    void show_async();
+
+    // Apply changes to the figures (plot, append, limits...). While the window is open they are run by
+    // the window thread between two frames, which redraws the subplots; otherwise they run immediately.
+    void update(const std::function<void()>& changes);
+
+    bool is_open() const;
+    // close() and wait_closed() rethrow the exception that ended the window thread (e.g. no font found)
+    void close();
+    void wait_closed();
     
     #ifdef HAVE_GTK_WEBKIT
     // Display using internal HTML viewer
     void show_with_viewer();
     #endif
 
-    // Save to file
-    void save(const std::string& filename);
+    // Save to file. jpg_quality (1-100) and png_compression (0-9) only apply to their format.
+    void save(const std::string& filename, int jpg_quality = 95, int png_compression = 8);
+
+    // Save to several files (.png, .jpg, .svg) from a single render, encoding the formats concurrently
+    void save_all(const std::vector<std::string>& filenames, int jpg_quality = 95, int png_compression = 8);
+
+    // Save as PNG with the parallel encoder and explicit settings
+    void save_png(const std::string& filename, const PngOptions& options);
+
+    // In-memory encoding, without a file: format is "png", "jpg" or "svg". The sink receives the
+    // encoded bytes in order, in one or more calls. The buffer overload returns the number of bytes
+    // written and throws std::length_error when the capacity is too small.
+    using ByteSink = std::function<void(const unsigned char* data, size_t size)>;
+    void encode(const std::string& format, const ByteSink& sink, int jpg_quality = 95, int png_compression = 8);
+    void encode(const std::string& format, std::ostream& out, int jpg_quality = 95, int png_compression = 8);
+    std::vector<uint8_t> encode(const std::string& format, int jpg_quality = 95, int png_compression = 8);
+    size_t encode(const std::string& format, uint8_t* buffer, size_t capacity, int jpg_quality = 95, int png_compression = 8);
+    void encode_png(const PngOptions& options, const ByteSink& sink);
+    // Encode RGBA pixels (4 bytes per pixel, rows from the top) with the same encoder; the alpha channel is dropped
+    static void write_png(const ByteSink& sink, const sf::Uint8* rgba, unsigned int width, unsigned int height,
+                          const PngOptions& options);
+
+    // Save in the background: the image (or the figures for .svg) is captured now, then encoded and
+    // written on a pool shared by all instances, so the plot can be changed for the next frame right
+    // away. Blocks while the captured images waiting in the pool exceed set_async_save_limit().
+    std::shared_future<void> save_async(const std::string& filename, int jpg_quality = 95, int png_compression = 8);
+    void wait_saves(); // Wait for the save_async() calls of this instance, also done by the destructor
+    static void set_async_save_limit(size_t max_bytes);
 
     // Export as SVG - nouvelle méthode pour l'export vectoriel
     void save_svg(const std::string& filename);
+    void save_svg(std::ostream& out);
+
+    // Render and save many jobs on a pool of worker threads (0: one per core). Each worker keeps
+    // its render texture and fonts from one job to the next. Results are in the order of the jobs.
+    static std::vector<BatchResult> render_batch(const std::vector<BatchJob>& jobs, unsigned int threads = 0);
 
 private:
-    sf::RenderWindow window;
-    sf::RenderTexture texture;
+    class PngStream; // Band by band PNG encoder, see src/plotgen.cpp
+
+    // Nearest-point search structure of the "2D", "POLAR" and "SCATTER" curves of a figure, for hover picking
+    // ("STREAM" and "MAPPED" curves are not indexed)
+    struct PickIndex {
+        struct Entry {
+            size_t curve;
+            bool sorted_x;           // Searched through the y ranges of blocks of consecutive samples
+            std::vector<size_t> kd;  // Otherwise, sample indices ordered as an implicit k-d tree
+            // Sorted x: finite y min and max of blocks of consecutive samples, y_ranges[k] blocks hold
+            // 2^(BASE_SHIFT + k) samples and the last level a single block
+            static const unsigned int BASE_SHIFT = 5;
+            std::vector<std::vector<std::pair<double, double>>> y_ranges;
+        };
+        std::vector<Entry> entries;
+    };
+
+    std::unique_ptr<sf::RenderTexture> texture; // Created by ensure_texture() on first raster use
     sf::Sprite sprite;
-    sf::Font font;
+    std::string font_path;                       // Empty: default font
+    mutable std::shared_ptr<sf::Font> font;      // Shared font of font_thread, see get_font()
+    mutable std::thread::id font_thread;
     unsigned int width, height, rows, cols;
+    bool vector_only; // No raster output, see ensure_texture()
+    unsigned int tile_size = 0; // Largest side of the render texture, 0: GPU maximum, see tiled()
+    bool tiling = false;        // A tile is being rendered, see set_view()
+    sf::IntRect tile;           // Part of the image held by the render texture while tiling
+    sf::View canvas_view;       // Last view given to set_view(), in image coordinates
     std::vector<Figure> figures;
+    std::map<std::string, sf::Texture> colorbar_textures; // Colormap gradients, created once per colormap
+
+    // Glyph quads of a string laid out at the origin, see layout_text()
+    struct TextLayout
+    {
+        unsigned int size = 0;
+        sf::VertexArray vertices;
+        sf::FloatRect bounds; // Same as sf::Text::getLocalBounds()
+    };
+    std::vector<Figure::Curve> spare_curves; // Removed by clear(), their buffers are reused by make_curve()
+    std::map<std::pair<unsigned int, std::string>, TextLayout> text_layouts; // By character size and string
+    const sf::Font* layout_font = nullptr; // Font of text_layouts: fonts are per thread, see layout_text()
+    std::map<unsigned int, sf::VertexArray> text_batch; // Text of the subplot being rendered, by character size
     #ifdef HAVE_GTK_WEBKIT
     std::shared_ptr<HTMLViewer> html_viewer;
     #endif
 
+    // Window thread of show_async() and changes waiting to be applied by the window loop
+    std::thread ui_thread;
+    std::thread::id ui_thread_id;
+    mutable std::mutex ui_mutex;
+    std::condition_variable ui_signal;
+    std::vector<std::function<void()>> ui_updates;
+    bool ui_open = false;
+    bool ui_close_requested = false;
+    bool ui_job_done = false, ui_pick_done = false; // Set by the workers of the window loop when they return
+    std::exception_ptr ui_error; // Exception that ended the window thread, rethrown by wait_closed() or close()
+
+    std::vector<std::shared_future<void>> pending_saves; // Of save_async(), waited by the destructor
+
     // Special character symbols
     std::string degree_symbol = "\u00B0"; // Degree symbol (°)
     std::string pi_symbol = "\u03C0";     // Pi symbol (π)
 
     // Rendering methods
+    const sf::Font& get_font() const;
+    void add_curve(Figure& fig, Figure::Curve&& curve);
+    Figure::Curve make_curve(const std::vector<double>& x, const std::vector<double>& y, const Style& style);
+    void ensure_texture();
     void render();
+    sf::Image read_back();
+    bool tiled() const;
+    sf::Vector2u texture_size() const;
+    sf::View image_view() const;
+    void set_view(const sf::View& view);
+    void render_tile(const sf::IntRect& rect);
+    void render_band(unsigned int y, unsigned int band_height, std::vector<sf::Uint8>& rgba);
+    void write_png_tiled(const ByteSink& sink, const PngOptions& options);
+    static void png_settings(const PngOptions& options, int& level, int& filter, bool& indexed, unsigned int& palette_size);
+    static void pack_pixels(const sf::Uint8* rgba, size_t count, const std::vector<uint8_t>* lut,
+                            const std::vector<sf::Color>* exact_palette, unsigned char* out);
+    void encode_image(const std::string& filename, int jpg_quality = 95, int png_compression = 8);
+    static bool quantize_palette(const sf::Uint8* rgba, size_t count, unsigned int max_colors,
+                                 std::vector<sf::Color>& palette, std::vector<uint8_t>& lut);
+    static void write_pixels(const std::string& format, const ByteSink& sink, const sf::Uint8* rgba,
+                             unsigned int width, unsigned int height, int jpg_quality, int png_compression);
+    static std::string file_format(const std::string& filename);
+    static void write_image_file(const std::string& filename, const sf::Uint8* rgba, unsigned int width, unsigned int height,
+                                 int jpg_quality, int png_compression);
+    void render_subplot(size_t index, const std::vector<sf::VertexArray>* geometry = nullptr);
+    void subplot_bounds(size_t index, double& left, double& top, double& w, double& h) const;
     void draw_axes(const Figure& fig, double w, double h);
     void draw_grid(const Figure& fig, double w, double h);
     void draw_polar_grid(const Figure& fig, double w, double h);
-    void draw_curve(const Figure& fig, const Figure::Curve& curve, double w, double h);
+    void draw_curve(const Figure& fig, const Figure::Curve& curve, double w, double h, const sf::VertexArray* geometry = nullptr);
+    void tessellate_curve(const Figure& fig, const Figure::Curve& curve, double w, double h, sf::VertexArray& vertices) const;
     void draw_histogram(const Figure& fig, const Figure::Curve& curve, double w, double h);
+    void draw_density(const Figure& fig, const Figure::Curve& curve, double w, double h);
+    void draw_scatter(const Figure& fig, const Figure::Curve& curve, double w, double h);
+    void append_marker(sf::VertexArray& vertices, const sf::Vector2f& position, const std::string& symbol_type, double size, const sf::Color& color);
+    void scatter_colors(const Figure::Curve& curve, std::vector<sf::Uint8>& rgba);
+    void draw_colorbar(const Figure& fig, double w, double h);
+    std::string format_tick(double value) const;
     sf::Color getColorFromHeight(double height);
     sf::Vector2f to_screen(const Figure& fig, double x, double y, double w, double h) const;
+    double y_fraction(const Figure& fig, double y) const;
+    double y_from_fraction(const Figure& fig, double t) const;
+    void require_linear_y(const Figure& fig) const;
+    void plot_area_size(const Figure& fig, unsigned int& pixels_x, unsigned int& pixels_y) const;
+    void build_lod(Figure::Curve& curve);
+    void update_lod(Figure::Curve& curve, size_t first_new_sample);
+    bool visible_samples(const Figure& fig, const Figure::Curve& curve, unsigned int pixels,
+                         std::vector<double>& out_x, std::vector<double>& out_y) const;
+    static void decimate_mapped(const MappedArray* x, const MappedArray& y, double xmin, double xmax, unsigned int pixels,
+                                std::vector<double>& out_x, std::vector<double>& out_y);
+    static void decimate_columns(const double* x, const double* y, size_t count, double xmin, double xmax, unsigned int pixels,
+                                 std::vector<double>& out_x, std::vector<double>& out_y);
+    bool drain_streams(std::vector<bool>& changed);
+    void lod_query(const Figure::Curve& curve, double xmin, double xmax, unsigned int pixels,
+                   std::vector<double>& out_x, std::vector<double>& out_y) const;
+    void build_pick_index(const Figure& fig, PickIndex& index) const;
+    bool pick(const Figure& fig, const PickIndex& index, double x, double y, double w, double h, double max_pixels,
+              size_t& curve_index, size_t& sample) const;
+    static void sorted_nearest(const std::vector<double>& x, const std::vector<double>& y, const PickIndex::Entry& entry,
+                               size_t level, size_t block, double px, double py, double sx, double sy, bool log_y,
+                               double& best_distance, size_t& best_sample);
+    static void kd_build(const std::vector<double>& x, const std::vector<double>& y, std::vector<size_t>& order,
+                         size_t lo, size_t hi, int axis);
+    static void kd_nearest(const std::vector<double>& x, const std::vector<double>& y, const std::vector<size_t>& order,
+                           size_t lo, size_t hi, int axis, double px, double py, double sx, double sy, bool log_y,
+                           double& best_distance, size_t& best_sample);
+    static void check_colormap(std::string& name);
+    static void parallel_chunks(size_t count, size_t min_chunk, const std::function<void(size_t, size_t, unsigned int)>& task,
+                                unsigned int max_workers = 0);
+    void aggregate_density(Figure& fig, Figure::Curve& curve, const std::vector<double>& x, const std::vector<double>& y,
+                           const std::vector<double>* values);
+    void accumulate_density(const Figure::Curve& curve, const double* x, const double* y, const double* values, size_t count,
+                            std::vector<std::vector<uint32_t>>& counts, std::vector<std::vector<double>>& sums);
+    void merge_density(Figure::Curve& curve, const std::vector<std::vector<uint32_t>>& counts,
+                       const std::vector<std::vector<double>>& sums, bool mean);
+    static void for_each_chunk(DataSource& source, size_t chunk_size,
+                               const std::function<void(const std::vector<double>&, const std::vector<double>&)>& consume);
+    static bool source_bounds(DataSource& source, size_t chunk_size, double& xmin, double& xmax, double& ymin, double& ymax);
+    void add_histogram(Figure& fig, double min_val, double max_val, const std::vector<size_t>& counts,
+                       const Style& style, double bar_width_ratio);
+    void prepare_density_grid(Figure& fig, Figure::Curve& curve, double data_xmin, double data_xmax, double data_ymin, double data_ymax);
+    void rasterize_lines(Figure& fig, Figure::Curve& curve, const std::vector<const std::vector<double>*>& x,
+                         const std::vector<const std::vector<double>*>& y, bool normalize_series);
+    void shade_density(const Figure::Curve& curve, std::vector<sf::Uint8>& rgba);
     void draw_text(const Figure& fig, double w, double h);
     void draw_text(const Figure& fig, const Figure::Curve& curve, double w, double h);
+    const TextLayout& layout_text(const std::string& str, unsigned int size);
+    void queue_text(const TextLayout& layout, const sf::Vector2f& position, const sf::Color& color, float rotation = 0);
+    void flush_text();
     void draw_arrow_head(const Figure& fig, const Figure::Curve& curve, double w, double h);
     void draw_symbol(const sf::Vector2f& position, const std::string& symbol_type, double size, const sf::Color& color);
     
 
     // Helpers pour l'export SVG
-    void export_svg_figure(const Figure& fig, std::ofstream& svg_file, double x_offset, double y_offset, double width, double height);
-    void export_svg_curve(const Figure& fig, const Figure::Curve& curve, std::ofstream& svg_file, double x_offset, double y_offset, double width, double height);
-    void export_svg_histogram(const Figure& fig, const Figure::Curve& curve, std::ofstream& svg_file, double x_offset, double y_offset, double width, double height);
-    void export_svg_text(const Figure& fig, std::ofstream& svg_file, double x_offset, double y_offset, double width, double height);
-    void export_svg_grid(const Figure& fig, std::ofstream& svg_file, double x_offset, double y_offset, double width, double height);
-    void export_svg_polar_grid(const Figure& fig, std::ofstream& svg_file, double x_offset, double y_offset, double width, double height);
+    void export_svg_figure(const Figure& fig, std::ostream& svg_file, double x_offset, double y_offset, double width, double height);
+    void export_svg_curve(const Figure& fig, const Figure::Curve& curve, std::ostream& svg_file, double x_offset, double y_offset, double width, double height);
+    void export_svg_histogram(const Figure& fig, const Figure::Curve& curve, std::ostream& svg_file, double x_offset, double y_offset, double width, double height);
+    void export_svg_colorbar(const Figure& fig, std::ostream& svg_file, double x_offset, double y_offset, double width, double height,
+                             unsigned long& svg_ids);
+    void export_svg_scatter(const Figure& fig, const Figure::Curve& curve, std::ostream& svg_file, double x_offset, double y_offset, double width, double height,
+                            unsigned long& svg_ids);
+    void export_svg_density(const Figure& fig, const Figure::Curve& curve, std::ostream& svg_file, double x_offset, double y_offset, double width, double height);
+    void export_svg_text(const Figure& fig, std::ostream& svg_file, double x_offset, double y_offset, double width, double height);
+    void export_svg_grid(const Figure& fig, std::ostream& svg_file, double x_offset, double y_offset, double width, double height);
+    void export_svg_polar_grid(const Figure& fig, std::ostream& svg_file, double x_offset, double y_offset, double width, double height);
     std::string color_to_svg(const sf::Color& color);
     std::string line_style_to_svg(const std::string& line_style, float thickness);
+    std::string base64_encode(const std::vector<unsigned char>& data);
     void showSFML();
+    void apply_updates(const std::vector<std::function<void()>>& updates);
     
     std::string get_svg_in_html(const std::string& svg_filename);
 };
@@ -205,7 +728,7 @@ public:
     bool loadAndDisplayHTML(const std::string& html_file);
     
     // Load and display SVG content directly
-    bool loadAndDisplaySVG(const std::string& svg_content, const std::string& temp_svg_file = "");
+    bool loadAndDisplaySVG(const std::string& svg_content);
     
     // Close the viewer
     void close();
@@ -219,10 +742,12 @@ private:
     int svg_height;
 
     std::string current_svg_content; // Store the current SVG content
-    std::string temp_svg_file; // Temporary SVG file for displaying
      
-    // Helper method to create a temporary HTML file with SVG content
-    std::string createTempHTMLWithSVG(const std::string& svg_content);
+    // Window showing an HTML file, or the page given as a string if html_file is empty
+    bool showWindow(const std::string& html_file, const std::string& html_content);
+
+    // Helper method to build an HTML page embedding the SVG content
+    std::string createHTMLWithSVG(const std::string& svg_content);
 };
 #endif
 
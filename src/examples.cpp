@@ -4,6 +4,10 @@
 #include <cmath>
 #include <random>
 #include <functional>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <fstream>
 
 // Unicode constants and symbols
 const std::string DEGREE = "\u00B0";      // Degree symbol (°)
@@ -1241,6 +1245,162 @@ void example_svg_export() {
     plt.show();
 }
 
+// Example 10: Live window updated from the computing thread (show_async / update)
+void example_live_window() {
+    PlotGen plt(1000, 600);
+    auto& fig = plt.subplot(0, 0);
+    plt.set_title(fig, "Residual of an iterative solver");
+    plt.set_xlabel(fig, "Iteration");
+    plt.set_ylabel(fig, "Residual");
+    plt.set_axis_limits(fig, 0, 10, 1e-8, 1.0);
+    plt.set_log_y(fig, true);
+    
+    PlotGen::Style style;
+    style.color = sf::Color::Blue;
+    style.thickness = 2.0;
+    style.legend = "residual";
+    plt.plot(fig, {0.0}, {1.0}, style);
+    
+    // The window runs on its own thread; the figures are only changed through update()
+    plt.show_async();
+    double residual = 1.0;
+    for (int step = 1; plt.is_open() && step <= 400; ++step) {
+        residual *= 0.95;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        plt.update([&plt, &fig, step, residual]() {
+            plt.append(fig, 0, {double(step)}, {residual});
+            plt.set_axis_limits(fig, 0, std::max(10, step), 1e-8, 1.0);
+        });
+    }
+    plt.wait_closed();
+}
+
+// Example 11: Live stream fed by a producer thread
+void example_stream() {
+    PlotGen plt(1000, 600);
+    auto& fig = plt.subplot(0, 0);
+    plt.set_title(fig, "Sensor stream (last 5 s)");
+    plt.set_xlabel(fig, "Time (s)");
+    plt.set_ylabel(fig, "Signal");
+    plt.grid(fig, true, false);
+    
+    PlotGen::Style style;
+    style.color = sf::Color::Red;
+    style.thickness = 1.0;
+    auto signal = plt.stream(fig, 200000, style, 5.0);
+    
+    // 100k samples per second, pushed without ever waiting for the renderer
+    std::atomic<bool> running(true);
+    std::thread producer([&running, signal]() {
+        std::default_random_engine generator;
+        std::normal_distribution<double> noise(0.0, 0.1);
+        auto start = std::chrono::steady_clock::now();
+        long sample = 0;
+        while (running) {
+            for (int i = 0; i < 1000; ++i, ++sample) {
+                double t = sample * 1e-5;
+                signal->push(t, std::sin(2 * M_PI * t) + noise(generator));
+            }
+            std::this_thread::sleep_until(start + std::chrono::microseconds(sample * 10));
+        }
+    });
+    
+    plt.show();
+    running = false;
+    producer.join();
+    std::cout << "Dropped samples: " << signal->dropped() << std::endl;
+}
+
+// Example 12: CSV files, loaded in memory or read chunk by chunk
+void example_csv() {
+    // Generate a CSV file
+    const std::string filename = "example12_measures.csv";
+    {
+        std::ofstream csv(filename);
+        csv << "time,voltage,current\n";
+        std::default_random_engine generator;
+        std::normal_distribution<double> noise(0.0, 0.05);
+        for (int i = 0; i < 200000; ++i) {
+            double t = i * 1e-4;
+            csv << t << "," << std::sin(2 * M_PI * 5 * t) + noise(generator) << "," << 0.5 * std::cos(2 * M_PI * 5 * t) << "\n";
+        }
+    }
+    
+    PlotGen plt(1200, 500, 1, 2);
+    
+    // Whole file in memory, columns moved into the curves
+    auto& fig1 = plt.subplot(0, 0);
+    auto csv = PlotGen::load_csv(filename);
+    plt.set_title(fig1, "load_csv");
+    plt.set_xlabel(fig1, "Time (s)");
+    plt.set_ylabel(fig1, "Voltage (V)");
+    plt.plot(fig1, std::move(csv.column("time")), std::move(csv.column("voltage")));
+    
+    // Out-of-core: the file is read again in chunks, only a few samples per pixel column are kept
+    auto& fig2 = plt.subplot(0, 1);
+    PlotGen::CsvSource source(filename, 0, 2);
+    PlotGen::Style style;
+    style.color = sf::Color::Magenta;
+    plt.set_title(fig2, "plot_source");
+    plt.set_xlabel(fig2, "Time (s)");
+    plt.set_ylabel(fig2, "Current (A)");
+    plt.plot_source(fig2, source, style);
+    
+    plt.save("example12_csv.png");
+    plt.show();
+}
+
+// Example 13: Frames saved in the background (save_async)
+void example_save_async() {
+    PlotGen plt(800, 600);
+    std::vector<double> x(500), y(500);
+    for (int frame = 0; frame < 30; ++frame) {
+        plt.clear();
+        auto& fig = plt.subplot(0, 0);
+        for (int i = 0; i < 500; ++i) {
+            x[i] = i * 0.02;
+            y[i] = std::sin(x[i] - frame * 0.2) * std::exp(-0.1 * x[i]);
+        }
+        plt.set_title(fig, "Frame " + std::to_string(frame));
+        plt.set_axis_limits(fig, 0, 10, -1, 1);
+        plt.plot(fig, x, y);
+        
+        // Returns once the image is captured; the next frame is built while this one is encoded
+        plt.save_async("example13_frame_" + std::to_string(frame) + ".png");
+    }
+    plt.wait_saves();
+    std::cout << "30 frames saved" << std::endl;
+}
+
+// Example 14: Many plots rendered on a pool of threads (render_batch)
+void example_render_batch() {
+    std::vector<PlotGen::BatchJob> jobs;
+    for (int i = 0; i < 20; ++i) {
+        PlotGen::BatchJob job;
+        job.width = 640;
+        job.height = 480;
+        job.filename = "example14_plot_" + std::to_string(i) + (i % 5 == 4 ? ".svg" : ".png");
+        job.build = [i](PlotGen& plt) {
+            auto& fig = plt.subplot(0, 0);
+            std::vector<double> x(200), y(200);
+            for (int k = 0; k < 200; ++k) {
+                x[k] = k * 0.05;
+                y[k] = std::sin((i + 1) * 0.3 * x[k]);
+            }
+            plt.set_title(fig, "Series " + std::to_string(i));
+            plt.plot(fig, x, y);
+        };
+        jobs.push_back(job);
+    }
+    
+    for (const auto& result : PlotGen::render_batch(jobs)) {
+        if (!result.ok)
+            std::cerr << result.filename << ": " << result.error << std::endl;
+        else
+            std::cout << result.filename << ": " << result.render_ms + result.encode_ms << " ms" << std::endl;
+    }
+}
+
 // Main program to choose which example to run
 int main() {
     std::cout << "PlotGen - Plotting examples" << std::endl;
@@ -1253,8 +1413,13 @@ int main() {
     std::cout << "7. Circles, Text and Arrows" << std::endl;
     std::cout << "8. Bezier and Spline Curves" << std::endl;
     std::cout << "9. SVG export demonstration" << std::endl;
-    std::cout << "10. : Execute all examples" << std::endl;
-    std::cout << "Enter your choice (1-10): ";
+    std::cout << "10. Live window updated from another thread" << std::endl;
+    std::cout << "11. Live stream" << std::endl;
+    std::cout << "12. CSV files" << std::endl;
+    std::cout << "13. Background saves" << std::endl;
+    std::cout << "14. Batch rendering" << std::endl;
+    std::cout << "15. : Execute all examples" << std::endl;
+    std::cout << "Enter your choice (1-15): ";
     
     int choice;
     std::cin >> choice;
@@ -1269,7 +1434,12 @@ int main() {
         case 7: example_circles_text_arrows(); break;
         case 8: example_bezier_spline(); break;
         case 9: example_svg_export(); break;
-        case 10: 
+        case 10: example_live_window(); break;
+        case 11: example_stream(); break;
+        case 12: example_csv(); break;
+        case 13: example_save_async(); break;
+        case 14: example_render_batch(); break;
+        case 15: 
             example_basic_plots();
             example_histograms();
             example_polar_plots();
@@ -1279,6 +1449,11 @@ int main() {
             example_circles_text_arrows();
             example_bezier_spline();
             example_svg_export();
+            example_live_window();
+            example_stream();
+            example_csv();
+            example_save_async();
+            example_render_batch();
             break;
         default: 
             std::cout << "Invalid choice." << std::endl;
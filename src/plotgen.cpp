@@ -11,6 +11,242 @@
 #endif
 #include <sstream>
 #include <ctime>
+#include <thread>
+#include <limits>
+#include <cstdint>
+#include <array>
+#include <cstring>
+#include <future>
+#include <chrono>
+#include <set>
+#include <sys/stat.h>
+#include <charconv>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define PLOTGEN_HAVE_MMAP
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// Colormap lookup tables, built at compile time by linear interpolation between color stops
+namespace
+{
+    struct ColorStop
+    {
+        double t;
+        unsigned char r, g, b;
+    };
+
+    template <size_t N>
+    constexpr std::array<sf::Uint8, PlotGen::COLORMAP_SIZE * 4> make_colormap(const ColorStop (&stops)[N])
+    {
+        std::array<sf::Uint8, PlotGen::COLORMAP_SIZE * 4> lut{};
+        for (size_t i = 0; i < PlotGen::COLORMAP_SIZE; ++i)
+        {
+            double t = static_cast<double>(i) / (PlotGen::COLORMAP_SIZE - 1);
+            size_t k = 0;
+            while (k + 2 < N && t > stops[k + 1].t)
+                ++k;
+            double f = (t - stops[k].t) / (stops[k + 1].t - stops[k].t);
+            f = f < 0 ? 0 : (f > 1 ? 1 : f);
+            lut[i * 4] = static_cast<sf::Uint8>(stops[k].r + f * (stops[k + 1].r - stops[k].r) + 0.5);
+            lut[i * 4 + 1] = static_cast<sf::Uint8>(stops[k].g + f * (stops[k + 1].g - stops[k].g) + 0.5);
+            lut[i * 4 + 2] = static_cast<sf::Uint8>(stops[k].b + f * (stops[k + 1].b - stops[k].b) + 0.5);
+            lut[i * 4 + 3] = 255;
+        }
+        return lut;
+    }
+
+    constexpr ColorStop viridis_stops[] = {
+        {0.0, 0x44, 0x01, 0x54}, {0.1, 0x48, 0x24, 0x75}, {0.2, 0x41, 0x44, 0x87}, {0.3, 0x35, 0x5f, 0x8d},
+        {0.4, 0x2a, 0x78, 0x8e}, {0.5, 0x21, 0x91, 0x8c}, {0.6, 0x22, 0xa8, 0x84}, {0.7, 0x44, 0xbf, 0x70},
+        {0.8, 0x7a, 0xd1, 0x51}, {0.9, 0xbd, 0xdf, 0x26}, {1.0, 0xfd, 0xe7, 0x25}};
+    constexpr ColorStop magma_stops[] = {
+        {0.0, 0x00, 0x00, 0x04}, {0.1, 0x14, 0x0e, 0x36}, {0.2, 0x3b, 0x0f, 0x70}, {0.3, 0x64, 0x1a, 0x80},
+        {0.4, 0x8c, 0x29, 0x81}, {0.5, 0xb7, 0x37, 0x79}, {0.6, 0xde, 0x49, 0x68}, {0.7, 0xf7, 0x70, 0x5c},
+        {0.8, 0xfe, 0x9f, 0x6d}, {0.9, 0xfe, 0xcf, 0x92}, {1.0, 0xfc, 0xfd, 0xbf}};
+    constexpr ColorStop cividis_stops[] = {
+        {0.0, 0x00, 0x22, 0x4e}, {0.1, 0x12, 0x35, 0x70}, {0.2, 0x3b, 0x49, 0x6c}, {0.3, 0x57, 0x5d, 0x6d},
+        {0.4, 0x70, 0x71, 0x73}, {0.5, 0x8a, 0x86, 0x78}, {0.6, 0xa5, 0x9c, 0x74}, {0.7, 0xc3, 0xb3, 0x69},
+        {0.8, 0xe1, 0xcc, 0x55}, {0.9, 0xf4, 0xdc, 0x46}, {1.0, 0xfe, 0xe8, 0x38}};
+    constexpr ColorStop coolwarm_stops[] = {
+        {0.0, 59, 76, 192}, {0.125, 98, 130, 234}, {0.25, 141, 176, 254}, {0.375, 184, 208, 249},
+        {0.5, 221, 221, 221}, {0.625, 245, 196, 173}, {0.75, 244, 154, 123}, {0.875, 222, 96, 77}, {1.0, 180, 4, 38}};
+    constexpr ColorStop grayscale_stops[] = {{0.0, 0, 0, 0}, {1.0, 255, 255, 255}};
+    // Blue -> cyan -> green -> yellow -> red, the historical PlotGen gradient
+    constexpr ColorStop rainbow_stops[] = {
+        {0.0, 0, 0, 255}, {0.25, 0, 255, 255}, {0.5, 0, 255, 0}, {0.75, 255, 255, 0}, {1.0, 255, 0, 0}};
+
+    constexpr auto viridis_lut = make_colormap(viridis_stops);
+    constexpr auto magma_lut = make_colormap(magma_stops);
+    constexpr auto cividis_lut = make_colormap(cividis_stops);
+    constexpr auto coolwarm_lut = make_colormap(coolwarm_stops);
+    constexpr auto grayscale_lut = make_colormap(grayscale_stops);
+    constexpr auto rainbow_lut = make_colormap(rainbow_stops);
+
+    // Process-wide font registry. Each font file is read once per process; the sf::Font built from it
+    // (FreeType face and glyph cache, which are not thread-safe) is created once per thread and shared
+    // by all the PlotGen instances drawing from that thread.
+    std::mutex font_files_mutex;
+    std::map<std::string, std::shared_ptr<const std::vector<char>>> font_files;
+    std::string default_font_path;
+
+    // Path of the requested font, or of the default font if none is requested. The default font is
+    // searched for in several possible locations, once per process.
+    std::string resolve_font_path(const std::string &requested_path)
+    {
+        if (!requested_path.empty())
+            return requested_path;
+
+        std::lock_guard<std::mutex> lock(font_files_mutex);
+        if (default_font_path.empty())
+        {
+            const char *candidates[] = {"fonts/arial.ttf", "build/arial.ttf",
+                                        "/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+                                        "/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"};
+            for (const char *candidate : candidates)
+            {
+                if (std::ifstream(candidate, std::ios::binary).good())
+                {
+                    default_font_path = candidate;
+                    std::cout << "Font loaded from " << default_font_path << std::endl;
+                    break;
+                }
+            }
+        }
+        return default_font_path;
+    }
+
+    std::shared_ptr<const std::vector<char>> font_file(const std::string &path)
+    {
+        std::lock_guard<std::mutex> lock(font_files_mutex);
+        auto found = font_files.find(path);
+        if (found != font_files.end())
+            return found->second;
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open())
+            return nullptr;
+        auto data = std::make_shared<std::vector<char>>((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        font_files[path] = data;
+        return data;
+    }
+
+    // Keyed by the resolved path, so that set_default_font_path() also applies to the threads
+    // which have already drawn text with the previous default font
+    std::shared_ptr<sf::Font> shared_font(const std::string &requested_path)
+    {
+        std::string path = resolve_font_path(requested_path);
+        if (path.empty())
+            return nullptr;
+
+        thread_local std::map<std::string, std::shared_ptr<sf::Font>> thread_fonts;
+        auto found = thread_fonts.find(path);
+        if (found != thread_fonts.end())
+            return found->second;
+
+        auto data = font_file(path);
+        auto font = std::make_shared<sf::Font>();
+        // loadFromMemory keeps a pointer to the data, which the registry never releases
+        if (!data || !font->loadFromMemory(data->data(), data->size()))
+            return nullptr;
+        thread_fonts[path] = font;
+        return font;
+    }
+
+    // Read-only view of a whole file: memory-mapped where available, read into memory otherwise
+    class MappedFile
+    {
+    public:
+        explicit MappedFile(const std::string &filename)
+        {
+#ifdef PLOTGEN_HAVE_MMAP
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("Unable to open " + filename);
+            struct stat info;
+            if (::fstat(fd, &info) != 0)
+            {
+                ::close(fd);
+                throw std::runtime_error("Unable to read " + filename);
+            }
+            length = static_cast<size_t>(info.st_size);
+            if (length > 0)
+            {
+                void *mapping = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapping == MAP_FAILED)
+                {
+                    ::close(fd);
+                    throw std::runtime_error("Unable to map " + filename);
+                }
+                ::madvise(mapping, length, MADV_SEQUENTIAL);
+                begin = static_cast<const char *>(mapping);
+            }
+            ::close(fd); // The mapping stays valid
+#else
+            std::ifstream file(filename, std::ios::binary);
+            if (!file.is_open())
+                throw std::runtime_error("Unable to open " + filename);
+            buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            begin = buffer.data();
+            length = buffer.size();
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef PLOTGEN_HAVE_MMAP
+            if (begin)
+                ::munmap(const_cast<char *>(begin), length);
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const char *data() const { return begin; }
+        size_t size() const { return length; }
+
+    private:
+        const char *begin = nullptr;
+        size_t length = 0;
+#ifndef PLOTGEN_HAVE_MMAP
+        std::string buffer;
+#endif
+    };
+
+    // Field of a CSV line without surrounding blanks and quotes
+    void trim_field(const char *&begin, const char *&end)
+    {
+        while (begin < end && (*begin == ' ' || *begin == '\t'))
+            ++begin;
+        while (end > begin && (end[-1] == ' ' || end[-1] == '\t'))
+            --end;
+        if (end - begin >= 2 && *begin == '"' && end[-1] == '"')
+        {
+            ++begin;
+            --end;
+        }
+    }
+
+    // Number of a CSV field, NaN if it is empty or not entirely a number
+    double parse_csv_field(const char *begin, const char *end)
+    {
+        trim_field(begin, end);
+        if (begin < end && *begin == '+')
+            ++begin;
+        double value;
+        auto result = std::from_chars(begin, end, value);
+        if (begin == end || result.ec != std::errc() || result.ptr != end)
+            return std::numeric_limits<double>::quiet_NaN();
+        return value;
+    }
+}
 
 // Style struct constructor implementation
 PlotGen::Style::Style(
@@ -25,52 +261,141 @@ PlotGen::Style::Style(
 }
 
 // Constructor
-PlotGen::PlotGen(unsigned int width, unsigned int height, unsigned int rows, unsigned int cols)
-    : width(width), height(height), rows(rows), cols(cols) // Ne pas initialiser la fenêtre ici
+PlotGen::PlotGen(unsigned int width, unsigned int height, unsigned int rows, unsigned int cols, bool vector_only)
+    : width(width), height(height), rows(rows), cols(cols), vector_only(vector_only) // Ne pas initialiser la fenêtre ici
 {
-    // Créer uniquement la texture pour le rendu, mais pas la fenêtre visible
-    texture.create(width, height);
-    texture.setSmooth(true);
-
-    // Search for the font in several possible locations
-    if (font.loadFromFile("fonts/arial.ttf"))
+    // The render texture (and its OpenGL context) is created by ensure_texture(),
+    // the font is loaded on first use by get_font()
+    figures.resize(rows * cols);
+    for (auto &fig : figures)
     {
-        std::cout << "Font loaded from current directory" << std::endl;
+        fig.curve_types.clear();
+        fig.curves.clear();
     }
-    else if (font.loadFromFile("build/arial.ttf"))
+}
+
+// Add a figure at a position (row, col)
+PlotGen::Figure &PlotGen::subplot(unsigned int row, unsigned int col)
+{
+    if (row >= rows || col >= cols)
     {
-        std::cout << "Font loaded from build directory" << std::endl;
+        throw std::out_of_range("Subplot index out of range");
     }
-    else if (font.loadFromFile("/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf"))
+    return figures[row * cols + col];
+}
+
+// Remove all curves and restore the default settings of the figures. The figures, the render
+// texture and the fonts are kept, and the buffers of the removed curves are reused by make_curve().
+// Only the buffers of the last clear() are kept: spares that were not taken since are released,
+// so the pool never holds more than one frame worth of curves
+void PlotGen::clear()
+{
+    spare_curves.clear();
+    for (auto &fig : figures)
     {
-        std::cout << "LiberationSans font loaded" << std::endl;
+        for (auto &curve : fig.curves)
+        {
+            // Only the sample buffers are kept
+            if (curve.x.capacity() == 0 && curve.y.capacity() == 0)
+            {
+                continue;
+            }
+            Figure::Curve spare;
+            spare.x = std::move(curve.x);
+            spare.y = std::move(curve.y);
+            spare_curves.push_back(std::move(spare));
+        }
+        std::vector<Figure::Curve> curves = std::move(fig.curves);
+        std::vector<std::string> curve_types = std::move(fig.curve_types);
+        curves.clear();
+        curve_types.clear();
+
+        fig = Figure();
+        fig.curves = std::move(curves); // Keeps the reserved capacity
+        fig.curve_types = std::move(curve_types);
     }
-    else if (font.loadFromFile("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf"))
+}
+
+// Clear and change the grid of subplots and the image size
+void PlotGen::reset(unsigned int rows, unsigned int cols, unsigned int width, unsigned int height)
+{
+    if (rows == 0 || cols == 0 || width == 0 || height == 0)
     {
-        std::cout << "DejaVuSans font loaded" << std::endl;
+        throw std::invalid_argument("The grid and the image size must not be empty");
     }
-    else
+
+    const bool resize = width != this->width || height != this->height;
+    if (resize || rows * cols != figures.size())
     {
-        std::cerr << "WARNING: Unable to load a font compatible with Unicode characters" << std::endl;
-        throw std::runtime_error("Unable to load a font supporting Unicode");
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        if (ui_open)
+        {
+            throw std::runtime_error("The layout and the size cannot change while the window is open");
+        }
     }
 
+    clear();
     figures.resize(rows * cols);
-    for (auto &fig : figures)
+    this->rows = rows;
+    this->cols = cols;
+
+    if (resize)
     {
-        fig.curve_types.clear();
-        fig.curves.clear();
+        this->width = width;
+        this->height = height;
+        sf::Vector2u size = texture_size();
+        if (texture && !texture->create(size.x, size.y))
+        {
+            texture.reset();
+            throw std::runtime_error("Unable to create the render texture");
+        }
     }
 }
 
-// Add a figure at a position (row, col)
-PlotGen::Figure &PlotGen::subplot(unsigned int row, unsigned int col)
+// New curve with the given samples, in the buffers of a curve removed by clear() when there is one
+PlotGen::Figure::Curve PlotGen::make_curve(const std::vector<double> &x, const std::vector<double> &y, const Style &style)
 {
-    if (row >= rows || col >= cols)
+    Figure::Curve curve;
+    if (!spare_curves.empty())
     {
-        throw std::out_of_range("Subplot index out of range");
+        Figure::Curve &spare = spare_curves.back();
+        curve.x = std::move(spare.x);
+        curve.y = std::move(spare.y);
+        spare_curves.pop_back();
     }
-    return figures[row * cols + col];
+    curve.x.assign(x.begin(), x.end());
+    curve.y.assign(y.begin(), y.end());
+    curve.style = style;
+    return curve;
+}
+
+// Font of the current thread, loaded from the shared registry on first use
+const sf::Font &PlotGen::get_font() const
+{
+    if (!font || font_thread != std::this_thread::get_id())
+    {
+        font = shared_font(font_path);
+        if (!font)
+        {
+            std::cerr << "WARNING: Unable to load a font compatible with Unicode characters" << std::endl;
+            throw std::runtime_error("Unable to load a font supporting Unicode");
+        }
+        font_thread = std::this_thread::get_id();
+    }
+    return *font;
+}
+
+void PlotGen::set_font_path(const std::string &path)
+{
+    font_path = path;
+    font.reset();
+    text_layouts.clear();
+}
+
+void PlotGen::set_default_font_path(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(font_files_mutex);
+    default_font_path = path;
 }
 
 // Figure configuration
@@ -116,6 +441,33 @@ void PlotGen::set_legend_position(Figure &fig, const std::string &position)
     }
 }
 
+// Logarithmic y axis: the y limits must be positive
+void PlotGen::set_log_y(Figure &fig, bool log)
+{
+    if (log)
+    {
+        for (const auto &type : fig.curve_types)
+        {
+            if (type == "HIST" || type == "DENSITY")
+                throw std::invalid_argument("Histograms and density plots cannot be shown on a logarithmic y axis");
+        }
+    }
+    fig.log_y = log;
+    if (log && !(fig.ymin > 0))
+    {
+        std::cerr << "WARNING: Non-positive y limits on a logarithmic axis, using 1e-6 as lower limit." << std::endl;
+        fig.ymin = 1e-6;
+        fig.ymax = std::max(fig.ymax, 1.0);
+    }
+}
+
+// Histograms and density grids are binned linearly in y, they would not line up with a logarithmic axis
+void PlotGen::require_linear_y(const Figure &fig) const
+{
+    if (fig.log_y)
+        throw std::invalid_argument("Histograms and density plots cannot be shown on a logarithmic y axis");
+}
+
 // Methods to enable/disable grids
 void PlotGen::grid(Figure &fig, bool major, bool minor)
 {
@@ -131,6 +483,22 @@ void PlotGen::set_grid_color(Figure &fig, sf::Color major_color, sf::Color minor
 
 void PlotGen::set_equal_axes(Figure &fig, bool equal) { fig.equal_axes = equal; }
 
+// Colorbar for values between vmin and vmax
+void PlotGen::colorbar(Figure &fig, const std::string &colormap, double vmin, double vmax, const std::string &label)
+{
+    if (!(vmax > vmin))
+    {
+        throw std::invalid_argument("Colorbar range must satisfy vmin < vmax");
+    }
+
+    fig.show_colorbar = true;
+    fig.colorbar_map = colormap;
+    check_colormap(fig.colorbar_map);
+    fig.colorbar_min = vmin;
+    fig.colorbar_max = vmax;
+    fig.colorbar_label = label;
+}
+
 // 2D curve plotting
 void PlotGen::plot(Figure &fig, const std::vector<double> &x, const std::vector<double> &y, const Style &style)
 {
@@ -138,6 +506,28 @@ void PlotGen::plot(Figure &fig, const std::vector<double> &x, const std::vector<
     {
         throw std::invalid_argument("x and y vectors must have the same size and not be empty");
     }
+    add_curve(fig, make_curve(x, y, style));
+}
+
+// Same, taking the vectors (e.g. the columns of load_csv()) without copying them
+void PlotGen::plot(Figure &fig, std::vector<double> &&x, std::vector<double> &&y, const Style &style)
+{
+    if (x.size() != y.size() || x.empty())
+    {
+        throw std::invalid_argument("x and y vectors must have the same size and not be empty");
+    }
+    Figure::Curve curve;
+    curve.x = std::move(x);
+    curve.y = std::move(y);
+    curve.style = style;
+    add_curve(fig, std::move(curve));
+}
+
+// Add a "2D" curve, adjusting the default limits to its samples
+void PlotGen::add_curve(Figure &fig, Figure::Curve &&curve)
+{
+    const std::vector<double> &x = curve.x;
+    const std::vector<double> &y = curve.y;
 
     // Ajouter un auto-ajustement des limites d'axes si elles n'ont pas été définies
     bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
@@ -172,1673 +562,6324 @@ void PlotGen::plot(Figure &fig, const std::vector<double> &x, const std::vector<
     }
 
     // Utiliser directement le style sans ajouter de description textuelle
-    fig.curves.push_back({x, y, style});
+    fig.curves.push_back(std::move(curve));
     fig.curve_types.push_back("2D");
+
+    if (fig.use_lod)
+    {
+        build_lod(fig.curves.back());
+    }
 }
 
-// Circle with center (x0, y0) and radius r
-void PlotGen::circle(Figure &fig, double x0, double y0, double r, const Style &style)
+// Append samples to a 2D curve
+void PlotGen::append(Figure &fig, size_t curve_index, const std::vector<double> &x, const std::vector<double> &y)
 {
-    // Validation du rayon
-    if (r <= 0)
+    if (curve_index >= fig.curves.size())
     {
-        throw std::invalid_argument("Circle radius must be positive");
+        throw std::out_of_range("Curve index out of range");
     }
-
-    // Générer les points du cercle en utilisant les équations paramétriques
-    const int num_points = 100; // Nombre de points pour dessiner le cercle
-    std::vector<double> x(num_points), y(num_points);
-
-    for (int i = 0; i < num_points; ++i)
+    if (x.size() != y.size())
     {
-        double angle = 2.0 * M_PI * i / (num_points - 1);
-        x[i] = x0 + r * std::cos(angle);
-        y[i] = y0 + r * std::sin(angle);
+        throw std::invalid_argument("x and y vectors must have the same size");
+    }
+    if (x.empty())
+    {
+        return;
     }
 
-    // Activer l'option equal_axes pour garantir que le cercle est bien rond
-    bool was_equal = fig.equal_axes;
-    fig.equal_axes = true;
-
-    // Vérifier si les limites d'axes existantes sont suffisantes
-    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+    Figure::Curve &curve = fig.curves[curve_index];
+    size_t first_new_sample = curve.x.size();
+    curve.x.insert(curve.x.end(), x.begin(), x.end());
+    curve.y.insert(curve.y.end(), y.begin(), y.end());
 
-    if (using_default_limits)
+    if (!curve.lod.levels.empty())
     {
-        // Définir de nouvelles limites d'axes pour bien voir le cercle avec une marge
-        double margin = r * 0.2; // 20% de marge autour du cercle
-        fig.xmin = x0 - r - margin;
-        fig.xmax = x0 + r + margin;
-        fig.ymin = y0 - r - margin;
-        fig.ymax = y0 + r + margin;
+        if (curve.x[first_new_sample] < curve.x[first_new_sample > 0 ? first_new_sample - 1 : 0] ||
+            !std::is_sorted(x.begin(), x.end()))
+        {
+            // No longer sorted, the pyramid cannot be used anymore
+            curve.lod.levels.clear();
+            curve.lod.unsorted = true;
+        }
+        else
+        {
+            update_lod(curve, first_new_sample);
+        }
     }
-    else
+    else if (fig.use_lod && fig.curve_types[curve_index] == "2D" && !curve.lod.unsorted)
     {
-        // Vérifier si le cercle est visible dans les limites actuelles
-        double min_x = x0 - r;
-        double max_x = x0 + r;
-        double min_y = y0 - r;
-        double max_y = y0 + r;
+        build_lod(curve);
+    }
+}
 
-        // Étendre les limites si nécessaire
-        if (min_x < fig.xmin)
-            fig.xmin = min_x - r * 0.1;
-        if (max_x > fig.xmax)
-            fig.xmax = max_x + r * 0.1;
-        if (min_y < fig.ymin)
-            fig.ymin = min_y - r * 0.1;
-        if (max_y > fig.ymax)
-            fig.ymax = max_y + r * 0.1;
+// Enable LOD pyramids for the curves of a figure
+void PlotGen::enable_lod(Figure &fig, bool enable)
+{
+    fig.use_lod = enable;
+    for (size_t i = 0; i < fig.curves.size(); ++i)
+    {
+        if (!enable)
+            fig.curves[i].lod.levels.clear();
+        else if (fig.curve_types[i] == "2D" && fig.curves[i].lod.levels.empty())
+            build_lod(fig.curves[i]);
     }
+}
 
-    // Tracer le cercle comme une courbe normale
-    plot(fig, x, y, style);
+// Live series backed by a ring buffer, fed through the returned handle
+std::shared_ptr<PlotGen::Stream> PlotGen::stream(Figure &fig, size_t capacity, const Style &style, double window)
+{
+    auto handle = std::make_shared<Stream>(capacity, window);
 
-    // Restaurer l'état précédent de equal_axes si nécessaire
-    fig.equal_axes = was_equal;
+    Figure::Curve curve;
+    curve.style = style;
+    curve.stream = handle;
+    fig.curves.push_back(curve);
+    fig.curve_types.push_back("STREAM");
+    return handle;
 }
 
-// Arc centered at (x0, y0) from angle1 to angle2 (in radians) with radius r
-void PlotGen::arc(Figure &fig, double x0, double y0, double r, double angle1, double angle2, const Style &style, int num_points)
+// Follow a log file: one stream per plotted column
+std::shared_ptr<PlotGen::LogTail> PlotGen::tail(Figure &fig, const std::string &filename, const LogColumns &columns,
+                                                const std::vector<Style> &styles, size_t capacity)
 {
-    // Validate inputs
-    if (r <= 0)
+    if (columns.y.empty())
     {
-        throw std::invalid_argument("Arc radius must be positive");
+        throw std::invalid_argument("No column to plot in the log file");
     }
 
-    if (num_points < 2)
+    static const sf::Color palette[] = {sf::Color::Blue, sf::Color::Red, sf::Color(0, 150, 0), sf::Color::Magenta,
+                                        sf::Color(0, 150, 150), sf::Color(200, 120, 0), sf::Color::Black};
+    std::vector<std::shared_ptr<Stream>> streams;
+    for (size_t k = 0; k < columns.y.size(); ++k)
     {
-        throw std::invalid_argument("Number of points must be at least 2");
+        Style style = k < styles.size() ? styles[k]
+                                         : Style(palette[k % 7], 1.0, "solid", "column " + std::to_string(columns.y[k]));
+        streams.push_back(stream(fig, capacity, style));
     }
+    return std::make_shared<LogTail>(filename, columns, streams);
+}
 
-    // Ensure angle1 is less than angle2
-    if (angle1 > angle2)
+PlotGen::Stream::Stream(size_t capacity, double window_)
+    : enqueue_pos(0), dropped_count(0), ring_capacity(capacity), window(window_)
+{
+    if (capacity == 0)
     {
-        std::swap(angle1, angle2);
+        throw std::invalid_argument("Stream capacity must be positive");
     }
 
-    // Generate points for the arc using parametric equations
-    std::vector<double> x(num_points), y(num_points);
+    // The queue holds what arrives between two drains, whatever the ring keeps: at 1M samples/s and
+    // 60 fps a frame brings ~17k samples, so even a small ring gets room for about 4 frames
+    // (the newest samples would be the ones dropped). Larger rings get up to 2^20 cells.
+    size_t queue_size = size_t(1) << 16;
+    while (queue_size < capacity && queue_size < (size_t(1) << 20))
+        queue_size <<= 1;
+    cells.reset(new Cell[queue_size]);
+    for (size_t i = 0; i < queue_size; ++i)
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    mask = queue_size - 1;
+
+    ring_x.resize(2 * capacity);
+    ring_y.resize(2 * capacity);
+}
 
-    for (int i = 0; i < num_points; ++i)
+bool PlotGen::Stream::push(double x, double y)
+{
+    if (enqueue(x, y))
+        return true;
+
+    // Full: the renderer is behind, drop the sample rather than wait
+    dropped_count.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool PlotGen::Stream::enqueue(double x, double y)
+{
+    Cell *cell;
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    for (;;)
     {
-        double angle = angle1 + (angle2 - angle1) * i / (num_points - 1);
-        x[i] = x0 + r * std::cos(angle);
-        y[i] = y0 + r * std::sin(angle);
+        cell = &cells[pos & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
+        }
     }
 
-    // Check if we need to adjust axis limits
-    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+    cell->x = x;
+    cell->y = y;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
 
-    if (using_default_limits)
+size_t PlotGen::Stream::push(const double *x, const double *y, size_t count)
+{
+    size_t accepted = 0;
+    for (size_t i = 0; i < count; ++i)
     {
-        // Calculate arc bounds
-        double min_x = x0 - r;
-        double max_x = x0 + r;
-        double min_y = y0 - r;
-        double max_y = y0 + r;
+        if (push(x[i], y[i]))
+            ++accepted;
+    }
+    return accepted;
+}
 
-        // Add margin (20% of radius)
-        double margin = r * 0.2;
+bool PlotGen::Stream::drain()
+{
+    // At most one queue length per call, so that fast producers cannot hold the renderer
+    bool received = false;
+    for (size_t n = 0; n <= mask; ++n)
+    {
+        Cell &cell = cells[dequeue_pos & mask];
+        if (cell.sequence.load(std::memory_order_acquire) != dequeue_pos + 1)
+            break;
+        double x = cell.x, y = cell.y;
+        cell.sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+        ++dequeue_pos;
+        received = true;
+
+        // Full ring: the oldest sample leaves
+        if (size == ring_capacity)
+        {
+            head = head + 1 == ring_capacity ? 0 : head + 1;
+            --size;
+        }
 
-        fig.xmin = min_x - margin;
-        fig.xmax = max_x + margin;
-        fig.ymin = min_y - margin;
-        fig.ymax = max_y + margin;
+        size_t p = head + size;
+        if (p >= ring_capacity)
+            p -= ring_capacity;
+        ring_x[p] = ring_x[p + ring_capacity] = x;
+        ring_y[p] = ring_y[p + ring_capacity] = y;
+        ++size;
 
-        // Use equal_axes to maintain circular appearance
-        fig.equal_axes = true;
+        // Sliding minimum and maximum: each deque keeps the candidates in decreasing age order
+        if (std::isfinite(y))
+        {
+            while (!min_deque.empty() && min_deque.back().second >= y)
+                min_deque.pop_back();
+            min_deque.emplace_back(total, y);
+            while (!max_deque.empty() && max_deque.back().second <= y)
+                max_deque.pop_back();
+            max_deque.emplace_back(total, y);
+        }
+        ++total;
     }
-    else
-    {
-        // Check if the arc fits within current limits
-        double min_x = x0 + r * std::min(std::cos(angle1), std::cos(angle2));
-        double max_x = x0 + r * std::max(std::cos(angle1), std::cos(angle2));
-        double min_y = y0 + r * std::min(std::sin(angle1), std::sin(angle2));
-        double max_y = y0 + r * std::max(std::sin(angle1), std::sin(angle2));
 
-        // Also check extreme points (0, π/2, π, 3π/2) if they fall within the angle range
-        if (angle1 <= 0 && angle2 >= 0)
-            max_x = std::max(max_x, x0 + r);
-        if (angle1 <= M_PI / 2 && angle2 >= M_PI / 2)
-            max_y = std::max(max_y, y0 + r);
-        if (angle1 <= M_PI && angle2 >= M_PI)
-            min_x = std::min(min_x, x0 - r);
-        if (angle1 <= 3 * M_PI / 2 && angle2 >= 3 * M_PI / 2)
-            min_y = std::min(min_y, y0 - r);
+    if (!received)
+        return false;
 
-        // Extend limits if needed
-        if (min_x < fig.xmin)
-            fig.xmin = min_x - r * 0.1;
-        if (max_x > fig.xmax)
-            fig.xmax = max_x + r * 0.1;
-        if (min_y < fig.ymin)
-            fig.ymin = min_y - r * 0.1;
-        if (max_y > fig.ymax)
-            fig.ymax = max_y + r * 0.1;
+    // Time window: keep the samples less than `window` older than the newest one
+    if (window > 0)
+    {
+        double newest = window_x()[size - 1];
+        while (size > 1 && window_x()[0] < newest - window)
+        {
+            head = head + 1 == ring_capacity ? 0 : head + 1;
+            --size;
+        }
     }
 
-    // Store the arc as a 2D curve
-    fig.curves.push_back({x, y, style});
-    fig.curve_types.push_back("2D");
+    size_t oldest = total - size;
+    while (!min_deque.empty() && min_deque.front().first < oldest)
+        min_deque.pop_front();
+    while (!max_deque.empty() && max_deque.front().first < oldest)
+        max_deque.pop_front();
+    return true;
 }
 
-// Text at a specific position (x, y) in data coordinates
-void PlotGen::text(Figure &fig, double x, double y, const std::string &text_content, const Style &style)
+// Move the queued samples of all streams into their rings. Figures which received samples are flagged
+// in `changed`, and their limits follow the data unless the user moved them.
+bool PlotGen::drain_streams(std::vector<bool> &changed)
 {
-    if (text_content.empty())
+    bool any = false;
+    for (size_t i = 0; i < figures.size(); ++i)
     {
-        return; // Nothing to render
+        Figure &fig = figures[i];
+        for (size_t c = 0; c < fig.curves.size(); ++c)
+        {
+            if (fig.curves[c].stream && fig.curves[c].stream->drain())
+                changed[i] = any = true;
+        }
+        if (!changed[i] || !fig.follow_streams)
+            continue;
+
+        // Limits from the ring bounds and the sliding extrema, O(1) per stream
+        double x_min = std::numeric_limits<double>::infinity(), x_max = -x_min;
+        double y_min = x_min, y_max = -x_min;
+        for (const auto &curve : fig.curves)
+        {
+            if (!curve.stream || curve.stream->size == 0)
+                continue;
+            const Stream &stream = *curve.stream;
+            x_min = std::min(x_min, stream.window_x()[0]);
+            x_max = std::max(x_max, stream.window_x()[stream.size - 1]);
+            if (!stream.min_deque.empty())
+            {
+                y_min = std::min(y_min, stream.min_deque.front().second);
+                y_max = std::max(y_max, stream.max_deque.front().second);
+            }
+        }
+        if (!(x_max >= x_min) || !(y_max >= y_min))
+            continue;
+
+        if (std::abs(x_max - x_min) < 1e-10)
+        {
+            x_min -= 1.0;
+            x_max += 1.0;
+        }
+        fig.xmin = x_min;
+        fig.xmax = x_max;
+
+        if (fig.log_y)
+        {
+            // Margins of a quarter of a decade, non-positive values are not shown
+            if (!(y_max > 0))
+                continue;
+            if (!(y_min > 0))
+                y_min = y_max * 1e-6;
+            fig.ymin = y_min / 1.8;
+            fig.ymax = y_max * 1.8;
+        }
+        else
+        {
+            double y_margin = (y_max - y_min) * 0.05;
+            if (std::abs(y_max - y_min) < 1e-10)
+                y_margin = 1.0;
+            fig.ymin = y_min - y_margin;
+            fig.ymax = y_max + y_margin;
+        }
     }
+    return any;
+}
 
-    // Create a new data structure for storing the text position and content
-    // We'll use the plot method's data structures but modify the type
-    std::vector<double> x_pos = {x};
-    std::vector<double> y_pos = {y};
+PlotGen::LogTail::LogTail(const std::string &filename_, const LogColumns &columns_, const std::vector<std::shared_ptr<Stream>> &streams_)
+    : filename(filename_), columns(columns_), streams(streams_), running(true), parsed_lines(0)
+{
+    worker = std::thread(&LogTail::run, this);
+}
 
-    // Store the text content in the curve structure, but mark it with a special type
-    // We'll use the "TEXT" type to distinguish it from other curve types
-    Figure::Curve text_curve = {x_pos, y_pos, style};
-    text_curve.text_content = text_content; // We'll need to add this field to the Curve struct
+PlotGen::LogTail::~LogTail()
+{
+    stop();
+}
 
-    fig.curves.push_back(text_curve);
-    fig.curve_types.push_back("TEXT");
+void PlotGen::LogTail::stop()
+{
+    running = false;
+    if (worker.joinable())
+        worker.join();
+}
 
-    // Check if we need to adjust the axis limits to include the text position
-    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
-    if (using_default_limits)
+// Read what was appended since the last call, then wait for the next change of the file
+void PlotGen::LogTail::run()
+{
+#ifdef __linux__
+    int notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    int watch = -1;
+#endif
+
+    while (running)
     {
-        // If using default limits, adjust to include the text position with a margin
-        double margin_x = std::abs(x) * 0.2 + 1.0; // 20% margin or at least 1.0 unit
-        double margin_y = std::abs(y) * 0.2 + 1.0;
+        read_new_data();
 
-        fig.xmin = std::min(fig.xmin, x - margin_x);
-        fig.xmax = std::max(fig.xmax, x + margin_x);
-        fig.ymin = std::min(fig.ymin, y - margin_y);
-        fig.ymax = std::max(fig.ymax, y + margin_y);
+#ifdef __linux__
+        if (notify_fd >= 0)
+        {
+            // The watch is added again when the file is created, replaced or renamed
+            if (watch < 0)
+                watch = inotify_add_watch(notify_fd, filename.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF);
+            if (watch >= 0)
+            {
+                // Short timeout so that stop() is honored quickly
+                pollfd descriptor = {notify_fd, POLLIN, 0};
+                if (poll(&descriptor, 1, 250) > 0)
+                {
+                    alignas(inotify_event) char events[4096];
+                    ssize_t length;
+                    while ((length = ::read(notify_fd, events, sizeof(events))) > 0)
+                    {
+                        for (char *p = events; p < events + length;)
+                        {
+                            const inotify_event *event = reinterpret_cast<const inotify_event *>(p);
+                            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+                            {
+                                if (!(event->mask & IN_IGNORED))
+                                    inotify_rm_watch(notify_fd, watch);
+                                watch = -1;
+                            }
+                            p += sizeof(inotify_event) + event->len;
+                        }
+                    }
+                }
+                continue;
+            }
+        }
+#endif
+        // Polling fallback
+        std::this_thread::sleep_for(std::chrono::milliseconds(250));
     }
-    else
+
+#ifdef __linux__
+    if (notify_fd >= 0)
+        ::close(notify_fd);
+#endif
+}
+
+// Parse the bytes appended since the last read; a replaced or truncated file is read from the start
+void PlotGen::LogTail::read_new_data()
+{
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0)
+        return;
+
+    unsigned long long size = static_cast<unsigned long long>(info.st_size);
+    if (static_cast<unsigned long long>(info.st_ino) != inode || size < offset)
     {
-        // Check if the text position is outside the current limits
-        if (x < fig.xmin || x > fig.xmax || y < fig.ymin || y > fig.ymax)
-        {
-            // Expand limits to include the text position with a small margin
-            double margin_x = (fig.xmax - fig.xmin) * 0.05;
-            double margin_y = (fig.ymax - fig.ymin) * 0.05;
+        inode = static_cast<unsigned long long>(info.st_ino);
+        offset = 0;
+        partial_line.clear();
+    }
+    if (size == offset)
+        return;
 
-            if (x < fig.xmin)
-                fig.xmin = x - margin_x;
-            if (x > fig.xmax)
-                fig.xmax = x + margin_x;
-            if (y < fig.ymin)
-                fig.ymin = y - margin_y;
-            if (y > fig.ymax)
-                fig.ymax = y + margin_y;
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return;
+    file.seekg(static_cast<std::streamoff>(offset));
+
+    std::vector<char> buffer(1 << 20);
+    while (running)
+    {
+        file.read(buffer.data(), buffer.size());
+        std::streamsize length = file.gcount();
+        if (length <= 0)
+            break;
+        offset += static_cast<unsigned long long>(length);
+
+        // Complete lines are parsed in place, the end of an unfinished line is kept for the next read
+        const char *p = buffer.data();
+        const char *end = p + length;
+        while (p < end)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(p, '\n', end - p));
+            if (!newline)
+            {
+                partial_line.append(p, end);
+                break;
+            }
+            if (partial_line.empty())
+            {
+                parse_line(p, newline);
+            }
+            else
+            {
+                partial_line.append(p, newline);
+                parse_line(partial_line.data(), partial_line.data() + partial_line.size());
+                partial_line.clear();
+            }
+            p = newline + 1;
         }
     }
 }
 
-// Arrow from (x1,y1) to (x2,y2)
-void PlotGen::arrow(Figure &fig, double x1, double y1, double x2, double y2, const Style &style, double head_size)
+// Split a line into fields and push its values. Lines without a numeric value in the x column
+// (headers, messages of the solver) are ignored.
+void PlotGen::LogTail::parse_line(const char *begin, const char *end)
 {
-    // Validate inputs
-    if (head_size <= 0)
+    if (end > begin && end[-1] == '\r')
+        --end;
+    while (begin < end && (*begin == ' ' || *begin == '\t'))
+        ++begin;
+    if (!columns.prefix.empty())
     {
-        throw std::invalid_argument("Arrow head size must be positive");
+        if (static_cast<size_t>(end - begin) < columns.prefix.size() ||
+            std::memcmp(begin, columns.prefix.data(), columns.prefix.size()) != 0)
+            return;
+        begin += columns.prefix.size();
     }
 
-    // First, draw the line from start to end point
-    std::vector<double> x = {x1, x2};
-    std::vector<double> y = {y1, y2};
+    int last_column = columns.x;
+    for (int column : columns.y)
+        last_column = std::max(last_column, column);
 
-    // We'll handle the line drawing here to avoid auto-adjusting axis twice
-    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+    fields.clear();
+    const char *p = begin;
+    while (p < end && static_cast<int>(fields.size()) <= last_column)
+    {
+        while (p < end && columns.delimiters.find(*p) != std::string::npos)
+            ++p;
+        if (p == end)
+            break;
+        const char *field_end = p;
+        while (field_end < end && columns.delimiters.find(*field_end) == std::string::npos)
+            ++field_end;
+
+        // The field is followed by a delimiter, '\r', '\n' or the end of partial_line, so strtod stops there
+        char *parsed_end = nullptr;
+        double value = std::strtod(p, &parsed_end);
+        fields.push_back(parsed_end == field_end ? value : std::numeric_limits<double>::quiet_NaN());
+        p = field_end;
+    }
 
-    if (using_default_limits)
+    double x = static_cast<double>(parsed_lines.load(std::memory_order_relaxed));
+    if (columns.x >= 0)
     {
-        // Auto-adjust axis limits to include the arrow with some margin
-        double x_min = std::min(x1, x2);
-        double x_max = std::max(x1, x2);
-        double y_min = std::min(y1, y2);
-        double y_max = std::max(y1, y2);
+        if (columns.x >= static_cast<int>(fields.size()) || std::isnan(fields[columns.x]))
+            return;
+        x = fields[columns.x];
+    }
 
-        // Add margin (10% of the data range or at least 1.0 unit)
-        double x_margin = std::max((x_max - x_min) * 0.1, 1.0);
-        double y_margin = std::max((y_max - y_min) * 0.1, 1.0);
+    bool any = false;
+    for (size_t k = 0; k < columns.y.size() && k < streams.size(); ++k)
+    {
+        int column = columns.y[k];
+        if (column < 0 || column >= static_cast<int>(fields.size()) || std::isnan(fields[column]))
+            continue;
+
+        // Unlike live producers, a log can wait for the renderer: no line is lost
+        while (!streams[k]->enqueue(x, fields[column]) && running)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        any = true;
+    }
+    if (any)
+        parsed_lines.fetch_add(1, std::memory_order_relaxed);
+}
 
-        fig.xmin = x_min - x_margin;
-        fig.xmax = x_max + x_margin;
-        fig.ymin = y_min - y_margin;
-        fig.ymax = y_max + y_margin;
+// Column of a CSV file by name
+std::vector<double> &PlotGen::CsvData::column(const std::string &name)
+{
+    auto found = std::find(names.begin(), names.end(), name);
+    if (found == names.end() || static_cast<size_t>(found - names.begin()) >= columns.size())
+    {
+        throw std::out_of_range("No column named " + name);
     }
+    return columns[found - names.begin()];
+}
 
-    // Store the arrow shaft as a regular 2D curve
-    fig.curves.push_back({x, y, style});
-    fig.curve_types.push_back("2D");
+// Values of a raw file: `columns` interleaved float32 or float64 values per row, after `offset` bytes
+std::shared_ptr<PlotGen::MappedArray> PlotGen::MappedArray::open_raw(const std::string &filename, const std::string &dtype,
+                                                                     size_t offset, size_t columns, size_t column)
+{
+    if (dtype != "float32" && dtype != "float64")
+    {
+        throw std::invalid_argument("Raw files must hold float32 or float64 values");
+    }
+    if (columns == 0 || column >= columns || columns > std::numeric_limits<size_t>::max() / sizeof(double))
+    {
+        throw std::out_of_range("Column index out of range");
+    }
 
-    // Store points for the arrowhead
-    // We'll calculate these in screen coordinates during rendering
-    // Just store the data points and head_size for now
-    Figure::Curve arrow_head_curve;
-    arrow_head_curve.x = {x1, x2}; // Store start and end points
-    arrow_head_curve.y = {y1, y2};
-    arrow_head_curve.style = style;
-    arrow_head_curve.head_size = head_size; // Store head size as a property
+    auto file = std::make_shared<MappedFile>(filename);
+    if (offset > file->size())
+    {
+        throw std::invalid_argument("Offset beyond the end of " + filename);
+    }
 
-    // Add the arrowhead to the figure
-    fig.curves.push_back(arrow_head_curve);
-    fig.curve_types.push_back("ARROW_HEAD");
+    std::shared_ptr<MappedArray> array(new MappedArray());
+    array->is_float32 = dtype == "float32";
+    const size_t value_size = array->is_float32 ? sizeof(float) : sizeof(double);
+    array->stride = columns * value_size;
+    array->count = (file->size() - offset) / array->stride;
+    array->base = file->data() + offset + column * value_size;
+    array->mapping = file;
+    return array;
 }
 
-// Line from (x1,y1) to (x2,y2)
-void PlotGen::line(Figure &fig, double x1, double y1, double x2, double y2, const Style &style)
+// Column of a .npy file (format versions 1 to 3). Only little-endian float32 and float64 arrays
+// with one or two dimensions are read, in C or Fortran order.
+std::shared_ptr<PlotGen::MappedArray> PlotGen::MappedArray::open_npy(const std::string &filename, size_t column)
 {
-    // Create vector of points for the line
-    std::vector<double> x = {x1, x2};
-    std::vector<double> y = {y1, y2};
+    auto file = std::make_shared<MappedFile>(filename);
+    const char *data = file->data();
+    const size_t size = file->size();
+    if (size < 10 || std::memcmp(data, "\x93NUMPY", 6) != 0)
+    {
+        throw std::runtime_error(filename + " is not a .npy file");
+    }
 
-    // Check if we need to adjust axis limits
-    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+    const unsigned char major = static_cast<unsigned char>(data[6]);
+    size_t header_start = major == 1 ? 10 : 12;
+    size_t header_size = 0;
+    if (size < header_start)
+    {
+        throw std::runtime_error("Truncated .npy header in " + filename);
+    }
+    for (size_t k = 0; k < header_start - 8; ++k)
+        header_size |= static_cast<size_t>(static_cast<unsigned char>(data[8 + k])) << (8 * k);
+    if (header_start + header_size > size)
+    {
+        throw std::runtime_error("Truncated .npy header in " + filename);
+    }
+    const std::string header(data + header_start, header_size);
 
-    if (using_default_limits)
+    // Value of a key of the header dictionary, e.g. 'descr': '<f8'
+    auto value_of = [&header, &filename](const std::string &key)
     {
-        // Auto-adjust axis limits to include the line with some margin
-        double x_min = std::min(x1, x2);
-        double x_max = std::max(x1, x2);
-        double y_min = std::min(y1, y2);
-        double y_max = std::max(y1, y2);
+        size_t position = header.find("'" + key + "'");
+        if (position == std::string::npos)
+            throw std::runtime_error("Missing " + key + " in the .npy header of " + filename);
+        position = header.find(':', position);
+        size_t end = position;
+        if (key == "shape")
+            end = header.find(')', position) + 1;
+        else
+            end = header.find_first_of(",}", position);
+        std::string value = header.substr(position + 1, end - position - 1);
+        value.erase(0, value.find_first_not_of(" '"));
+        value.erase(value.find_last_not_of(" '") + 1);
+        return value;
+    };
 
-        // Add margin (10% of the data range or at least 1.0 unit)
-        double x_margin = std::max((x_max - x_min) * 0.1, 1.0);
-        double y_margin = std::max((y_max - y_min) * 0.1, 1.0);
+    const std::string descr = value_of("descr");
+    std::shared_ptr<MappedArray> array(new MappedArray());
+    if (descr == "<f8" || descr == "=f8")
+        array->is_float32 = false;
+    else if (descr == "<f4" || descr == "=f4")
+        array->is_float32 = true;
+    else
+        throw std::invalid_argument("Unsupported .npy type " + descr + " (little-endian float32 or float64 only)");
+    const bool fortran_order = value_of("fortran_order") == "True";
 
-        // Handle the case where x_min == x_max or y_min == y_max
-        if (std::abs(x_max - x_min) < 1e-10)
+    std::vector<size_t> shape;
+    const std::string dims = value_of("shape");
+    for (size_t p = 0; p < dims.size();)
+    {
+        if (std::isdigit(static_cast<unsigned char>(dims[p])))
         {
-            x_margin = 1.0;
+            size_t end = dims.find_first_not_of("0123456789", p);
+            shape.push_back(std::stoull(dims.substr(p, end - p)));
+            p = end;
         }
-        if (std::abs(y_max - y_min) < 1e-10)
+        else
+            ++p;
+    }
+    if (shape.empty() || shape.size() > 2)
+    {
+        throw std::invalid_argument("Only 1-D and 2-D .npy arrays can be plotted");
+    }
+
+    const size_t rows = shape[0];
+    const size_t columns = shape.size() == 2 ? shape[1] : 1;
+    if (column >= columns)
+    {
+        throw std::out_of_range("Column index out of range");
+    }
+    const size_t value_size = array->is_float32 ? sizeof(float) : sizeof(double);
+    const size_t data_start = header_start + header_size;
+    // Divisions rather than the product of the shape, which a corrupt header can make overflow
+    const size_t available = size - data_start;
+    if (columns > available / value_size || rows > available / (columns * value_size))
+    {
+        throw std::runtime_error("Truncated .npy data in " + filename);
+    }
+
+    array->count = rows;
+    array->stride = fortran_order ? value_size : columns * value_size;
+    array->base = data + data_start + column * (fortran_order ? rows * value_size : value_size);
+    array->mapping = file;
+    return array;
+}
+
+// 2D curve drawn from mapped arrays without copying them. The default limits use the first and
+// last x values and the y range of at most 2^20 evenly spaced samples.
+void PlotGen::plot_mapped(Figure &fig, std::shared_ptr<MappedArray> x, std::shared_ptr<MappedArray> y, const Style &style)
+{
+    if (!y || y->size() == 0)
+    {
+        throw std::invalid_argument("The y array must not be empty");
+    }
+    if (x && x->size() != y->size())
+    {
+        throw std::invalid_argument("x and y arrays must have the same size");
+    }
+
+    const size_t n = y->size();
+    if (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10)
+    {
+        double x_min = x ? (*x)[0] : 0.0;
+        double x_max = x ? (*x)[n - 1] : static_cast<double>(n - 1);
+        double y_min = std::numeric_limits<double>::infinity(), y_max = -y_min;
+        const size_t step = std::max<size_t>(1, n >> 20);
+        for (size_t i = 0; i < n; i += step)
         {
-            y_margin = 1.0;
+            double value = (*y)[i];
+            if (std::isnan(value))
+                continue;
+            y_min = std::min(y_min, value);
+            y_max = std::max(y_max, value);
         }
+        if (!(y_max >= y_min))
+            y_min = y_max = 0;
 
+        double x_margin = std::abs(x_max - x_min) < 1e-10 ? 1.0 : (x_max - x_min) * 0.05;
+        double y_margin = std::abs(y_max - y_min) < 1e-10 ? 1.0 : (y_max - y_min) * 0.05;
         fig.xmin = x_min - x_margin;
         fig.xmax = x_max + x_margin;
         fig.ymin = y_min - y_margin;
         fig.ymax = y_max + y_margin;
     }
 
-    // Store the line as a regular 2D curve
-    fig.curves.push_back({x, y, style});
-    fig.curve_types.push_back("2D");
+    Figure::Curve curve;
+    curve.style = style;
+    curve.mapped_x = std::move(x);
+    curve.mapped_y = std::move(y);
+    fig.curves.push_back(std::move(curve));
+    fig.curve_types.push_back("MAPPED");
 }
 
-// Histogram
-void PlotGen::hist(Figure &fig, const std::vector<double> &data, int bins, const Style &style, double bar_width_ratio)
+PlotGen::CsvSource::CsvSource(const std::string &filename, int x_column, int y_column, char delimiter, bool header)
+    : filename(filename), x_column(x_column), y_column(y_column), delimiter(delimiter), header(header), buffer(1 << 20)
 {
-    if (data.empty())
+    if (y_column < 0)
     {
-        throw std::invalid_argument("data vector must not be empty");
+        throw std::invalid_argument("The y column must be a column index");
     }
+    rewind();
+}
 
-    std::vector<double> hist_x, hist_y;
-    double min_val = *std::min_element(data.begin(), data.end());
-    double max_val = *std::max_element(data.begin(), data.end());
-
-    // Protection contre le cas où min_val == max_val
-    if (std::abs(max_val - min_val) < 1e-10)
+void PlotGen::CsvSource::rewind()
+{
+    file.close();
+    file.clear();
+    file.open(filename, std::ios::binary);
+    if (!file.is_open())
     {
-        // Ajouter une petite variation pour éviter une division par zéro
-        min_val -= 0.5;
-        max_val += 0.5;
+        throw std::runtime_error("Unable to open " + filename);
     }
-
-    double bin_width = (max_val - min_val) / bins;
-
-    // Initialiser les comptages à zéro
-    std::vector<int> counts(bins, 0);
-
-    // Calculer les histogrammes
-    for (double val : data)
+    partial_line.clear();
+    if (header)
     {
-        int bin = std::min(static_cast<int>((val - min_val) / bin_width), bins - 1);
-        // Protection contre les indices négatifs
-        bin = std::max(0, bin);
-        counts[bin]++;
+        std::string line;
+        std::getline(file, line);
     }
+}
 
-    // Construire les données d'histogramme
-    for (int i = 0; i < bins; ++i)
-    {
-        hist_x.push_back(min_val + i * bin_width);
-        hist_y.push_back(static_cast<double>(counts[i]));
-    }
+// Parse the complete lines of the next blocks of the file until max_count samples are read
+bool PlotGen::CsvSource::next(std::vector<double> &x, std::vector<double> &y, size_t max_count)
+{
+    x.clear();
+    y.clear();
+    const int last_column = std::max(x_column, y_column);
+    std::vector<std::pair<const char *, const char *>> fields;
 
-    // Automatically set axis limits if they haven't been specified
-    // Check if default limits are being used
-    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+    auto parse_line = [&](const char *begin, const char *end)
+    {
+        if (end > begin && end[-1] == '\r')
+            --end;
+        if (end == begin)
+            return;
+        fields.clear();
+        while (static_cast<int>(fields.size()) <= last_column)
+        {
+            const char *next = static_cast<const char *>(std::memchr(begin, delimiter, end - begin));
+            fields.emplace_back(begin, next ? next : end);
+            if (!next)
+                break;
+            begin = next + 1;
+        }
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        y.push_back(y_column < static_cast<int>(fields.size()) ? parse_csv_field(fields[y_column].first, fields[y_column].second) : nan);
+        if (x_column >= 0)
+            x.push_back(x_column < static_cast<int>(fields.size()) ? parse_csv_field(fields[x_column].first, fields[x_column].second) : nan);
+    };
 
-    if (using_default_limits)
+    while (y.size() < max_count)
     {
-        // Set X limits to include all bars with a 5% margin
-        double x_margin = (max_val - min_val) * 0.05f;
-        fig.xmin = min_val - x_margin;
-        fig.xmax = max_val + bin_width + x_margin; // Add bin_width to see the last bar completely
+        // Lines left over from the previous block first
+        size_t start = 0;
+        while (y.size() < max_count)
+        {
+            size_t newline = partial_line.find('\n', start);
+            if (newline == std::string::npos)
+                break;
+            parse_line(partial_line.data() + start, partial_line.data() + newline);
+            start = newline + 1;
+        }
+        partial_line.erase(0, start);
+        if (y.size() >= max_count)
+            break;
 
-        // Set Y limits to include all bars with a 10% margin
-        double max_count = *std::max_element(hist_y.begin(), hist_y.end());
-        double y_margin = max_count * 0.1f;
-        fig.ymin = 0; // Histograms generally start at 0
-        fig.ymax = max_count + y_margin;
+        file.read(buffer.data(), buffer.size());
+        std::streamsize read = file.gcount();
+        if (read <= 0)
+        {
+            // Last line without a newline
+            if (!partial_line.empty())
+            {
+                parse_line(partial_line.data(), partial_line.data() + partial_line.size());
+                partial_line.clear();
+            }
+            break;
+        }
+        partial_line.append(buffer.data(), static_cast<size_t>(read));
     }
-
-    // Create a curve with the specified bar width ratio
-    Figure::Curve curve = {hist_x, hist_y, style};
-    curve.bar_width_ratio = bar_width_ratio; // Apply bar width ratio
-
-    fig.curves.push_back(curve);
-    fig.curve_types.push_back("HIST");
+    return !y.empty();
 }
 
-// Polar plot
-void PlotGen::polar_plot(Figure &fig, const std::vector<double> &theta, const std::vector<double> &r, const Style &style)
+PlotGen::MappedSource::MappedSource(std::shared_ptr<MappedArray> x, std::shared_ptr<MappedArray> y)
+    : x_array(std::move(x)), y_array(std::move(y))
 {
-    if (theta.size() != r.size() || theta.empty())
+    if (!y_array)
     {
-        throw std::invalid_argument("theta and r vectors must have the same size and not be empty");
+        throw std::invalid_argument("The y array must not be null");
     }
-
-    // Mark the figure as being in polar coordinates
-    fig.is_polar = true;
-
-    // Find the maximum radius to adapt the graph limits
-    double max_r = *std::max_element(r.begin(), r.end());
-
-    // Check if we're using default limits
-    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
-
-    // If the limits haven't been explicitly set or are default, calculate them automatically
-    if (using_default_limits)
+    if (x_array && x_array->size() != y_array->size())
     {
-        // Add a 10% margin for better visualization
-        set_polar_axis_limits(fig, max_r * 1.1f);
+        throw std::invalid_argument("x and y arrays must have the same size");
     }
-    else
+}
+
+bool PlotGen::MappedSource::next(std::vector<double> &x, std::vector<double> &y, size_t max_count)
+{
+    const size_t count = std::min(max_count, y_array->size() - position);
+    x.resize(x_array ? count : 0);
+    y.resize(count);
+    for (size_t i = 0; i < count; ++i)
     {
-        // Check if current limits are sufficient to contain all data
-        // and if they respect polar graph constraints (axes of same dimension)
-        double current_range_x = (fig.xmax - fig.xmin) / 2;
-        double current_range_y = (fig.ymax - fig.ymin) / 2;
-        double needed_range = max_r * 1.1f;
+        y[i] = (*y_array)[position + i];
+        if (x_array)
+            x[i] = (*x_array)[position + i];
+    }
+    position += count;
+    return count > 0;
+}
 
-        // Ensure axes have the same scale
-        double max_range = std::max(current_range_x, current_range_y);
+// Read all the chunks of a source from the start. The next chunk is read on a worker thread while
+// the current one is consumed; samples without x values are numbered.
+void PlotGen::for_each_chunk(DataSource &source, size_t chunk_size,
+                             const std::function<void(const std::vector<double> &, const std::vector<double> &)> &consume)
+{
+    chunk_size = std::max<size_t>(1, chunk_size);
+    source.rewind();
+
+    std::vector<double> x[2], y[2];
+    size_t current = 0;
+    size_t first_index = 0;
+    bool more = source.next(x[0], y[0], chunk_size);
+    while (more)
+    {
+        const size_t ahead = 1 - current;
+        std::future<bool> next_chunk = std::async(std::launch::async, [&source, &x, &y, ahead, chunk_size]()
+                                                  { return source.next(x[ahead], y[ahead], chunk_size); });
 
-        if (needed_range > max_range || std::abs(current_range_x - current_range_y) > 1e-6)
+        std::vector<double> &cx = x[current];
+        const std::vector<double> &cy = y[current];
+        if (cx.empty())
         {
-            // Use set_polar_axis_limits to ensure axes of same dimension
-            double max_limit = std::max(needed_range, max_range);
-            set_polar_axis_limits(fig, max_limit);
+            cx.resize(cy.size());
+            for (size_t i = 0; i < cy.size(); ++i)
+                cx[i] = static_cast<double>(first_index + i);
         }
-    }
+        else if (cx.size() != cy.size())
+        {
+            next_chunk.wait();
+            throw std::runtime_error("The data source returned x and y chunks of different sizes");
+        }
+        first_index += cy.size();
 
-    // Convert to Cartesian coordinates for display
-    std::vector<double> x, y;
-    for (size_t i = 0; i < theta.size(); ++i)
-    {
-        x.push_back(r[i] * std::cos(theta[i]));
-        y.push_back(r[i] * std::sin(theta[i]));
+        try
+        {
+            consume(cx, cy);
+        }
+        catch (...)
+        {
+            next_chunk.wait();
+            throw;
+        }
+        more = next_chunk.get();
+        current = ahead;
     }
-
-    fig.curves.push_back({x, y, style});
-    fig.curve_types.push_back("POLAR");
 }
 
-// Display and render
-void PlotGen::show()
+// Extent of the finite x and y values of a source; false if it has none
+bool PlotGen::source_bounds(DataSource &source, size_t chunk_size, double &xmin, double &xmax, double &ymin, double &ymax)
 {
-
-#ifdef HAVE_GTK_WEBKIT
-    show_with_viewer();
-#else
-    showSFML();
-#endif
+    xmin = ymin = std::numeric_limits<double>::infinity();
+    xmax = ymax = -std::numeric_limits<double>::infinity();
+    for_each_chunk(source, chunk_size, [&](const std::vector<double> &x, const std::vector<double> &y)
+                   {
+        for (size_t i = 0; i < x.size(); ++i)
+        {
+            if (std::isfinite(x[i]))
+            {
+                xmin = std::min(xmin, x[i]);
+                xmax = std::max(xmax, x[i]);
+            }
+            if (std::isfinite(y[i]))
+            {
+                ymin = std::min(ymin, y[i]);
+                ymax = std::max(ymax, y[i]);
+            }
+        } });
+    return xmax >= xmin && ymax >= ymin;
 }
 
-// Méthode privée pour l'affichage SFML original
-void PlotGen::showSFML()
+// Line of a source of any size: the samples are aggregated per pixel column of the plot area
+// (first, last, lowest and highest), so the curve has at most four points per column
+void PlotGen::plot_source(Figure &fig, DataSource &source, const Style &style, size_t chunk_size)
 {
-    // Effectuer le rendu
-    render();
-
-    // Créer la fenêtre seulement lorsque show() est explicitement appelé
-    sf::ContextSettings settings;
-    settings.antialiasingLevel = 8;
-    window.create(sf::VideoMode(width, height), "PlotGen", sf::Style::Default, settings);
-
-    // Configurer le sprite
-    sprite.setTexture(texture.getTexture());
+    if (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10)
+    {
+        double x_min, x_max, y_min, y_max;
+        if (!source_bounds(source, chunk_size, x_min, x_max, y_min, y_max))
+        {
+            throw std::invalid_argument("The data source has no finite samples");
+        }
+        // 5% margin, as for plot()
+        double x_margin = std::abs(x_max - x_min) < 1e-10 ? 1.0 : (x_max - x_min) * 0.05;
+        double y_margin = std::abs(y_max - y_min) < 1e-10 ? 1.0 : (y_max - y_min) * 0.05;
+        fig.xmin = x_min - x_margin;
+        fig.xmax = x_max + x_margin;
+        fig.ymin = y_min - y_margin;
+        fig.ymax = y_max + y_margin;
+    }
 
-    // Main loop
-    while (window.isOpen())
+    unsigned int pixels, pixels_y;
+    plot_area_size(fig, pixels, pixels_y);
+    struct Column
     {
-        sf::Event event;
-        while (window.pollEvent(event))
+        bool used = false;
+        double first_x, first_y, last_x, last_y, low_x, low_y, high_x, high_y;
+    };
+    std::vector<Column> columns(pixels);
+    const double x0 = fig.xmin;
+    const double scale = pixels / (fig.xmax - fig.xmin);
+
+    for_each_chunk(source, chunk_size, [&](const std::vector<double> &x, const std::vector<double> &y)
+                   {
+        for (size_t i = 0; i < x.size(); ++i)
         {
-            if (event.type == sf::Event::Closed)
-                window.close();
-            else if (event.type == sf::Event::KeyPressed)
+            double fx = (x[i] - x0) * scale;
+            // Also rejects NaN coordinates
+            if (!(fx >= 0 && fx < pixels) || std::isnan(y[i]))
+                continue;
+            Column &column = columns[static_cast<size_t>(fx)];
+            if (!column.used)
             {
-                if (event.key.code == sf::Keyboard::Escape)
-                    window.close();
+                column = {true, x[i], y[i], x[i], y[i], x[i], y[i], x[i], y[i]};
+                continue;
             }
-        }
+            if (x[i] < column.first_x)
+            {
+                column.first_x = x[i];
+                column.first_y = y[i];
+            }
+            if (x[i] >= column.last_x)
+            {
+                column.last_x = x[i];
+                column.last_y = y[i];
+            }
+            if (y[i] < column.low_y)
+            {
+                column.low_x = x[i];
+                column.low_y = y[i];
+            }
+            if (y[i] > column.high_y)
+            {
+                column.high_x = x[i];
+                column.high_y = y[i];
+            }
+        } });
 
-        // Render and display
-        window.clear(sf::Color::White);
-        window.draw(sprite);
-        window.display();
+    Figure::Curve curve;
+    curve.style = style;
+    for (const Column &column : columns)
+    {
+        if (!column.used)
+            continue;
+        std::pair<double, double> points[4] = {{column.first_x, column.first_y}, {column.low_x, column.low_y},
+                                               {column.high_x, column.high_y}, {column.last_x, column.last_y}};
+        std::stable_sort(points, points + 4, [](const std::pair<double, double> &a, const std::pair<double, double> &b)
+                         { return a.first < b.first; });
+        for (int j = 0; j < 4; ++j)
+        {
+            if (j > 0 && points[j] == points[j - 1])
+                continue;
+            curve.x.push_back(points[j].first);
+            curve.y.push_back(points[j].second);
+        }
+    }
+    if (curve.x.empty())
+    {
+        throw std::invalid_argument("The data source has no samples within the x limits");
     }
+    add_curve(fig, std::move(curve));
 }
 
-std::string PlotGen::get_svg_in_html(const std::string &svg_filename)
+// Histogram of the y values of a source of any size
+void PlotGen::hist_source(Figure &fig, DataSource &source, int bins, const Style &style, double bar_width_ratio, size_t chunk_size)
 {
-    // Lire le contenu du fichier SVG
-    std::ifstream svg_file(svg_filename);
-    if (!svg_file.is_open())
+    if (bins <= 0)
     {
-        std::cerr << "Erreur: Impossible d'ouvrir le fichier SVG" << std::endl;
-        return "";
+        throw std::invalid_argument("The number of bins must be positive");
     }
 
-    std::stringstream buffer;
-    buffer << svg_file.rdbuf();
-    svg_file.close();
+    double x_min, x_max, min_val, max_val;
+    if (!source_bounds(source, chunk_size, x_min, x_max, min_val, max_val))
+    {
+        throw std::invalid_argument("The data source has no finite samples");
+    }
+    // Protection contre le cas où min_val == max_val
+    if (std::abs(max_val - min_val) < 1e-10)
+    {
+        min_val -= 0.5;
+        max_val += 0.5;
+    }
 
-    // Créer le contenu HTML
-    std::string html_content = "<!DOCTYPE html>\n"
-                               "<html>\n"
-                               "<head>\n"
-                               "    <meta charset=\"UTF-8\">\n"
-                               "    <title>PlotGenC++ - Visualisation SVG</title>\n"
-                               "    <style>\n"
-                               "        body { margin: 0; padding: 0; overflow: hidden; background-color: #f0f0f0; }\n"
-                               "        #svg-container { width: 100vw; height: 100vh; display: flex; justify-content: center; align-items: center; }\n"
-                               "        #controls { position: fixed; bottom: 10px; left: 10px; background: rgba(255,255,255,0.8); padding: 10px; border-radius: 5px; }\n"
-                               "        svg { max-width: 95%; max-height: 95%; background-color: white; box-shadow: 0 0 10px rgba(0,0,0,0.2); }\n"
-                               "    </style>\n"
-                               "</head>\n"
-                               "<body>\n"
-                               "    <div id=\"svg-container\">\n" +
-                               buffer.str() + "\n"
-                                              "    </div>\n"
-                                              "    <div id=\"controls\">\n"
-                                              "        <button onclick=\"window.close()\">Fermer</button>\n"
-                                              "        <button onclick=\"saveSvg()\">Télécharger SVG</button>\n"
-                                              "    </div>\n"
-                                              "    <script>\n"
-                                              "        function saveSvg() {\n"
-                                              "            const link = document.createElement('a');\n"
-                                              "            link.href = '" +
-                               svg_filename + "';\n"
-                                              "            link.download = '" +
-                               svg_filename + "';\n"
-                                              "            document.body.appendChild(link);\n"
-                                              "            link.click();\n"
-                                              "            document.body.removeChild(link);\n"
-                                              "        }\n"
-                                              "        document.addEventListener('keydown', function(e) {\n"
-                                              "            if (e.key === 'Escape') window.close();\n"
-                                              "        });\n"
-                                              "    </script>\n"
-                                              "</body>\n"
-                                              "</html>";
+    const double bin_width = (max_val - min_val) / bins;
+    std::vector<size_t> counts(bins, 0);
+    for_each_chunk(source, chunk_size, [&](const std::vector<double> &, const std::vector<double> &y)
+                   {
+        for (double val : y)
+        {
+            if (!std::isfinite(val))
+                continue;
+            int bin = std::min(static_cast<int>((val - min_val) / bin_width), bins - 1);
+            counts[std::max(0, bin)]++;
+        } });
 
-    return html_content;
+    add_histogram(fig, min_val, max_val, counts, style, bar_width_ratio);
 }
 
-// Save
-void PlotGen::save(const std::string &filename)
+// Density scatter plot (count per pixel) of a source of any size
+void PlotGen::scatter_density_source(Figure &fig, DataSource &source, const std::string &normalization, const Style &style,
+                                     size_t chunk_size)
 {
-    render(); // Ensure the rendering is up to date
-
-    // Vérifier si c'est un fichier SVG et utiliser l'export vectoriel
-    if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".svg") == 0)
+    require_linear_y(fig);
+    double x_min, x_max, y_min, y_max;
+    if (!source_bounds(source, chunk_size, x_min, x_max, y_min, y_max))
     {
-        save_svg(filename);
-        return;
+        throw std::invalid_argument("The data source has no finite samples");
     }
 
-    sf::Image screenshot = texture.getTexture().copyToImage();
+    Figure::Curve curve;
+    curve.style = style;
+    curve.aggregation = "count";
+    curve.normalization = normalization;
+    prepare_density_grid(fig, curve, x_min, x_max, y_min, y_max);
+
+    std::vector<std::vector<uint32_t>> counts;
+    std::vector<std::vector<double>> sums;
+    for_each_chunk(source, chunk_size, [&](const std::vector<double> &x, const std::vector<double> &y)
+                   { accumulate_density(curve, x.data(), y.data(), nullptr, x.size(), counts, sums); });
+    merge_density(curve, counts, sums, false);
+
+    fig.curves.push_back(std::move(curve));
+    fig.curve_types.push_back("DENSITY");
+}
+
+// The file is memory-mapped and split by parallel_chunks() into byte ranges; each range handles the
+// lines starting in it. A first pass counts the lines of each range, so that the second pass can
+// parse them in parallel directly into their rows of the columns.
+PlotGen::CsvData PlotGen::load_csv(const std::string &filename, char delimiter, bool header)
+{
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file(filename);
+    const char *const data = file.data();
+    const char *const limit = data + file.size();
+
+    CsvData csv;
+    csv.bytes = file.size();
 
-    if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".png") == 0)
+    // Call fn(begin, end) for each non-empty line starting in [from, to) of the file
+    auto for_each_line = [data, limit](const char *from, const char *to, auto &&fn)
     {
-        if (!screenshot.saveToFile(filename))
+        const char *p = from;
+        if (p > data && p[-1] != '\n')
         {
-            throw std::runtime_error("Unable to save image in PNG format");
+            p = static_cast<const char *>(std::memchr(p, '\n', limit - p));
+            p = p ? p + 1 : limit;
         }
-    }
-    else if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".jpg") == 0)
+        while (p < to)
+        {
+            const char *newline = static_cast<const char *>(std::memchr(p, '\n', limit - p));
+            const char *end = newline ? newline : limit;
+            if (end > p && end[-1] == '\r')
+                --end;
+            if (end > p)
+                fn(p, end);
+            p = newline ? newline + 1 : limit;
+        }
+    };
+
+    auto split = [delimiter](const char *begin, const char *end, auto &&fn)
     {
-        // Conversion for stb_image_write with high quality
-        std::vector<unsigned char> pixels(width * height * 3); // RGB
-        for (unsigned int y = 0; y < height; ++y)
+        while (true)
         {
-            for (unsigned int x = 0; x < width; ++x)
-            {
-                sf::Color c = screenshot.getPixel(x, y);
-                size_t index = (y * width + x) * 3;
-                pixels[index] = c.r;
-                pixels[index + 1] = c.g;
-                pixels[index + 2] = c.b;
-            }
+            const char *next = static_cast<const char *>(std::memchr(begin, delimiter, end - begin));
+            fn(begin, next ? next : end);
+            if (!next)
+                break;
+            begin = next + 1;
         }
+    };
 
-        // Write JPG image with 95% quality (better quality)
-        if (!stbi_write_jpg(filename.c_str(), width, height, 3, pixels.data(), 95))
+    // Header line, or first line for the number of columns
+    const char *body = data;
+    size_t column_count = 0;
+    for (const char *p = data; p < limit && column_count == 0;)
+    {
+        const char *newline = static_cast<const char *>(std::memchr(p, '\n', limit - p));
+        const char *end = newline ? newline : limit;
+        if (end > p && end[-1] == '\r')
+            --end;
+        if (end > p)
         {
-            throw std::runtime_error("Unable to save image in JPG format");
+            split(p, end, [&](const char *field, const char *field_end)
+            {
+                ++column_count;
+                if (header)
+                {
+                    trim_field(field, field_end);
+                    csv.names.emplace_back(field, field_end);
+                }
+            });
+            if (header)
+                body = newline ? newline + 1 : limit;
         }
+        p = newline ? newline + 1 : limit;
     }
-    else
-    {
+    csv.columns.resize(column_count);
+
+    const size_t body_size = static_cast<size_t>(limit - body);
+    const size_t min_chunk = 1 << 20;
+    const size_t max_workers = std::max(1u, std::thread::hardware_concurrency());
+
+    // First pass: number of lines of each range
+    std::vector<size_t> line_counts(max_workers + 1, 0);
+    parallel_chunks(body_size, min_chunk, [&](size_t begin, size_t end, unsigned int worker)
+    {
+        size_t count = 0;
+        for_each_line(body + begin, body + end, [&count](const char *, const char *) { ++count; });
+        line_counts[worker + 1] = count;
+    });
+    for (size_t w = 1; w < line_counts.size(); ++w)
+        line_counts[w] += line_counts[w - 1];
+    csv.rows = line_counts.back();
+
+    for (auto &column : csv.columns)
+        column.resize(csv.rows);
+
+    // Second pass: parse each range into its rows
+    parallel_chunks(body_size, min_chunk, [&](size_t begin, size_t end, unsigned int worker)
+    {
+        size_t row = line_counts[worker];
+        for_each_line(body + begin, body + end, [&](const char *line, const char *line_end)
+        {
+            size_t column = 0;
+            split(line, line_end, [&](const char *field, const char *field_end)
+            {
+                if (column < column_count)
+                    csv.columns[column][row] = parse_csv_field(field, field_end);
+                ++column;
+            });
+            for (; column < column_count; ++column)
+                csv.columns[column][row] = std::numeric_limits<double>::quiet_NaN();
+            ++row;
+        });
+    });
+
+    csv.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    csv.gb_per_second = csv.seconds > 0 ? csv.bytes / csv.seconds / 1e9 : 0;
+    std::cout << "CSV loaded from " << filename << ": " << csv.rows << " rows x " << column_count << " columns in "
+              << csv.seconds << " s (" << csv.gb_per_second << " GB/s)" << std::endl;
+    return csv;
+}
+
+// Circle with center (x0, y0) and radius r
+void PlotGen::circle(Figure &fig, double x0, double y0, double r, const Style &style)
+{
+    // Validation du rayon
+    if (r <= 0)
+    {
+        throw std::invalid_argument("Circle radius must be positive");
+    }
+
+    // Générer les points du cercle en utilisant les équations paramétriques
+    const int num_points = 100; // Nombre de points pour dessiner le cercle
+    std::vector<double> x(num_points), y(num_points);
+
+    for (int i = 0; i < num_points; ++i)
+    {
+        double angle = 2.0 * M_PI * i / (num_points - 1);
+        x[i] = x0 + r * std::cos(angle);
+        y[i] = y0 + r * std::sin(angle);
+    }
+
+    // Activer l'option equal_axes pour garantir que le cercle est bien rond
+    bool was_equal = fig.equal_axes;
+    fig.equal_axes = true;
+
+    // Vérifier si les limites d'axes existantes sont suffisantes
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    if (using_default_limits)
+    {
+        // Définir de nouvelles limites d'axes pour bien voir le cercle avec une marge
+        double margin = r * 0.2; // 20% de marge autour du cercle
+        fig.xmin = x0 - r - margin;
+        fig.xmax = x0 + r + margin;
+        fig.ymin = y0 - r - margin;
+        fig.ymax = y0 + r + margin;
+    }
+    else
+    {
+        // Vérifier si le cercle est visible dans les limites actuelles
+        double min_x = x0 - r;
+        double max_x = x0 + r;
+        double min_y = y0 - r;
+        double max_y = y0 + r;
+
+        // Étendre les limites si nécessaire
+        if (min_x < fig.xmin)
+            fig.xmin = min_x - r * 0.1;
+        if (max_x > fig.xmax)
+            fig.xmax = max_x + r * 0.1;
+        if (min_y < fig.ymin)
+            fig.ymin = min_y - r * 0.1;
+        if (max_y > fig.ymax)
+            fig.ymax = max_y + r * 0.1;
+    }
+
+    // Tracer le cercle comme une courbe normale
+    plot(fig, x, y, style);
+
+    // Restaurer l'état précédent de equal_axes si nécessaire
+    fig.equal_axes = was_equal;
+}
+
+// Arc centered at (x0, y0) from angle1 to angle2 (in radians) with radius r
+void PlotGen::arc(Figure &fig, double x0, double y0, double r, double angle1, double angle2, const Style &style, int num_points)
+{
+    // Validate inputs
+    if (r <= 0)
+    {
+        throw std::invalid_argument("Arc radius must be positive");
+    }
+
+    if (num_points < 2)
+    {
+        throw std::invalid_argument("Number of points must be at least 2");
+    }
+
+    // Ensure angle1 is less than angle2
+    if (angle1 > angle2)
+    {
+        std::swap(angle1, angle2);
+    }
+
+    // Generate points for the arc using parametric equations
+    std::vector<double> x(num_points), y(num_points);
+
+    for (int i = 0; i < num_points; ++i)
+    {
+        double angle = angle1 + (angle2 - angle1) * i / (num_points - 1);
+        x[i] = x0 + r * std::cos(angle);
+        y[i] = y0 + r * std::sin(angle);
+    }
+
+    // Check if we need to adjust axis limits
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    if (using_default_limits)
+    {
+        // Calculate arc bounds
+        double min_x = x0 - r;
+        double max_x = x0 + r;
+        double min_y = y0 - r;
+        double max_y = y0 + r;
+
+        // Add margin (20% of radius)
+        double margin = r * 0.2;
+
+        fig.xmin = min_x - margin;
+        fig.xmax = max_x + margin;
+        fig.ymin = min_y - margin;
+        fig.ymax = max_y + margin;
+
+        // Use equal_axes to maintain circular appearance
+        fig.equal_axes = true;
+    }
+    else
+    {
+        // Check if the arc fits within current limits
+        double min_x = x0 + r * std::min(std::cos(angle1), std::cos(angle2));
+        double max_x = x0 + r * std::max(std::cos(angle1), std::cos(angle2));
+        double min_y = y0 + r * std::min(std::sin(angle1), std::sin(angle2));
+        double max_y = y0 + r * std::max(std::sin(angle1), std::sin(angle2));
+
+        // Also check extreme points (0, π/2, π, 3π/2) if they fall within the angle range
+        if (angle1 <= 0 && angle2 >= 0)
+            max_x = std::max(max_x, x0 + r);
+        if (angle1 <= M_PI / 2 && angle2 >= M_PI / 2)
+            max_y = std::max(max_y, y0 + r);
+        if (angle1 <= M_PI && angle2 >= M_PI)
+            min_x = std::min(min_x, x0 - r);
+        if (angle1 <= 3 * M_PI / 2 && angle2 >= 3 * M_PI / 2)
+            min_y = std::min(min_y, y0 - r);
+
+        // Extend limits if needed
+        if (min_x < fig.xmin)
+            fig.xmin = min_x - r * 0.1;
+        if (max_x > fig.xmax)
+            fig.xmax = max_x + r * 0.1;
+        if (min_y < fig.ymin)
+            fig.ymin = min_y - r * 0.1;
+        if (max_y > fig.ymax)
+            fig.ymax = max_y + r * 0.1;
+    }
+
+    // Store the arc as a 2D curve
+    fig.curves.push_back(make_curve(x, y, style));
+    fig.curve_types.push_back("2D");
+}
+
+// Text at a specific position (x, y) in data coordinates
+void PlotGen::text(Figure &fig, double x, double y, const std::string &text_content, const Style &style)
+{
+    if (text_content.empty())
+    {
+        return; // Nothing to render
+    }
+
+    // Create a new data structure for storing the text position and content
+    // We'll use the plot method's data structures but modify the type
+    std::vector<double> x_pos = {x};
+    std::vector<double> y_pos = {y};
+
+    // Store the text content in the curve structure, but mark it with a special type
+    // We'll use the "TEXT" type to distinguish it from other curve types
+    Figure::Curve text_curve = {x_pos, y_pos, style};
+    text_curve.text_content = text_content; // We'll need to add this field to the Curve struct
+
+    fig.curves.push_back(text_curve);
+    fig.curve_types.push_back("TEXT");
+
+    // Check if we need to adjust the axis limits to include the text position
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+    if (using_default_limits)
+    {
+        // If using default limits, adjust to include the text position with a margin
+        double margin_x = std::abs(x) * 0.2 + 1.0; // 20% margin or at least 1.0 unit
+        double margin_y = std::abs(y) * 0.2 + 1.0;
+
+        fig.xmin = std::min(fig.xmin, x - margin_x);
+        fig.xmax = std::max(fig.xmax, x + margin_x);
+        fig.ymin = std::min(fig.ymin, y - margin_y);
+        fig.ymax = std::max(fig.ymax, y + margin_y);
+    }
+    else
+    {
+        // Check if the text position is outside the current limits
+        if (x < fig.xmin || x > fig.xmax || y < fig.ymin || y > fig.ymax)
+        {
+            // Expand limits to include the text position with a small margin
+            double margin_x = (fig.xmax - fig.xmin) * 0.05;
+            double margin_y = (fig.ymax - fig.ymin) * 0.05;
+
+            if (x < fig.xmin)
+                fig.xmin = x - margin_x;
+            if (x > fig.xmax)
+                fig.xmax = x + margin_x;
+            if (y < fig.ymin)
+                fig.ymin = y - margin_y;
+            if (y > fig.ymax)
+                fig.ymax = y + margin_y;
+        }
+    }
+}
+
+// Arrow from (x1,y1) to (x2,y2)
+void PlotGen::arrow(Figure &fig, double x1, double y1, double x2, double y2, const Style &style, double head_size)
+{
+    // Validate inputs
+    if (head_size <= 0)
+    {
+        throw std::invalid_argument("Arrow head size must be positive");
+    }
+
+    // First, draw the line from start to end point
+    std::vector<double> x = {x1, x2};
+    std::vector<double> y = {y1, y2};
+
+    // We'll handle the line drawing here to avoid auto-adjusting axis twice
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    if (using_default_limits)
+    {
+        // Auto-adjust axis limits to include the arrow with some margin
+        double x_min = std::min(x1, x2);
+        double x_max = std::max(x1, x2);
+        double y_min = std::min(y1, y2);
+        double y_max = std::max(y1, y2);
+
+        // Add margin (10% of the data range or at least 1.0 unit)
+        double x_margin = std::max((x_max - x_min) * 0.1, 1.0);
+        double y_margin = std::max((y_max - y_min) * 0.1, 1.0);
+
+        fig.xmin = x_min - x_margin;
+        fig.xmax = x_max + x_margin;
+        fig.ymin = y_min - y_margin;
+        fig.ymax = y_max + y_margin;
+    }
+
+    // Store the arrow shaft as a regular 2D curve
+    fig.curves.push_back(make_curve(x, y, style));
+    fig.curve_types.push_back("2D");
+
+    // Store points for the arrowhead
+    // We'll calculate these in screen coordinates during rendering
+    // Just store the data points and head_size for now
+    Figure::Curve arrow_head_curve;
+    arrow_head_curve.x = {x1, x2}; // Store start and end points
+    arrow_head_curve.y = {y1, y2};
+    arrow_head_curve.style = style;
+    arrow_head_curve.head_size = head_size; // Store head size as a property
+
+    // Add the arrowhead to the figure
+    fig.curves.push_back(arrow_head_curve);
+    fig.curve_types.push_back("ARROW_HEAD");
+}
+
+// Line from (x1,y1) to (x2,y2)
+void PlotGen::line(Figure &fig, double x1, double y1, double x2, double y2, const Style &style)
+{
+    // Create vector of points for the line
+    std::vector<double> x = {x1, x2};
+    std::vector<double> y = {y1, y2};
+
+    // Check if we need to adjust axis limits
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    if (using_default_limits)
+    {
+        // Auto-adjust axis limits to include the line with some margin
+        double x_min = std::min(x1, x2);
+        double x_max = std::max(x1, x2);
+        double y_min = std::min(y1, y2);
+        double y_max = std::max(y1, y2);
+
+        // Add margin (10% of the data range or at least 1.0 unit)
+        double x_margin = std::max((x_max - x_min) * 0.1, 1.0);
+        double y_margin = std::max((y_max - y_min) * 0.1, 1.0);
+
+        // Handle the case where x_min == x_max or y_min == y_max
+        if (std::abs(x_max - x_min) < 1e-10)
+        {
+            x_margin = 1.0;
+        }
+        if (std::abs(y_max - y_min) < 1e-10)
+        {
+            y_margin = 1.0;
+        }
+
+        fig.xmin = x_min - x_margin;
+        fig.xmax = x_max + x_margin;
+        fig.ymin = y_min - y_margin;
+        fig.ymax = y_max + y_margin;
+    }
+
+    // Store the line as a regular 2D curve
+    fig.curves.push_back(make_curve(x, y, style));
+    fig.curve_types.push_back("2D");
+}
+
+// Histogram
+void PlotGen::hist(Figure &fig, const std::vector<double> &data, int bins, const Style &style, double bar_width_ratio)
+{
+    if (data.empty())
+    {
+        throw std::invalid_argument("data vector must not be empty");
+    }
+
+    double min_val = *std::min_element(data.begin(), data.end());
+    double max_val = *std::max_element(data.begin(), data.end());
+
+    // Protection contre le cas où min_val == max_val
+    if (std::abs(max_val - min_val) < 1e-10)
+    {
+        // Ajouter une petite variation pour éviter une division par zéro
+        min_val -= 0.5;
+        max_val += 0.5;
+    }
+
+    double bin_width = (max_val - min_val) / bins;
+
+    // Initialiser les comptages à zéro
+    std::vector<size_t> counts(bins, 0);
+
+    // Calculer les histogrammes
+    for (double val : data)
+    {
+        int bin = std::min(static_cast<int>((val - min_val) / bin_width), bins - 1);
+        // Protection contre les indices négatifs
+        bin = std::max(0, bin);
+        counts[bin]++;
+    }
+
+    add_histogram(fig, min_val, max_val, counts, style, bar_width_ratio);
+}
+
+// Add a "HIST" curve from the counts of bins of equal width between min_val and max_val
+void PlotGen::add_histogram(Figure &fig, double min_val, double max_val, const std::vector<size_t> &counts,
+                            const Style &style, double bar_width_ratio)
+{
+    require_linear_y(fig);
+    const int bins = static_cast<int>(counts.size());
+    double bin_width = (max_val - min_val) / bins;
+
+    // Construire les données d'histogramme
+    std::vector<double> hist_x, hist_y;
+    for (int i = 0; i < bins; ++i)
+    {
+        hist_x.push_back(min_val + i * bin_width);
+        hist_y.push_back(static_cast<double>(counts[i]));
+    }
+
+    // Automatically set axis limits if they haven't been specified
+    // Check if default limits are being used
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    if (using_default_limits)
+    {
+        // Set X limits to include all bars with a 5% margin
+        double x_margin = (max_val - min_val) * 0.05f;
+        fig.xmin = min_val - x_margin;
+        fig.xmax = max_val + bin_width + x_margin; // Add bin_width to see the last bar completely
+
+        // Set Y limits to include all bars with a 10% margin
+        double max_count = *std::max_element(hist_y.begin(), hist_y.end());
+        double y_margin = max_count * 0.1f;
+        fig.ymin = 0; // Histograms generally start at 0
+        fig.ymax = max_count + y_margin;
+    }
+
+    // Create a curve with the specified bar width ratio
+    Figure::Curve curve = {hist_x, hist_y, style};
+    curve.bar_width_ratio = bar_width_ratio; // Apply bar width ratio
+
+    fig.curves.push_back(curve);
+    fig.curve_types.push_back("HIST");
+}
+
+// Scatter plot with per-point color values and sizes
+void PlotGen::scatter(Figure &fig, const std::vector<double> &x, const std::vector<double> &y,
+                      const std::vector<double> &color_values, const std::vector<double> &sizes, const Style &style)
+{
+    scatter(fig, std::vector<double>(x), std::vector<double>(y), color_values, sizes, style);
+}
+
+void PlotGen::scatter(Figure &fig, std::vector<double> &&x, std::vector<double> &&y,
+                      const std::vector<double> &color_values, const std::vector<double> &sizes, const Style &style)
+{
+    if (x.size() != y.size() || x.empty())
+    {
+        throw std::invalid_argument("x and y vectors must have the same size and not be empty");
+    }
+    if (!color_values.empty() && color_values.size() != x.size())
+    {
+        throw std::invalid_argument("color_values must be empty or have the same size as x and y");
+    }
+    if (!sizes.empty() && sizes.size() != x.size())
+    {
+        throw std::invalid_argument("sizes must be empty or have the same size as x and y");
+    }
+
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    if (using_default_limits)
+    {
+        auto x_range = std::minmax_element(x.begin(), x.end());
+        auto y_range = std::minmax_element(y.begin(), y.end());
+
+        // 5% margin, as for plot()
+        double x_margin = std::abs(*x_range.second - *x_range.first) < 1e-10 ? 1.0 : (*x_range.second - *x_range.first) * 0.05;
+        double y_margin = std::abs(*y_range.second - *y_range.first) < 1e-10 ? 1.0 : (*y_range.second - *y_range.first) * 0.05;
+
+        fig.xmin = *x_range.first - x_margin;
+        fig.xmax = *x_range.second + x_margin;
+        fig.ymin = *y_range.first - y_margin;
+        fig.ymax = *y_range.second + y_margin;
+    }
+
+    Figure::Curve curve;
+    curve.x = std::move(x);
+    curve.y = std::move(y);
+    curve.style = style;
+    // Markers only, circles unless another symbol was requested
+    curve.style.line_style = "none";
+    if (curve.style.symbol_type == "none")
+        curve.style.symbol_type = "circle";
+
+    curve.color_values = color_values;
+    curve.sizes = sizes;
+    if (!color_values.empty())
+    {
+        check_colormap(curve.style.colormap);
+        // Range of the finite values, NaN comparisons would make minmax_element return any element
+        curve.color_min = std::numeric_limits<double>::infinity();
+        curve.color_max = -std::numeric_limits<double>::infinity();
+        for (double v : color_values)
+        {
+            if (std::isfinite(v))
+            {
+                curve.color_min = std::min(curve.color_min, v);
+                curve.color_max = std::max(curve.color_max, v);
+            }
+        }
+        if (curve.color_min > curve.color_max)
+        {
+            std::cerr << "WARNING: No finite color value, using the range [0, 1]." << std::endl;
+            curve.color_min = 0.0;
+            curve.color_max = 1.0;
+        }
+    }
+
+    fig.curves.push_back(std::move(curve));
+    fig.curve_types.push_back("SCATTER");
+}
+
+// Density scatter plot (count per pixel)
+void PlotGen::scatter_density(Figure &fig, const std::vector<double> &x, const std::vector<double> &y,
+                              const std::string &normalization, const Style &style)
+{
+    require_linear_y(fig);
+    if (x.size() != y.size() || x.empty())
+    {
+        throw std::invalid_argument("x and y vectors must have the same size and not be empty");
+    }
+
+    Figure::Curve curve;
+    curve.style = style;
+    curve.aggregation = "count";
+    curve.normalization = normalization;
+    aggregate_density(fig, curve, x, y, nullptr);
+
+    fig.curves.push_back(std::move(curve));
+    fig.curve_types.push_back("DENSITY");
+}
+
+// Density scatter plot (mean of a value column per pixel)
+void PlotGen::scatter_density(Figure &fig, const std::vector<double> &x, const std::vector<double> &y,
+                              const std::vector<double> &values, const std::string &normalization, const Style &style)
+{
+    require_linear_y(fig);
+    if (x.size() != y.size() || x.empty())
+    {
+        throw std::invalid_argument("x and y vectors must have the same size and not be empty");
+    }
+    if (values.size() != x.size())
+    {
+        throw std::invalid_argument("values vector must have the same size as x and y");
+    }
+
+    Figure::Curve curve;
+    curve.style = style;
+    curve.aggregation = "mean";
+    curve.normalization = normalization;
+    aggregate_density(fig, curve, x, y, &values);
+
+    fig.curves.push_back(std::move(curve));
+    fig.curve_types.push_back("DENSITY");
+}
+
+// Validate the normalization and the colormap, fit the axis limits to the data if they are still the default ones,
+// and size the grid of a density curve to the plot area
+void PlotGen::prepare_density_grid(Figure &fig, Figure::Curve &curve, double data_xmin, double data_xmax, double data_ymin, double data_ymax)
+{
+    if (curve.normalization != "linear" && curve.normalization != "log" && curve.normalization != "eq_hist")
+    {
+        std::cerr << "WARNING: Invalid normalization. Using default 'eq_hist'." << std::endl;
+        curve.normalization = "eq_hist";
+    }
+    check_colormap(curve.style.colormap);
+
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    if (using_default_limits)
+    {
+        // 5% margin, as for plot()
+        double x_margin = std::abs(data_xmax - data_xmin) < 1e-10 ? 1.0 : (data_xmax - data_xmin) * 0.05;
+        double y_margin = std::abs(data_ymax - data_ymin) < 1e-10 ? 1.0 : (data_ymax - data_ymin) * 0.05;
+
+        fig.xmin = data_xmin - x_margin;
+        fig.xmax = data_xmax + x_margin;
+        fig.ymin = data_ymin - y_margin;
+        fig.ymax = data_ymax + y_margin;
+    }
+
+    // The grid covers the current axis limits at the resolution of the plot area
+    plot_area_size(fig, curve.grid_w, curve.grid_h);
+    curve.grid_xmin = fig.xmin;
+    curve.grid_xmax = fig.xmax;
+    curve.grid_ymin = fig.ymin;
+    curve.grid_ymax = fig.ymax;
+}
+
+// Accumulate points into a grid matching the plot area of the figure, one cell per pixel
+void PlotGen::aggregate_density(Figure &fig, Figure::Curve &curve, const std::vector<double> &x, const std::vector<double> &y,
+                                const std::vector<double> *values)
+{
+    auto x_range = std::minmax_element(x.begin(), x.end());
+    auto y_range = std::minmax_element(y.begin(), y.end());
+    prepare_density_grid(fig, curve, *x_range.first, *x_range.second, *y_range.first, *y_range.second);
+
+    // Each worker accumulates into its own grid, merged afterwards (no atomics in the hot loop)
+    std::vector<std::vector<uint32_t>> counts;
+    std::vector<std::vector<double>> sums;
+    accumulate_density(curve, x.data(), y.data(), values ? values->data() : nullptr, x.size(), counts, sums);
+    merge_density(curve, counts, sums, values != nullptr);
+}
+
+// Add points to the per-worker grids of a density curve (created on first use, one per worker)
+void PlotGen::accumulate_density(const Figure::Curve &curve, const double *x, const double *y, const double *values, size_t count,
+                                 std::vector<std::vector<uint32_t>> &counts, std::vector<std::vector<double>> &sums)
+{
+    const unsigned int gw = curve.grid_w;
+    const unsigned int gh = curve.grid_h;
+    const size_t cells = static_cast<size_t>(gw) * gh;
+    const double sx = gw / (curve.grid_xmax - curve.grid_xmin);
+    const double sy = gh / (curve.grid_ymax - curve.grid_ymin);
+    const double x0 = curve.grid_xmin;
+    const double y1 = curve.grid_ymax;
+
+    unsigned int workers = std::max(1u, std::thread::hardware_concurrency());
+    counts.resize(workers);
+    if (values)
+        sums.resize(workers);
+
+    parallel_chunks(count, 1 << 16, [&](size_t begin, size_t end, unsigned int worker)
+                    {
+        std::vector<uint32_t> &grid = counts[worker];
+        if (grid.empty())
+            grid.assign(cells, 0);
+        double *sum = nullptr;
+        if (values)
+        {
+            if (sums[worker].empty())
+                sums[worker].assign(cells, 0.0);
+            sum = sums[worker].data();
+        }
+
+        for (size_t i = begin; i < end; ++i)
+        {
+            double fx = (x[i] - x0) * sx;
+            double fy = (y1 - y[i]) * sy;
+            // Also rejects NaN coordinates
+            if (!(fx >= 0 && fx < gw && fy >= 0 && fy < gh))
+                continue;
+            size_t cell = static_cast<size_t>(fy) * gw + static_cast<size_t>(fx);
+            grid[cell]++;
+            if (sum)
+                sum[cell] += values[i];
+        } });
+}
+
+// Merge the partial grids into the grid of the curve (NaN for empty cells)
+void PlotGen::merge_density(Figure::Curve &curve, const std::vector<std::vector<uint32_t>> &counts,
+                            const std::vector<std::vector<double>> &sums, bool mean)
+{
+    const size_t cells = static_cast<size_t>(curve.grid_w) * curve.grid_h;
+    curve.grid.assign(cells, std::numeric_limits<double>::quiet_NaN());
+    parallel_chunks(cells, 1 << 14, [&](size_t begin, size_t end, unsigned int)
+                    {
+        for (size_t c = begin; c < end; ++c)
+        {
+            uint64_t n = 0;
+            double total = 0.0;
+            for (size_t w = 0; w < counts.size(); ++w)
+            {
+                if (counts[w].empty())
+                    continue;
+                n += counts[w][c];
+                if (mean)
+                    total += sums[w][c];
+            }
+            if (n > 0)
+                curve.grid[c] = mean ? total / n : static_cast<double>(n);
+        } });
+}
+
+// Line density plot of many series
+void PlotGen::line_density(Figure &fig, const std::vector<std::vector<double>> &x, const std::vector<std::vector<double>> &y,
+                           bool normalize_series, const std::string &normalization, const Style &style)
+{
+    require_linear_y(fig);
+    if (x.size() != y.size() || x.empty())
+    {
+        throw std::invalid_argument("x and y must contain the same number of series and not be empty");
+    }
+
+    std::vector<const std::vector<double> *> xs, ys;
+    xs.reserve(x.size());
+    ys.reserve(y.size());
+    for (size_t s = 0; s < x.size(); ++s)
+    {
+        if (x[s].size() != y[s].size())
+        {
+            throw std::invalid_argument("x and y vectors of a series must have the same size");
+        }
+        xs.push_back(&x[s]);
+        ys.push_back(&y[s]);
+    }
+
+    Figure::Curve curve;
+    curve.style = style;
+    curve.aggregation = "count";
+    curve.normalization = normalization;
+    rasterize_lines(fig, curve, xs, ys, normalize_series);
+
+    fig.curves.push_back(std::move(curve));
+    fig.curve_types.push_back("DENSITY");
+}
+
+// Line density plot of series sharing the same x values
+void PlotGen::line_density(Figure &fig, const std::vector<double> &x, const std::vector<std::vector<double>> &y,
+                           bool normalize_series, const std::string &normalization, const Style &style)
+{
+    require_linear_y(fig);
+    if (x.empty() || y.empty())
+    {
+        throw std::invalid_argument("x and y must not be empty");
+    }
+
+    std::vector<const std::vector<double> *> xs(y.size(), &x), ys;
+    ys.reserve(y.size());
+    for (const auto &series : y)
+    {
+        if (series.size() != x.size())
+        {
+            throw std::invalid_argument("Every y series must have the same size as x");
+        }
+        ys.push_back(&series);
+    }
+
+    Figure::Curve curve;
+    curve.style = style;
+    curve.aggregation = "count";
+    curve.normalization = normalization;
+    rasterize_lines(fig, curve, xs, ys, normalize_series);
+
+    fig.curves.push_back(std::move(curve));
+    fig.curve_types.push_back("DENSITY");
+}
+
+// Rasterize polylines into the density grid of a curve, in parallel over the series.
+// Each series is first drawn into a scratch mask so that it hits a pixel at most once; with
+// normalize_series, the pixels of a series in a column then share a weight of 1.
+void PlotGen::rasterize_lines(Figure &fig, Figure::Curve &curve, const std::vector<const std::vector<double> *> &x,
+                              const std::vector<const std::vector<double> *> &y, bool normalize_series)
+{
+    // Bounds of all series
+    double data_xmin = std::numeric_limits<double>::infinity(), data_xmax = -data_xmin;
+    double data_ymin = data_xmin, data_ymax = data_xmax;
+    for (size_t s = 0; s < x.size(); ++s)
+    {
+        for (size_t i = 0; i < x[s]->size(); ++i)
+        {
+            double px = (*x[s])[i], py = (*y[s])[i];
+            if (!std::isfinite(px) || !std::isfinite(py))
+                continue;
+            data_xmin = std::min(data_xmin, px);
+            data_xmax = std::max(data_xmax, px);
+            data_ymin = std::min(data_ymin, py);
+            data_ymax = std::max(data_ymax, py);
+        }
+    }
+    if (data_xmin > data_xmax)
+    {
+        throw std::invalid_argument("Series contain no valid points");
+    }
+    prepare_density_grid(fig, curve, data_xmin, data_xmax, data_ymin, data_ymax);
+
+    const unsigned int gw = curve.grid_w;
+    const unsigned int gh = curve.grid_h;
+    const size_t cells = static_cast<size_t>(gw) * gh;
+    const double sx = gw / (curve.grid_xmax - curve.grid_xmin);
+    const double sy = gh / (curve.grid_ymax - curve.grid_ymin);
+    const double x0 = curve.grid_xmin;
+    const double y1 = curve.grid_ymax;
+
+    unsigned int workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::vector<float>> hits(workers);
+
+    parallel_chunks(x.size(), 1, [&](size_t begin, size_t end, unsigned int worker)
+                    {
+        std::vector<float> &acc = hits[worker];
+        acc.assign(cells, 0.0f);
+
+        // Scratch state reused for every series of this worker
+        std::vector<uint8_t> mask(cells, 0);
+        std::vector<uint32_t> column_hits(gw, 0);
+        std::vector<size_t> touched;
+
+        auto mark = [&](long cx, long cy)
+        {
+            if (cx < 0 || cy < 0 || cx >= static_cast<long>(gw) || cy >= static_cast<long>(gh))
+                return;
+            size_t cell = static_cast<size_t>(cy) * gw + static_cast<size_t>(cx);
+            if (!mask[cell])
+            {
+                mask[cell] = 1;
+                touched.push_back(cell);
+                column_hits[cx]++;
+            }
+        };
+
+        for (size_t s = begin; s < end; ++s)
+        {
+            const std::vector<double> &sx_data = *x[s];
+            const std::vector<double> &sy_data = *y[s];
+            touched.clear();
+
+            for (size_t i = 0; i + 1 < sx_data.size(); ++i)
+            {
+                double ax = (sx_data[i] - x0) * sx, ay = (y1 - sy_data[i]) * sy;
+                double bx = (sx_data[i + 1] - x0) * sx, by = (y1 - sy_data[i + 1]) * sy;
+                // Segments with a NaN or infinite end are gaps
+                if (!std::isfinite(ax) || !std::isfinite(ay) || !std::isfinite(bx) || !std::isfinite(by))
+                    continue;
+
+                // Clip the segment to the grid (Liang-Barsky)
+                double t0 = 0.0, t1 = 1.0;
+                double dx = bx - ax, dy = by - ay;
+                const double p[4] = {-dx, dx, -dy, dy};
+                const double q[4] = {ax, gw - ax, ay, gh - ay};
+                bool visible = true;
+                for (int k = 0; k < 4 && visible; ++k)
+                {
+                    if (p[k] == 0)
+                    {
+                        visible = q[k] >= 0;
+                    }
+                    else
+                    {
+                        double r = q[k] / p[k];
+                        if (p[k] < 0)
+                            t0 = std::max(t0, r);
+                        else
+                            t1 = std::min(t1, r);
+                        visible = t0 <= t1;
+                    }
+                }
+                if (!visible)
+                    continue;
+
+                double cx0 = ax + t0 * dx, cy0 = ay + t0 * dy;
+                double cx1 = ax + t1 * dx, cy1 = ay + t1 * dy;
+
+                // DDA, one step per pixel along the major axis
+                long steps = static_cast<long>(std::ceil(std::max(std::abs(cx1 - cx0), std::abs(cy1 - cy0))));
+                if (steps == 0)
+                {
+                    mark(static_cast<long>(cx0), static_cast<long>(cy0));
+                    continue;
+                }
+                double step_x = (cx1 - cx0) / steps, step_y = (cy1 - cy0) / steps;
+                for (long k = 0; k <= steps; ++k)
+                {
+                    mark(static_cast<long>(cx0 + k * step_x), static_cast<long>(cy0 + k * step_y));
+                }
+            }
+
+            // Add the series to the accumulation buffer and reset the scratch state
+            for (size_t cell : touched)
+            {
+                size_t column = cell % gw;
+                acc[cell] += normalize_series ? 1.0f / column_hits[column] : 1.0f;
+                mask[cell] = 0;
+            }
+            for (size_t cell : touched)
+                column_hits[cell % gw] = 0;
+        } });
+
+    // Merge the partial buffers
+    curve.grid.assign(cells, std::numeric_limits<double>::quiet_NaN());
+    parallel_chunks(cells, 1 << 14, [&](size_t begin, size_t end, unsigned int)
+                    {
+        for (size_t c = begin; c < end; ++c)
+        {
+            double total = 0.0;
+            for (const auto &acc : hits)
+            {
+                if (!acc.empty())
+                    total += acc[c];
+            }
+            if (total > 0)
+                curve.grid[c] = total;
+        } });
+}
+
+// Polar plot
+void PlotGen::polar_plot(Figure &fig, const std::vector<double> &theta, const std::vector<double> &r, const Style &style)
+{
+    if (theta.size() != r.size() || theta.empty())
+    {
+        throw std::invalid_argument("theta and r vectors must have the same size and not be empty");
+    }
+
+    // Mark the figure as being in polar coordinates
+    fig.is_polar = true;
+
+    // Find the maximum radius to adapt the graph limits
+    double max_r = *std::max_element(r.begin(), r.end());
+
+    // Check if we're using default limits
+    bool using_default_limits = (fig.xmin == -10 && fig.xmax == 10 && fig.ymin == -10 && fig.ymax == 10);
+
+    // If the limits haven't been explicitly set or are default, calculate them automatically
+    if (using_default_limits)
+    {
+        // Add a 10% margin for better visualization
+        set_polar_axis_limits(fig, max_r * 1.1f);
+    }
+    else
+    {
+        // Check if current limits are sufficient to contain all data
+        // and if they respect polar graph constraints (axes of same dimension)
+        double current_range_x = (fig.xmax - fig.xmin) / 2;
+        double current_range_y = (fig.ymax - fig.ymin) / 2;
+        double needed_range = max_r * 1.1f;
+
+        // Ensure axes have the same scale
+        double max_range = std::max(current_range_x, current_range_y);
+
+        if (needed_range > max_range || std::abs(current_range_x - current_range_y) > 1e-6)
+        {
+            // Use set_polar_axis_limits to ensure axes of same dimension
+            double max_limit = std::max(needed_range, max_range);
+            set_polar_axis_limits(fig, max_limit);
+        }
+    }
+
+    // Convert to Cartesian coordinates for display
+    std::vector<double> x, y;
+    for (size_t i = 0; i < theta.size(); ++i)
+    {
+        x.push_back(r[i] * std::cos(theta[i]));
+        y.push_back(r[i] * std::sin(theta[i]));
+    }
+
+    fig.curves.push_back(make_curve(x, y, style));
+    fig.curve_types.push_back("POLAR");
+}
+
+// Display and render
+void PlotGen::show()
+{
+
+#ifdef HAVE_GTK_WEBKIT
+    show_with_viewer();
+#else
+    showSFML();
+#endif
+}
+
+// Méthode privée pour l'affichage SFML original
+// Interactions: mouse wheel zooms around the cursor, left drag pans, right drag zooms on a box,
+// R restores the initial limits. Frames are drawn only when an event, an update() or a worker
+// changes the display. The nearest point under the cursor is shown in a tooltip with a crosshair.
+// The curves of the modified subplot are tessellated again on a
+// worker thread; meanwhile the previous image of the plot area is shown scaled to the new limits.
+void PlotGen::showSFML()
+{
+    ensure_texture(); // Throws for a vector-only instance, before the window is marked open
+    if (tiled())
+    {
+        throw std::runtime_error("The plot is larger than the render texture and can only be saved to a file");
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        ui_open = true;
+        ui_thread_id = std::this_thread::get_id();
+    }
+
+    // The window is marked closed again when the loop exits, even by an exception (e.g. no font found)
+    struct OpenGuard
+    {
+        PlotGen &plot;
+        ~OpenGuard()
+        {
+            std::lock_guard<std::mutex> lock(plot.ui_mutex);
+            plot.ui_open = false;
+            plot.ui_close_requested = false;
+        }
+    } open_guard{*this};
+
+    // Effectuer le rendu
+    render();
+
+    // Créer la fenêtre seulement lorsque show() est explicitement appelé
+    sf::ContextSettings settings;
+    settings.antialiasingLevel = 8;
+    sf::RenderWindow window;
+    window.create(sf::VideoMode(width, height), "PlotGen", sf::Style::Default, settings);
+    window.setFramerateLimit(60);
+    const sf::View base_view = window.getView();
+
+    // Configurer le sprite
+    sprite.setTexture(texture->getTexture(), true);
+
+    const double margin = 50.0;
+    const size_t count = figures.size();
+
+    // Limits at opening (restored with R) and limits of the image of each subplot in the texture
+    std::vector<std::array<double, 4>> initial_limits(count), drawn_limits(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        initial_limits[i] = {figures[i].xmin, figures[i].xmax, figures[i].ymin, figures[i].ymax};
+    }
+    drawn_limits = initial_limits;
+
+    // Each change of limits increases the generation of the subplot; results computed
+    // for an older generation are dropped
+    std::vector<unsigned long> generation(count, 0), drawn_generation(count, 0);
+
+    bool job_running = false;
+    size_t job_index = 0;
+    unsigned long job_generation = 0;
+    Figure job_limits;
+    std::future<std::vector<sf::VertexArray>> job_result;
+
+    // Pick indices of all subplots, built in the background when the window opens and after each update
+    auto build_pick_indices = [this]()
+    {
+        return std::async(std::launch::async, [this]()
+                          {
+                              std::vector<PickIndex> indices(figures.size());
+                              for (size_t i = 0; i < figures.size(); ++i)
+                                  build_pick_index(figures[i], indices[i]);
+                              {
+                                  std::lock_guard<std::mutex> lock(ui_mutex);
+                                  ui_pick_done = true;
+                              }
+                              ui_signal.notify_one();
+                              return indices; });
+    };
+    std::future<std::vector<PickIndex>> pick_result = build_pick_indices();
+    std::vector<PickIndex> pick_indices;
+
+    // Hover state
+    long hover_figure = -1;
+    bool hover_hit = false, hover_dirty = false;
+    size_t hover_curve = 0, hover_sample = 0;
+
+    // Mouse state
+    long active = -1; // Subplot being panned or zoomed with a box
+    bool panning = false, boxing = false;
+    sf::Vector2f press_pos, mouse_pos;
+    std::array<double, 4> press_limits = {0, 0, 0, 0};
+
+    // Subplot whose plot area contains a point of the texture (polar graphs are not interactive)
+    auto figure_at = [&](const sf::Vector2f &p) -> long
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            double left, top, w, h;
+            subplot_bounds(i, left, top, w, h);
+            if (!figures[i].is_polar && p.x >= left + margin && p.x <= left + w - margin &&
+                p.y >= top + margin && p.y <= top + h - margin)
+                return static_cast<long>(i);
+        }
+        return -1;
+    };
+
+    // Data coordinates of a point of the texture in a subplot
+    auto to_data = [&](size_t i, const sf::Vector2f &p, double &x, double &y)
+    {
+        double left, top, w, h;
+        subplot_bounds(i, left, top, w, h);
+        const Figure &fig = figures[i];
+        x = fig.xmin + (p.x - left - margin) / (w - 2 * margin) * (fig.xmax - fig.xmin);
+        y = y_from_fraction(fig, 1.0 - (p.y - top - margin) / (h - 2 * margin));
+    };
+
+    auto set_limits = [&](size_t i, double xmin, double xmax, double ymin, double ymax)
+    {
+        if (!(xmax > xmin) || !(ymax > ymin) || !std::isfinite(xmax - xmin) || !std::isfinite(ymax - ymin))
+            return;
+        Figure &fig = figures[i];
+        fig.xmin = xmin;
+        fig.xmax = xmax;
+        fig.ymin = ymin;
+        fig.ymax = ymax;
+        fig.follow_streams = false;
+        ++generation[i];
+        hover_dirty = true;
+    };
+
+    // Main loop
+    bool redraw = true;
+    while (window.isOpen())
+    {
+        sf::Event event;
+        while (window.pollEvent(event))
+        {
+            redraw = true;
+            if (event.type == sf::Event::Closed)
+                window.close();
+            else if (event.type == sf::Event::KeyPressed)
+            {
+                if (event.key.code == sf::Keyboard::Escape)
+                    window.close();
+                else if (event.key.code == sf::Keyboard::R)
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        const Figure &fig = figures[i];
+                        if (initial_limits[i] != std::array<double, 4>{fig.xmin, fig.xmax, fig.ymin, fig.ymax})
+                            set_limits(i, initial_limits[i][0], initial_limits[i][1], initial_limits[i][2], initial_limits[i][3]);
+                        figures[i].follow_streams = true;
+                    }
+                }
+            }
+            else if (event.type == sf::Event::MouseWheelScrolled)
+            {
+                sf::Vector2f p = window.mapPixelToCoords(sf::Vector2i(event.mouseWheelScroll.x, event.mouseWheelScroll.y), base_view);
+                long i = figure_at(p);
+                if (i >= 0 && !panning && !boxing)
+                {
+                    double cx, cy;
+                    to_data(i, p, cx, cy);
+                    double factor = std::pow(0.8, event.mouseWheelScroll.delta);
+                    const Figure &fig = figures[i];
+                    double ty = y_fraction(fig, cy);
+                    set_limits(i, cx - (cx - fig.xmin) * factor, cx + (fig.xmax - cx) * factor,
+                               y_from_fraction(fig, ty - ty * factor), y_from_fraction(fig, ty + (1.0 - ty) * factor));
+                }
+            }
+            else if (event.type == sf::Event::MouseButtonPressed)
+            {
+                sf::Vector2f p = window.mapPixelToCoords(sf::Vector2i(event.mouseButton.x, event.mouseButton.y), base_view);
+                active = figure_at(p);
+                if (active >= 0 && !panning && !boxing)
+                {
+                    const Figure &fig = figures[active];
+                    press_pos = mouse_pos = p;
+                    press_limits = {fig.xmin, fig.xmax, fig.ymin, fig.ymax};
+                    panning = event.mouseButton.button == sf::Mouse::Left;
+                    boxing = event.mouseButton.button == sf::Mouse::Right;
+                }
+            }
+            else if (event.type == sf::Event::MouseMoved)
+            {
+                mouse_pos = window.mapPixelToCoords(sf::Vector2i(event.mouseMove.x, event.mouseMove.y), base_view);
+                hover_dirty = true;
+                if (panning)
+                {
+                    double left, top, w, h;
+                    subplot_bounds(active, left, top, w, h);
+                    double dx = (mouse_pos.x - press_pos.x) / (w - 2 * margin) * (press_limits[1] - press_limits[0]);
+                    double dy = (mouse_pos.y - press_pos.y) / (h - 2 * margin);
+                    Figure &fig = figures[active];
+                    fig.ymin = press_limits[2];
+                    fig.ymax = press_limits[3];
+                    set_limits(active, press_limits[0] - dx, press_limits[1] - dx, y_from_fraction(fig, dy), y_from_fraction(fig, 1.0 + dy));
+                }
+            }
+            else if (event.type == sf::Event::MouseButtonReleased)
+            {
+                if (boxing && event.mouseButton.button == sf::Mouse::Right)
+                {
+                    boxing = false;
+                    if (std::abs(mouse_pos.x - press_pos.x) > 4 && std::abs(mouse_pos.y - press_pos.y) > 4)
+                    {
+                        double x1, y1, x2, y2;
+                        to_data(active, press_pos, x1, y1);
+                        to_data(active, mouse_pos, x2, y2);
+                        set_limits(active, std::min(x1, x2), std::max(x1, x2), std::min(y1, y2), std::max(y1, y2));
+                    }
+                }
+                else if (panning && event.mouseButton.button == sf::Mouse::Left)
+                    panning = false;
+            }
+        }
+
+        // Changes posted by update() from other threads, and workers that finished (their result is
+        // stored as soon as they return)
+        std::vector<std::function<void()>> updates;
+        bool job_done, pick_done;
+        {
+            std::lock_guard<std::mutex> lock(ui_mutex);
+            updates.swap(ui_updates);
+            if (ui_close_requested)
+                window.close();
+            job_done = ui_job_done;
+            pick_done = ui_pick_done;
+            ui_job_done = ui_pick_done = false;
+        }
+        if (!updates.empty())
+        {
+            // The workers read the figures: let them finish before changing the data
+            if (job_running)
+            {
+                job_result.get();
+                job_running = false;
+            }
+            if (pick_result.valid())
+                pick_result.wait();
+            {
+                std::lock_guard<std::mutex> lock(ui_mutex);
+                ui_job_done = ui_pick_done = false;
+            }
+            job_done = pick_done = false;
+
+            apply_updates(updates);
+
+            // Every subplot may have changed; R now restores the limits set by the updates
+            for (size_t i = 0; i < count; ++i)
+            {
+                ++generation[i];
+                initial_limits[i] = {figures[i].xmin, figures[i].xmax, figures[i].ymin, figures[i].ymax};
+            }
+            pick_indices.clear();
+            pick_result = build_pick_indices();
+            hover_dirty = true;
+            redraw = true;
+        }
+
+        // New samples of the streams, moved into their rings while no worker reads them
+        if (!job_running)
+        {
+            std::vector<bool> changed(count, false);
+            if (drain_streams(changed))
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    if (changed[i])
+                        ++generation[i];
+                }
+                hover_dirty = true;
+            }
+        }
+
+        // Nearest point under the cursor
+        if (pick_indices.empty() && pick_result.valid() &&
+            (pick_done || pick_result.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+        {
+            pick_indices = pick_result.get();
+            hover_dirty = true;
+            // The flag of this worker may have been raised after it was read above
+            std::lock_guard<std::mutex> lock(ui_mutex);
+            ui_pick_done = false;
+        }
+        if (hover_dirty)
+        {
+            hover_dirty = false;
+            redraw = true;
+            hover_figure = panning || boxing ? -1 : figure_at(mouse_pos);
+            hover_hit = false;
+            if (hover_figure >= 0 && !pick_indices.empty())
+            {
+                double left, top, w, h, x, y;
+                subplot_bounds(hover_figure, left, top, w, h);
+                to_data(hover_figure, mouse_pos, x, y);
+                hover_hit = pick(figures[hover_figure], pick_indices[hover_figure], x, y, w, h, 12.0, hover_curve, hover_sample);
+            }
+        }
+
+        // Collect the geometry of the worker: re-render the subplot if its limits did not change meanwhile
+        if (job_running && (job_done || job_result.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+        {
+            std::vector<sf::VertexArray> geometry = job_result.get();
+            job_running = false;
+            {
+                std::lock_guard<std::mutex> lock(ui_mutex);
+                ui_job_done = false;
+            }
+            if (job_generation == generation[job_index])
+            {
+                render_subplot(job_index, &geometry);
+                texture->display();
+                redraw = true;
+                drawn_limits[job_index] = {job_limits.xmin, job_limits.xmax, job_limits.ymin, job_limits.ymax};
+                drawn_generation[job_index] = job_generation;
+            }
+        }
+
+        // Tessellate the next outdated subplot in the background
+        if (!job_running)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (generation[i] == drawn_generation[i])
+                    continue;
+
+                job_index = i;
+                job_generation = generation[i];
+                job_limits = Figure();
+                job_limits.xmin = figures[i].xmin;
+                job_limits.xmax = figures[i].xmax;
+                job_limits.ymin = figures[i].ymin;
+                job_limits.ymax = figures[i].ymax;
+                // Settings read by to_screen() and visible_samples()
+                job_limits.log_y = figures[i].log_y;
+                job_limits.is_polar = figures[i].is_polar;
+                job_limits.equal_axes = figures[i].equal_axes;
+                job_limits.use_lod = figures[i].use_lod;
+                double left, top, w, h;
+                subplot_bounds(i, left, top, w, h);
+
+                // The worker only reads the curves and a copy of the limits and axis settings
+                Figure limits = job_limits;
+                job_result = std::async(std::launch::async, [this, i, limits, w, h]()
+                                        {
+                                            const Figure &fig = figures[i];
+                                            std::vector<sf::VertexArray> geometry(fig.curves.size());
+                                            for (size_t c = 0; c < fig.curves.size() && c < fig.curve_types.size(); ++c)
+                                            {
+                                                if (fig.curve_types[c] == "2D" || fig.curve_types[c] == "POLAR" || fig.curve_types[c] == "STREAM" ||
+                                                    fig.curve_types[c] == "MAPPED")
+                                                    tessellate_curve(limits, fig.curves[c], w, h, geometry[c]);
+                                            }
+                                            {
+                                                std::lock_guard<std::mutex> lock(ui_mutex);
+                                                ui_job_done = true;
+                                            }
+                                            ui_signal.notify_one();
+                                            return geometry; });
+                job_running = true;
+                break;
+            }
+        }
+
+        if (!redraw)
+        {
+            // Nothing changed: sleep until an update is posted or a worker finishes. The timeout only
+            // serves the window events and the streams, which do not signal
+            std::unique_lock<std::mutex> lock(ui_mutex);
+            ui_signal.wait_for(lock, std::chrono::milliseconds(15), [this]()
+                               { return !ui_updates.empty() || ui_close_requested || ui_job_done || ui_pick_done; });
+            continue;
+        }
+        redraw = false;
+
+        // Render and display
+        window.clear(sf::Color::White);
+        window.setView(base_view);
+        window.draw(sprite);
+
+        // Subplots waiting for their geometry: previous image of the plot area, moved and scaled to the new limits
+        for (size_t i = 0; i < count; ++i)
+        {
+            if (generation[i] == drawn_generation[i])
+                continue;
+
+            const Figure &fig = figures[i];
+            const std::array<double, 4> &old = drawn_limits[i];
+            double left, top, w, h;
+            subplot_bounds(i, left, top, w, h);
+            sf::FloatRect area(left + margin, top + margin, w - 2 * margin, h - 2 * margin);
+
+            double x0 = area.left + (old[0] - fig.xmin) / (fig.xmax - fig.xmin) * area.width;
+            double x1 = area.left + (old[1] - fig.xmin) / (fig.xmax - fig.xmin) * area.width;
+            double y0 = area.top + (1.0 - y_fraction(fig, old[3])) * area.height;
+            double y1 = area.top + (1.0 - y_fraction(fig, old[2])) * area.height;
+
+            // Clip to the plot area
+            sf::View clip(area);
+            clip.setViewport(sf::FloatRect(area.left / width, area.top / height, area.width / width, area.height / height));
+            window.setView(clip);
+
+            sf::RectangleShape background(sf::Vector2f(area.width, area.height));
+            background.setPosition(area.left, area.top);
+            background.setFillColor(sf::Color::White);
+            window.draw(background);
+
+            sf::Sprite preview(texture->getTexture(), sf::IntRect(static_cast<int>(area.left), static_cast<int>(area.top),
+                                                                 static_cast<int>(area.width), static_cast<int>(area.height)));
+            preview.setPosition(static_cast<float>(x0), static_cast<float>(y0));
+            preview.setScale(static_cast<float>((x1 - x0) / area.width), static_cast<float>((y1 - y0) / area.height));
+            window.draw(preview);
+            window.setView(base_view);
+        }
+
+        // Zoom box
+        if (boxing)
+        {
+            sf::RectangleShape box(mouse_pos - press_pos);
+            box.setPosition(press_pos);
+            box.setFillColor(sf::Color(100, 100, 255, 40));
+            box.setOutlineColor(sf::Color(50, 50, 200));
+            box.setOutlineThickness(1.0f);
+            window.draw(box);
+        }
+
+        // Crosshair with the cursor coordinates, and tooltip of the nearest point
+        if (hover_figure >= 0)
+        {
+            const Figure &fig = figures[hover_figure];
+            double left, top, w, h, x, y;
+            subplot_bounds(hover_figure, left, top, w, h);
+            to_data(hover_figure, mouse_pos, x, y);
+
+            sf::Color cross_color(120, 120, 120, 160);
+            sf::Vertex cross[] = {
+                sf::Vertex(sf::Vector2f(left + margin, mouse_pos.y), cross_color),
+                sf::Vertex(sf::Vector2f(left + w - margin, mouse_pos.y), cross_color),
+                sf::Vertex(sf::Vector2f(mouse_pos.x, top + margin), cross_color),
+                sf::Vertex(sf::Vector2f(mouse_pos.x, top + h - margin), cross_color)};
+            window.draw(cross, 4, sf::Lines);
+
+            char buffer[128];
+            std::snprintf(buffer, sizeof(buffer), "x = %.6g  y = %.6g", x, y);
+            sf::Text readout(buffer, get_font(), 11);
+            readout.setFillColor(sf::Color(80, 80, 80));
+            readout.setPosition(static_cast<float>(left + margin + 4), static_cast<float>(top + margin + 2));
+            window.draw(readout);
+
+            if (hover_hit)
+            {
+                const Figure::Curve &curve = fig.curves[hover_curve];
+                double px = curve.x[hover_sample], py = curve.y[hover_sample];
+                sf::Vector2f point = to_screen(fig, px, py, w, h) + sf::Vector2f(left, top);
+
+                sf::CircleShape marker(5.0f);
+                marker.setOrigin(5.0f, 5.0f);
+                marker.setPosition(point);
+                marker.setFillColor(sf::Color::Transparent);
+                marker.setOutlineColor(curve.style.color);
+                marker.setOutlineThickness(2.0f);
+                window.draw(marker);
+
+                std::string label = curve.style.legend.empty() ? "Curve " + std::to_string(hover_curve + 1) : curve.style.legend;
+                std::snprintf(buffer, sizeof(buffer), "\nx = %.6g\ny = %.6g", px, py);
+                label += buffer;
+                sf::Text tooltip(sf::String::fromUtf8(label.begin(), label.end()), get_font(), 12);
+                tooltip.setFillColor(sf::Color::Black);
+
+                // Keep the tooltip inside the window
+                sf::FloatRect bounds = tooltip.getLocalBounds();
+                float tx = point.x + 12.0f, ty = point.y + 12.0f;
+                if (tx + bounds.width + 8.0f > width)
+                    tx = point.x - bounds.width - 20.0f;
+                if (ty + bounds.height + 8.0f > height)
+                    ty = point.y - bounds.height - 20.0f;
+                tooltip.setPosition(tx + 4.0f, ty + 2.0f);
+
+                sf::RectangleShape box(sf::Vector2f(bounds.width + 8.0f, bounds.height + bounds.top + 6.0f));
+                box.setPosition(tx, ty);
+                box.setFillColor(sf::Color(255, 255, 225, 235));
+                box.setOutlineColor(sf::Color(100, 100, 100));
+                box.setOutlineThickness(1.0f);
+                window.draw(box);
+                window.draw(tooltip);
+            }
+        }
+
+        window.display();
+    }
+
+    // Apply the changes posted while the window was closing, once the workers are done
+    if (job_result.valid())
+        job_result.wait();
+    if (pick_result.valid())
+        pick_result.wait();
+    std::vector<std::function<void()>> updates;
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        ui_open = false;
+        ui_close_requested = false;
+        ui_job_done = ui_pick_done = false;
+        updates.swap(ui_updates);
+    }
+    apply_updates(updates);
+}
+
+// Open the SFML window on a background thread and return immediately
+void PlotGen::show_async()
+{
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        if (ui_open)
+        {
+            std::cerr << "Warning: the window is already open" << std::endl;
+            return;
+        }
+        // Set before the thread starts, so that update() calls made right after are queued
+        ui_open = true;
+    }
+    if (vector_only)
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        ui_open = false;
+        throw std::runtime_error("Raster output is disabled for a vector-only PlotGen, use save_svg()");
+    }
+    if (tiled())
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        ui_open = false;
+        throw std::runtime_error("The plot is larger than the render texture and can only be saved to a file");
+    }
+    if (ui_thread.joinable())
+        ui_thread.join();
+
+    // The render texture is drawn by the window thread from now on
+    if (texture)
+        texture->setActive(false);
+    ui_thread = std::thread([this]()
+                            {
+                                try
+                                {
+                                    showSFML();
+                                }
+                                catch (...)
+                                {
+                                    // Rethrown by wait_closed() or close() on the calling thread; the
+                                    // changes posted meanwhile are still applied
+                                    std::vector<std::function<void()>> updates;
+                                    {
+                                        std::lock_guard<std::mutex> lock(ui_mutex);
+                                        ui_error = std::current_exception();
+                                        ui_open = false;
+                                        ui_close_requested = false;
+                                        updates.swap(ui_updates);
+                                    }
+                                    apply_updates(updates);
+                                } });
+}
+
+// Run changes to the figures: queued for the window thread while the window is open, immediately otherwise
+void PlotGen::update(const std::function<void()> &changes)
+{
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        if (ui_open && std::this_thread::get_id() != ui_thread_id)
+        {
+            ui_updates.push_back(changes);
+            ui_signal.notify_one();
+            return;
+        }
+    }
+    changes();
+}
+
+void PlotGen::apply_updates(const std::vector<std::function<void()>> &updates)
+{
+    for (const auto &changes : updates)
+    {
+        try
+        {
+            changes();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << "Error in update: " << e.what() << std::endl;
+        }
+    }
+}
+
+bool PlotGen::is_open() const
+{
+    std::lock_guard<std::mutex> lock(ui_mutex);
+    return ui_open;
+}
+
+// Ask the window opened by show_async() to close. Rethrows the error that ended the window thread, if any
+void PlotGen::close()
+{
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        if (ui_open)
+        {
+            ui_close_requested = true;
+            ui_signal.notify_one();
+        }
+        std::swap(error, ui_error);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+// Wait until the window opened by show_async() is closed. Rethrows the error that ended the window thread, if any
+void PlotGen::wait_closed()
+{
+    if (ui_thread.joinable() && std::this_thread::get_id() != ui_thread.get_id())
+        ui_thread.join();
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> lock(ui_mutex);
+        std::swap(error, ui_error);
+    }
+    if (error)
+        std::rethrow_exception(error);
+}
+
+PlotGen::~PlotGen()
+{
+    wait_saves();
+    try
+    {
+        wait_closed();
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Error in the window thread: " << e.what() << std::endl;
+    }
+}
+
+std::string PlotGen::get_svg_in_html(const std::string &svg_filename)
+{
+    // Lire le contenu du fichier SVG
+    std::ifstream svg_file(svg_filename);
+    if (!svg_file.is_open())
+    {
+        std::cerr << "Erreur: Impossible d'ouvrir le fichier SVG" << std::endl;
+        return "";
+    }
+
+    std::stringstream buffer;
+    buffer << svg_file.rdbuf();
+    svg_file.close();
+
+    // Créer le contenu HTML
+    std::string html_content = "<!DOCTYPE html>\n"
+                               "<html>\n"
+                               "<head>\n"
+                               "    <meta charset=\"UTF-8\">\n"
+                               "    <title>PlotGenC++ - Visualisation SVG</title>\n"
+                               "    <style>\n"
+                               "        body { margin: 0; padding: 0; overflow: hidden; background-color: #f0f0f0; }\n"
+                               "        #svg-container { width: 100vw; height: 100vh; display: flex; justify-content: center; align-items: center; }\n"
+                               "        #controls { position: fixed; bottom: 10px; left: 10px; background: rgba(255,255,255,0.8); padding: 10px; border-radius: 5px; }\n"
+                               "        svg { max-width: 95%; max-height: 95%; background-color: white; box-shadow: 0 0 10px rgba(0,0,0,0.2); }\n"
+                               "    </style>\n"
+                               "</head>\n"
+                               "<body>\n"
+                               "    <div id=\"svg-container\">\n" +
+                               buffer.str() + "\n"
+                                              "    </div>\n"
+                                              "    <div id=\"controls\">\n"
+                                              "        <button onclick=\"window.close()\">Fermer</button>\n"
+                                              "        <button onclick=\"saveSvg()\">Télécharger SVG</button>\n"
+                                              "    </div>\n"
+                                              "    <script>\n"
+                                              "        function saveSvg() {\n"
+                                              "            const link = document.createElement('a');\n"
+                                              "            link.href = '" +
+                               svg_filename + "';\n"
+                                              "            link.download = '" +
+                               svg_filename + "';\n"
+                                              "            document.body.appendChild(link);\n"
+                                              "            link.click();\n"
+                                              "            document.body.removeChild(link);\n"
+                                              "        }\n"
+                                              "        document.addEventListener('keydown', function(e) {\n"
+                                              "            if (e.key === 'Escape') window.close();\n"
+                                              "        });\n"
+                                              "    </script>\n"
+                                              "</body>\n"
+                                              "</html>";
+
+    return html_content;
+}
+
+// Format of an output file from its extension: "png", "jpg", "svg", or empty when unsupported
+std::string PlotGen::file_format(const std::string &filename)
+{
+    for (const char *format : {"png", "jpg", "svg"})
+    {
+        if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, std::string(".") + format) == 0)
+            return format;
+    }
+    return "";
+}
+
+// Save
+void PlotGen::save(const std::string &filename, int jpg_quality, int png_compression)
+{
+    // Vérifier si c'est un fichier SVG et utiliser l'export vectoriel (sans texture de rendu)
+    if (file_format(filename) == "svg")
+    {
+        std::vector<bool> changed(figures.size(), false);
+        drain_streams(changed);
+        save_svg(filename);
+        return;
+    }
+
+    render(); // Ensure the rendering is up to date
+    encode_image(filename, jpg_quality, png_compression);
+}
+
+// Save the same plot to several files with one render: the raster encoders share the pixels read
+// back once and run on their own threads, while the SVG document is generated once on this thread
+void PlotGen::save_all(const std::vector<std::string> &filenames, int jpg_quality, int png_compression)
+{
+    std::vector<std::string> raster, svg;
+    for (const auto &filename : filenames)
+    {
+        const std::string format = file_format(filename);
+        if (format.empty())
+        {
+            throw std::invalid_argument("File format not supported. Use .png, .jpg or .svg");
+        }
+        (format == "svg" ? svg : raster).push_back(filename);
+    }
+
+    sf::Image screenshot;
+    if (!raster.empty())
+    {
+        render(); // Also drains the streams
+        screenshot = read_back();
+    }
+    else
+    {
+        std::vector<bool> changed(figures.size(), false);
+        drain_streams(changed);
+    }
+
+    std::vector<std::future<void>> encoders;
+    for (const auto &filename : raster)
+    {
+        encoders.push_back(std::async(std::launch::async, [&, filename]
+                                      { write_image_file(filename, screenshot.getPixelsPtr(), width, height, jpg_quality, png_compression); }));
+    }
+
+    // Errors are reported once every output is finished, the first one is rethrown
+    std::exception_ptr error;
+    if (!svg.empty())
+    {
+        try
+        {
+            std::ostringstream document;
+            save_svg(document);
+            const std::string text = document.str();
+            for (const auto &filename : svg)
+            {
+                std::ofstream svg_file(filename);
+                if (!svg_file.is_open() || !(svg_file << text) || !svg_file.flush())
+                {
+                    throw std::runtime_error("Unable to create SVG file");
+                }
+                std::cout << "SVG vectoriel exporté vers: " << filename << " (Dimensions: " << width << "x" << height << ")" << std::endl;
+            }
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+    }
+    for (auto &encoder : encoders)
+    {
+        try
+        {
+            encoder.get();
+        }
+        catch (...)
+        {
+            if (!error)
+                error = std::current_exception();
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+// Encode the plot to a sink, without going through a file. format: "png", "jpg" or "svg".
+void PlotGen::encode(const std::string &format, const ByteSink &sink, int jpg_quality, int png_compression)
+{
+    if (format == "svg")
+    {
+        std::ostringstream svg;
+        encode(format, svg);
+        const std::string text = svg.str();
+        sink(reinterpret_cast<const unsigned char *>(text.data()), text.size());
+        return;
+    }
+    if (format != "png" && format != "jpg")
+    {
+        throw std::invalid_argument("Format not supported. Use png, jpg or svg");
+    }
+
+    render();
+    if (format == "png" && tiled())
+    {
+        PngOptions options;
+        options.compression = png_compression;
+        write_png_tiled(sink, options);
+        return;
+    }
+    sf::Image screenshot = read_back();
+    write_pixels(format, sink, screenshot.getPixelsPtr(), width, height, jpg_quality, png_compression);
+}
+
+void PlotGen::encode(const std::string &format, std::ostream &out, int jpg_quality, int png_compression)
+{
+    if (format == "svg")
+    {
+        std::vector<bool> changed(figures.size(), false);
+        drain_streams(changed);
+        save_svg(out);
+    }
+    else
+    {
+        encode(format, [&](const unsigned char *data, size_t size)
+               { out.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size)); },
+               jpg_quality, png_compression);
+    }
+    if (!out)
+    {
+        throw std::runtime_error("Unable to write the encoded image to the stream");
+    }
+}
+
+std::vector<uint8_t> PlotGen::encode(const std::string &format, int jpg_quality, int png_compression)
+{
+    std::vector<uint8_t> bytes;
+    encode(format, [&](const unsigned char *data, size_t size)
+           { bytes.insert(bytes.end(), data, data + size); },
+           jpg_quality, png_compression);
+    return bytes;
+}
+
+// Encode into a buffer of the caller; returns the number of bytes written
+size_t PlotGen::encode(const std::string &format, uint8_t *buffer, size_t capacity, int jpg_quality, int png_compression)
+{
+    size_t used = 0;
+    encode(format, [&](const unsigned char *data, size_t size)
+           {
+        if (size > capacity - used)
+        {
+            throw std::length_error("Encoded image larger than the buffer");
+        }
+        std::memcpy(buffer + used, data, size);
+        used += size; },
+           jpg_quality, png_compression);
+    return used;
+}
+
+// Read the rendered image back from the texture, top row first. A tiled image is rendered and
+// assembled band by band here, it needs memory for the whole image (the PNG encoder does not).
+sf::Image PlotGen::read_back()
+{
+    if (tiled())
+    {
+        std::vector<sf::Uint8> pixels(static_cast<size_t>(width) * height * 4), band;
+        for (unsigned int y = 0; y < height; y += texture->getSize().y)
+        {
+            render_band(y, std::min(texture->getSize().y, height - y), band);
+            std::memcpy(pixels.data() + static_cast<size_t>(y) * width * 4, band.data(), band.size());
+        }
+        sf::Image image;
+        image.create(width, height, pixels.data());
+        return image;
+    }
+
+    sf::Image screenshot = texture->getTexture().copyToImage();
+    if (!screenshot.getPixelsPtr() || screenshot.getSize() != sf::Vector2u(width, height))
+    {
+        throw std::runtime_error("Unable to read back the rendered image");
+    }
+    return screenshot;
+}
+
+// Write the rendered image of the texture to a raster file, from the pixels read back once
+void PlotGen::encode_image(const std::string &filename, int jpg_quality, int png_compression)
+{
+    const std::string format = file_format(filename);
+    if (format != "png" && format != "jpg")
+    {
+        throw std::invalid_argument("File format not supported. Use .png, .jpg or .svg");
+    }
+    if (format == "png" && tiled())
+    {
+        // Streamed to the file band by band, the whole image is never held in memory
+        PngOptions options;
+        options.compression = png_compression;
+        save_png(filename, options);
+        return;
+    }
+
+    sf::Image screenshot = read_back();
+    write_image_file(filename, screenshot.getPixelsPtr(), width, height, jpg_quality, png_compression);
+}
+
+// Encode RGBA pixels (top row first) to a .png or .jpg file
+void PlotGen::write_image_file(const std::string &filename, const sf::Uint8 *rgba, unsigned int width, unsigned int height,
+                               int jpg_quality, int png_compression)
+{
+    const std::string format = file_format(filename);
+    const std::string error = "Unable to save image in " + std::string(format == "png" ? "PNG" : "JPG") + " format";
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error(error);
+    }
+    write_pixels(format, [&](const unsigned char *data, size_t size)
+                 { file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size)); },
+                 rgba, width, height, jpg_quality, png_compression);
+    if (!file.flush())
+    {
+        throw std::runtime_error(error);
+    }
+
+    std::cout << "Image saved to: " << filename << " (Dimensions: " << width << "x" << height << ")" << std::endl;
+}
+
+namespace
+{
+    // Worker threads of save_async(), shared by all instances and joined at exit once the queue
+    // is empty. Captured images are admitted while their total size stays under the limit; one
+    // is always admitted when nothing is pending, whatever its size.
+    class SaveQueue
+    {
+    public:
+        static SaveQueue &instance()
+        {
+            static SaveQueue queue;
+            return queue;
+        }
+
+        void push(size_t bytes, std::function<void()> task)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            space.wait(lock, [&]
+                       { return pending_bytes == 0 || pending_bytes + bytes <= limit; });
+            pending_bytes += bytes;
+            tasks.push_back({bytes, std::move(task)});
+            ready.notify_one();
+        }
+
+        void set_limit(size_t bytes)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            limit = bytes;
+            space.notify_all();
+        }
+
+        ~SaveQueue()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            ready.notify_all();
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+    private:
+        struct Task
+        {
+            size_t bytes;
+            std::function<void()> run;
+        };
+
+        SaveQueue()
+        {
+            // The PNG encoder already uses every core, a few workers overlap encoding and I/O
+            unsigned int count = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+            for (unsigned int i = 0; i < count; ++i)
+                workers.emplace_back([this]
+                                     { work(); });
+        }
+
+        void work()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            for (;;)
+            {
+                ready.wait(lock, [&]
+                           { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                Task task = std::move(tasks.front());
+                tasks.pop_front();
+                lock.unlock();
+                task.run();
+                lock.lock();
+                pending_bytes -= task.bytes;
+                space.notify_all();
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable ready, space;
+        std::deque<Task> tasks;
+        std::vector<std::thread> workers;
+        size_t pending_bytes = 0;
+        size_t limit = size_t(512) << 20;
+        bool stopping = false;
+    };
+}
+
+std::shared_future<void> PlotGen::save_async(const std::string &filename, int jpg_quality, int png_compression)
+{
+    const std::string format = file_format(filename);
+    if (format.empty())
+    {
         throw std::invalid_argument("File format not supported. Use .png, .jpg or .svg");
     }
 
-    std::cout << "Image saved to: " << filename << " (Dimensions: " << width << "x" << height << ")" << std::endl;
+    // Forget the saves already done
+    pending_saves.erase(std::remove_if(pending_saves.begin(), pending_saves.end(), [](const std::shared_future<void> &save)
+                                       { return save.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }),
+                        pending_saves.end());
+
+    std::function<void()> write;
+    size_t bytes = 0;
+    if (format == "svg")
+    {
+        // Copy of the figures in a vector-only instance, the windows of the streams become plain samples
+        std::vector<bool> changed(figures.size(), false);
+        drain_streams(changed);
+        auto snapshot = std::make_shared<PlotGen>(width, height, rows, cols, true);
+        snapshot->figures = figures;
+        for (auto &fig : snapshot->figures)
+        {
+            for (auto &curve : fig.curves)
+            {
+                if (curve.stream)
+                {
+                    const Stream &stream = *curve.stream;
+                    curve.x.assign(stream.window_x(), stream.window_x() + stream.size);
+                    curve.y.assign(stream.window_y(), stream.window_y() + stream.size);
+                    curve.stream.reset();
+                }
+                bytes += (curve.x.size() + curve.y.size() + curve.grid.size()) * sizeof(double);
+            }
+        }
+        write = [snapshot, filename]
+        { snapshot->save_svg(filename); };
+    }
+    else
+    {
+        render();
+        auto image = std::make_shared<sf::Image>(read_back());
+        bytes = static_cast<size_t>(width) * height * 4;
+        const unsigned int w = width, h = height;
+        write = [image, filename, w, h, jpg_quality, png_compression]
+        { write_image_file(filename, image->getPixelsPtr(), w, h, jpg_quality, png_compression); };
+    }
+
+    auto promise = std::make_shared<std::promise<void>>();
+    std::shared_future<void> done = promise->get_future().share();
+    SaveQueue::instance().push(bytes, [promise, write]
+                               {
+        try
+        {
+            write();
+            promise->set_value();
+        }
+        catch (...)
+        {
+            promise->set_exception(std::current_exception());
+        } });
+    pending_saves.push_back(done);
+    return done;
+}
+
+void PlotGen::wait_saves()
+{
+    for (auto &save : pending_saves)
+        save.wait();
+    pending_saves.clear();
+}
+
+void PlotGen::set_async_save_limit(size_t max_bytes)
+{
+    SaveQueue::instance().set_limit(max_bytes);
+}
+
+// Encode RGBA pixels (top row first) as "png" or "jpg" to a sink
+void PlotGen::write_pixels(const std::string &format, const ByteSink &sink, const sf::Uint8 *rgba,
+                           unsigned int width, unsigned int height, int jpg_quality, int png_compression)
+{
+    if (format == "png")
+    {
+        if (png_compression < 0 || png_compression > 9)
+        {
+            std::cerr << "WARNING: Invalid PNG compression level. Using default 8." << std::endl;
+            png_compression = 8;
+        }
+        PngOptions options;
+        options.compression = png_compression;
+        write_png(sink, rgba, width, height, options);
+    }
+    else if (format == "jpg")
+    {
+        if (jpg_quality < 1 || jpg_quality > 100)
+        {
+            std::cerr << "WARNING: Invalid JPG quality. Using default 95." << std::endl;
+            jpg_quality = 95;
+        }
+
+        // stb_image_write ignores the alpha channel of JPG input, the pixels are used as they are
+        auto write = [](void *context, void *data, int size)
+        { (*static_cast<const ByteSink *>(context))(static_cast<const unsigned char *>(data), static_cast<size_t>(size)); };
+        if (!stbi_write_jpg_to_func(write, const_cast<ByteSink *>(&sink), width, height, 4, rgba, jpg_quality))
+        {
+            throw std::runtime_error("Unable to save image in JPG format");
+        }
+    }
+    else
+    {
+        throw std::invalid_argument("Format not supported. Use png, jpg or svg");
+    }
+}
+
+namespace
+{
+    // Fixed Huffman codes of deflate (RFC 1951, 3.2.6), bit-reversed to be written LSB first
+    struct FixedHuffman
+    {
+        std::array<uint16_t, 288> literal_code;
+        std::array<uint8_t, 288> literal_bits;
+        std::array<uint8_t, 259> length_symbol;  // Index in length_base of the match lengths 3 to 258
+        std::array<uint8_t, 32769> distance_symbol;
+        std::array<uint8_t, 30> distance_code;
+
+        static constexpr uint16_t length_base[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                                     35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+        static constexpr uint8_t length_extra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                                     3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+        static constexpr uint16_t distance_base[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                                       257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                                       8193, 12289, 16385, 24577};
+        static constexpr uint8_t distance_extra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                                       7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+        static uint16_t reverse(unsigned int code, unsigned int bits)
+        {
+            unsigned int result = 0;
+            for (unsigned int i = 0; i < bits; ++i)
+                result |= ((code >> i) & 1u) << (bits - 1 - i);
+            return static_cast<uint16_t>(result);
+        }
+
+        FixedHuffman()
+        {
+            for (unsigned int n = 0; n < 288; ++n)
+            {
+                unsigned int code, bits;
+                if (n <= 143)
+                    code = 0x30 + n, bits = 8;
+                else if (n <= 255)
+                    code = 0x190 + n - 144, bits = 9;
+                else if (n <= 279)
+                    code = n - 256, bits = 7;
+                else
+                    code = 0xc0 + n - 280, bits = 8;
+                literal_code[n] = reverse(code, bits);
+                literal_bits[n] = static_cast<uint8_t>(bits);
+            }
+            for (unsigned int s = 0; s < 29; ++s)
+                for (unsigned int l = length_base[s]; l < length_base[s] + (1u << length_extra[s]) && l <= 258; ++l)
+                    length_symbol[l] = static_cast<uint8_t>(s);
+            for (unsigned int s = 0; s < 30; ++s)
+            {
+                distance_code[s] = static_cast<uint8_t>(reverse(s, 5));
+                for (unsigned int d = distance_base[s]; d < distance_base[s] + (1u << distance_extra[s]) && d <= 32768; ++d)
+                    distance_symbol[d] = static_cast<uint8_t>(s);
+            }
+        }
+    };
+
+    const FixedHuffman &fixed_huffman()
+    {
+        static const FixedHuffman table;
+        return table;
+    }
+
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(std::vector<unsigned char> &out) : out(out) {}
+
+        void put(uint32_t value, unsigned int bits)
+        {
+            buffer |= static_cast<uint64_t>(value) << count;
+            count += bits;
+            while (count >= 8)
+            {
+                out.push_back(static_cast<unsigned char>(buffer));
+                buffer >>= 8;
+                count -= 8;
+            }
+        }
+
+        void align()
+        {
+            if (count > 0)
+                put(0, 8 - count);
+        }
+
+    private:
+        std::vector<unsigned char> &out;
+        uint64_t buffer = 0;
+        unsigned int count = 0;
+    };
+
+    void append_stored_blocks(const unsigned char *data, size_t size, std::vector<unsigned char> &out)
+    {
+        for (size_t pos = 0; pos < size;)
+        {
+            size_t n = std::min<size_t>(65535, size - pos);
+            out.push_back(0); // BFINAL = 0, BTYPE = 00
+            out.push_back(static_cast<unsigned char>(n));
+            out.push_back(static_cast<unsigned char>(n >> 8));
+            out.push_back(static_cast<unsigned char>(~n));
+            out.push_back(static_cast<unsigned char>(~n >> 8));
+            out.insert(out.end(), data + pos, data + pos + n);
+            pos += n;
+        }
+    }
+
+    // Deflate data[begin, end) as non final blocks ending on a byte boundary (a sync flush), so that
+    // segments compressed independently can be concatenated into one stream. Matches may reach back
+    // into the 32 KiB preceding begin, which keeps the ratio close to a single-threaded stream.
+    // Same scheme as stbi_zlib_compress(): fixed Huffman codes, hash chains and lazy matching.
+    void deflate_segment(const unsigned char *data, size_t begin, size_t end, int level, std::vector<unsigned char> &out)
+    {
+        const size_t out_start = out.size();
+        if (level > 0)
+        {
+            static const int chain_lengths[10] = {0, 1, 2, 4, 6, 8, 12, 16, 32, 64};
+            const int max_chain = chain_lengths[level];
+            const bool lazy = level >= 4;
+            const FixedHuffman &huffman = fixed_huffman();
+            const size_t window_start = begin - std::min<size_t>(begin, 32768);
+
+            // Positions are relative to window_start; prev is indexed modulo the 32 KiB window
+            std::vector<int32_t> head(1 << 15, -1), prev(1 << 15, -1);
+            auto hash = [&](size_t p)
+            {
+                uint32_t v = data[p] | (data[p + 1] << 8) | (data[p + 2] << 16);
+                return (v * 2654435761u) >> 17;
+            };
+            auto insert = [&](size_t p)
+            {
+                uint32_t h = hash(p);
+                prev[(p - window_start) & 0x7fff] = head[h];
+                head[h] = static_cast<int32_t>(p - window_start);
+            };
+            auto find_match = [&](size_t p, size_t &distance)
+            {
+                size_t limit = std::min<size_t>(258, end - p);
+                size_t best = 2;
+                int32_t candidate = head[hash(p)];
+                for (int chain = 0; candidate >= 0 && chain < max_chain; ++chain)
+                {
+                    size_t c = window_start + candidate;
+                    if (p - c > 32768)
+                        break;
+                    if (data[c + best] == data[p + best])
+                    {
+                        size_t n = 0;
+                        while (n + 8 <= limit && std::memcmp(data + c + n, data + p + n, 8) == 0)
+                            n += 8;
+                        while (n < limit && data[c + n] == data[p + n])
+                            ++n;
+                        if (n > best)
+                        {
+                            best = n;
+                            distance = p - c;
+                            if (n == limit)
+                                break;
+                        }
+                    }
+                    int32_t next = prev[candidate & 0x7fff];
+                    if (next >= candidate)
+                        break; // Slot reused by a newer position
+                    candidate = next;
+                }
+                return best >= 3 ? best : 0;
+            };
+
+            for (size_t p = window_start; p < begin && p + 3 <= end; ++p)
+                insert(p);
+
+            BitWriter bits(out);
+            bits.put(0, 1); // BFINAL = 0
+            bits.put(1, 2); // BTYPE = 01, fixed Huffman
+            size_t p = begin;
+            while (p < end)
+            {
+                size_t length = 0, distance = 0;
+                if (p + 3 <= end)
+                {
+                    length = find_match(p, distance);
+                    insert(p);
+                }
+                if (length > 0 && lazy && length < 258 && p + 4 <= end)
+                {
+                    // Lazy matching: keep this byte as a literal if the match starting at the next one is longer
+                    size_t next_distance = 0;
+                    if (find_match(p + 1, next_distance) > length)
+                        length = 0;
+                }
+
+                if (length > 0)
+                {
+                    unsigned int s = huffman.length_symbol[length];
+                    bits.put(huffman.literal_code[257 + s], huffman.literal_bits[257 + s]);
+                    if (FixedHuffman::length_extra[s])
+                        bits.put(static_cast<uint32_t>(length - FixedHuffman::length_base[s]), FixedHuffman::length_extra[s]);
+                    unsigned int d = huffman.distance_symbol[distance];
+                    bits.put(huffman.distance_code[d], 5);
+                    if (FixedHuffman::distance_extra[d])
+                        bits.put(static_cast<uint32_t>(distance - FixedHuffman::distance_base[d]), FixedHuffman::distance_extra[d]);
+
+                    // Fast levels skip the hashing of long repeats, the flat areas of a plot
+                    size_t last = (level <= 3 && length > 16) ? p + 1 : p + length;
+                    for (size_t q = p + 1; q < last && q + 3 <= end; ++q)
+                        insert(q);
+                    p += length;
+                }
+                else
+                {
+                    bits.put(huffman.literal_code[data[p]], huffman.literal_bits[data[p]]);
+                    ++p;
+                }
+            }
+            bits.put(huffman.literal_code[256], huffman.literal_bits[256]); // End of block
+            bits.put(0, 3);                                                 // Empty stored block: BFINAL = 0, BTYPE = 00
+            bits.align();
+        }
+
+        // Stored blocks when compression is off or does not pay
+        size_t size = end - begin;
+        if (level == 0 || out.size() - out_start > size + 5 * (size / 65535 + 1))
+        {
+            out.resize(out_start);
+            append_stored_blocks(data + begin, size, out);
+        }
+        else
+        {
+            const unsigned char sync[4] = {0x00, 0x00, 0xff, 0xff}; // LEN = 0, NLEN of the empty stored block
+            out.insert(out.end(), sync, sync + 4);
+        }
+    }
+
+    uint32_t adler32(const unsigned char *data, size_t size)
+    {
+        uint32_t s1 = 1, s2 = 0;
+        while (size > 0)
+        {
+            size_t n = std::min<size_t>(size, 5552);
+            for (size_t i = 0; i < n; ++i)
+            {
+                s1 += data[i];
+                s2 += s1;
+            }
+            s1 %= 65521;
+            s2 %= 65521;
+            data += n;
+            size -= n;
+        }
+        return (s2 << 16) | s1;
+    }
+
+    // Adler-32 of the concatenation of two buffers, from their checksums (as adler32_combine() of zlib)
+    uint32_t adler32_combine(uint32_t first, uint32_t second, size_t second_size)
+    {
+        const uint32_t base = 65521;
+        uint32_t rem = static_cast<uint32_t>(second_size % base);
+        uint32_t sum1 = first & 0xffff;
+        uint32_t sum2 = static_cast<uint32_t>((static_cast<uint64_t>(rem) * sum1) % base);
+        sum1 += (second & 0xffff) + base - 1;
+        sum2 += (first >> 16) + (second >> 16) + base - rem;
+        if (sum1 >= base)
+            sum1 -= base;
+        if (sum1 >= base)
+            sum1 -= base;
+        if (sum2 >= 2 * base)
+            sum2 -= 2 * base;
+        if (sum2 >= base)
+            sum2 -= base;
+        return (sum2 << 16) | sum1;
+    }
+
+    void put_u32(std::vector<unsigned char> &out, uint32_t value)
+    {
+        out.push_back(static_cast<unsigned char>(value >> 24));
+        out.push_back(static_cast<unsigned char>(value >> 16));
+        out.push_back(static_cast<unsigned char>(value >> 8));
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    // Close a chunk started with put_u32(0) and its type at offset start: length, then CRC of type and data
+    void close_chunk(std::vector<unsigned char> &out, size_t start)
+    {
+        uint32_t length = static_cast<uint32_t>(out.size() - start - 8);
+        for (int i = 0; i < 4; ++i)
+            out[start + i] = static_cast<unsigned char>(length >> (24 - 8 * i));
+        put_u32(out, stbiw__crc32(out.data() + start + 4, static_cast<int>(length + 4)));
+    }
+
+    void open_chunk(std::vector<unsigned char> &out, const char *type)
+    {
+        put_u32(out, 0);
+        out.insert(out.end(), type, type + 4);
+    }
+
+    unsigned char paeth(int a, int b, int c)
+    {
+        int p = a + b - c, pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+        if (pa <= pb && pa <= pc)
+            return static_cast<unsigned char>(a);
+        return static_cast<unsigned char>(pb <= pc ? b : c);
+    }
+
+    // Apply PNG filter type (0 to 4) to a row; prior is the previous row, all zero for the first one
+    void filter_row(int type, const unsigned char *row, const unsigned char *prior, size_t size, unsigned int bpp,
+                    unsigned char *out)
+    {
+        const size_t first = std::min<size_t>(bpp, size); // Bytes of the first pixel, without left neighbour
+        switch (type)
+        {
+        case 1:
+            std::memcpy(out, row, first);
+            for (size_t i = first; i < size; ++i)
+                out[i] = static_cast<unsigned char>(row[i] - row[i - bpp]);
+            break;
+        case 2:
+            for (size_t i = 0; i < size; ++i)
+                out[i] = static_cast<unsigned char>(row[i] - prior[i]);
+            break;
+        case 3:
+            for (size_t i = 0; i < first; ++i)
+                out[i] = static_cast<unsigned char>(row[i] - (prior[i] >> 1));
+            for (size_t i = first; i < size; ++i)
+                out[i] = static_cast<unsigned char>(row[i] - ((row[i - bpp] + prior[i]) >> 1));
+            break;
+        case 4:
+            for (size_t i = 0; i < first; ++i)
+                out[i] = static_cast<unsigned char>(row[i] - prior[i]);
+            for (size_t i = first; i < size; ++i)
+                out[i] = static_cast<unsigned char>(row[i] - paeth(row[i - bpp], prior[i], prior[i - bpp]));
+            break;
+        default:
+            std::memcpy(out, row, size);
+            break;
+        }
+    }
+
+    // Sum of the filtered bytes taken as signed, the usual estimate of how well a row compresses
+    size_t filter_cost(const unsigned char *filtered, size_t size)
+    {
+        size_t cost = 0;
+        for (size_t i = 0; i < size; ++i)
+            cost += static_cast<size_t>(std::abs(static_cast<int>(static_cast<signed char>(filtered[i]))));
+        return cost;
+    }
+}
+
+// PNG encoder fed band by band with packed rows (width * channels bytes each, top row first).
+// The rows of a band are filtered on parallel_chunks() workers, then the filtered bytes are split
+// into segments deflated in parallel, each written as its own IDAT chunk. The 32 KiB of filtered
+// data preceding a segment serve as its dictionary, so memory is bounded by the band size.
+class PlotGen::PngStream
+{
+public:
+    // filter: 0 to 4 for a fixed PNG filter type, 5 for "sub-up", 6 for "adaptive".
+    // With a palette, rows hold one index per pixel (channels = 1) and a PLTE chunk is written.
+    // Each band is filtered and compressed by up to `threads` threads (0: one per core).
+    PngStream(ByteSink sink, unsigned int width, unsigned int height, unsigned int channels, int level, int filter,
+              const std::vector<sf::Color> *palette = nullptr, unsigned int threads = 0)
+        : sink(std::move(sink)), width(width), height(height), channels(channels), level(level), filter(filter),
+          workers(threads ? threads : std::max(1u, std::thread::hardware_concurrency())),
+          prior(static_cast<size_t>(width) * channels, 0)
+    {
+        static const unsigned char color_types[5] = {0, 0, 4, 2, 6}; // Gray, gray + alpha, RGB, RGBA
+
+        std::vector<unsigned char> out = {137, 80, 78, 71, 13, 10, 26, 10};
+        open_chunk(out, "IHDR");
+        put_u32(out, width);
+        put_u32(out, height);
+        out.push_back(8); // Bit depth
+        out.push_back(palette ? 3 : color_types[channels]);
+        out.push_back(0); // Deflate
+        out.push_back(0); // Adaptive filtering
+        out.push_back(0); // No interlace
+        close_chunk(out, 8);
+        if (palette)
+        {
+            size_t start = out.size();
+            open_chunk(out, "PLTE");
+            for (const sf::Color &color : *palette)
+            {
+                out.push_back(color.r);
+                out.push_back(color.g);
+                out.push_back(color.b);
+            }
+            close_chunk(out, start);
+        }
+        this->sink(out.data(), out.size());
+    }
+
+    void write_rows(const unsigned char *rows, unsigned int count)
+    {
+        if (count == 0)
+            return;
+        if (rows_written + count > height)
+            throw std::out_of_range("More rows than the PNG image height");
+
+        const size_t row_size = static_cast<size_t>(width) * channels;
+        const size_t band_size = count * (row_size + 1);
+        const size_t history = window.size();
+        window.resize(history + band_size);
+        unsigned char *filtered = window.data() + history;
+
+        parallel_chunks(count, 16, [&](size_t begin, size_t end, unsigned int)
+                        {
+            std::vector<unsigned char> candidate(row_size);
+            for (size_t r = begin; r < end; ++r)
+            {
+                const unsigned char *row = rows + r * row_size;
+                const unsigned char *above = r > 0 ? row - row_size : prior.data();
+                unsigned char *out = filtered + r * (row_size + 1);
+                if (filter <= 4)
+                {
+                    out[0] = static_cast<unsigned char>(filter);
+                    filter_row(filter, row, above, row_size, channels, out + 1);
+                    continue;
+                }
+
+                // Sub suits horizontal runs and Up the vertical ones, which covers most of a plot
+                static const int sub_up[2] = {1, 2};
+                static const int all[5] = {0, 1, 2, 3, 4};
+                const int *types = filter == 5 ? sub_up : all;
+                const int type_count = filter == 5 ? 2 : 5;
+                size_t best_cost = std::numeric_limits<size_t>::max();
+                for (int t = 0; t < type_count; ++t)
+                {
+                    filter_row(types[t], row, above, row_size, channels, candidate.data());
+                    size_t cost = filter_cost(candidate.data(), row_size);
+                    if (cost < best_cost)
+                    {
+                        best_cost = cost;
+                        out[0] = static_cast<unsigned char>(types[t]);
+                        std::memcpy(out + 1, candidate.data(), row_size);
+                    }
+                }
+            } }, workers);
+
+        // One segment per worker, in order of the worker index
+        std::vector<std::vector<unsigned char>> chunks(workers);
+        std::vector<uint32_t> checksums(workers);
+        std::vector<size_t> sizes(workers, 0);
+        const bool first = rows_written == 0;
+        parallel_chunks(band_size, 256 * 1024, [&](size_t begin, size_t end, unsigned int worker)
+                        {
+            std::vector<unsigned char> &out = chunks[worker];
+            out.reserve(level == 0 ? end - begin + (end - begin) / 65535 * 5 + 32 : (end - begin) / 4 + 64);
+            open_chunk(out, "IDAT");
+            if (first && worker == 0)
+            {
+                // zlib header: 32 KiB window, FLEVEL hint
+                out.push_back(0x78);
+                out.push_back(level <= 1 ? 0x01 : level <= 5 ? 0x5e : level == 6 ? 0x9c : 0xda);
+            }
+            deflate_segment(window.data(), history + begin, history + end, level, out);
+            close_chunk(out, 0);
+            checksums[worker] = adler32(filtered + begin, end - begin);
+            sizes[worker] = end - begin; }, workers);
+
+        for (size_t w = 0; w < workers; ++w)
+        {
+            if (sizes[w] == 0)
+                continue;
+            sink(chunks[w].data(), chunks[w].size());
+            adler = adler32_combine(adler, checksums[w], sizes[w]);
+        }
+
+        std::memcpy(prior.data(), rows + (count - 1) * row_size, row_size);
+        if (window.size() > 32768)
+            window.erase(window.begin(), window.end() - 32768);
+        rows_written += count;
+    }
+
+    void finish()
+    {
+        if (rows_written != height)
+            throw std::runtime_error("Missing rows in the PNG image");
+
+        // Final empty stored block, then the Adler-32 of all the filtered data
+        std::vector<unsigned char> out;
+        open_chunk(out, "IDAT");
+        const unsigned char last_block[5] = {0x01, 0x00, 0x00, 0xff, 0xff};
+        out.insert(out.end(), last_block, last_block + 5);
+        put_u32(out, adler);
+        close_chunk(out, 0);
+        size_t end = out.size();
+        open_chunk(out, "IEND");
+        close_chunk(out, end);
+        sink(out.data(), out.size());
+    }
+
+private:
+    ByteSink sink;
+    unsigned int width, height, channels;
+    int level, filter;
+    unsigned int workers;
+    std::vector<unsigned char> prior;  // Last row of the previous band
+    std::vector<unsigned char> window; // Last 32 KiB of filtered data, followed by the band being encoded
+    uint32_t adler = 1;
+    unsigned int rows_written = 0;
+};
+
+// Build a palette of at most max_colors entries for RGBA pixels, in one parallel pass over a
+// histogram of 15-bit (5-5-5) color cells. lut maps each cell to its palette index. When the image
+// has no more exact colors than the palette can hold, the result is lossless and true is returned:
+// the colors of a cell are then consecutive palette entries from lut[cell] (a second pass over the
+// pixels of the cells holding several colors collects them). Otherwise the most frequent cells
+// become the palette (with the mean color of their pixels) and the others, mostly anti-aliased
+// edges, map to the nearest palette entry.
+bool PlotGen::quantize_palette(const sf::Uint8 *rgba, size_t count, unsigned int max_colors,
+                               std::vector<sf::Color> &palette, std::vector<uint8_t> &lut)
+{
+    const size_t cells = 1 << 15;
+    struct Cell
+    {
+        uint64_t pixels = 0, r = 0, g = 0, b = 0;
+        uint32_t color = 0; // First exact color seen (0xRRGGBB)
+        bool mixed = false; // More than one exact color in the cell
+    };
+    auto cell_of = [](const sf::Uint8 *p)
+    { return ((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3); };
+
+    const size_t workers = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::vector<Cell>> partial(workers);
+    parallel_chunks(count, 1 << 18, [&](size_t begin, size_t end, unsigned int worker)
+                    {
+        std::vector<Cell> &histogram = partial[worker];
+        histogram.resize(cells);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const sf::Uint8 *p = rgba + 4 * i;
+            Cell &cell = histogram[cell_of(p)];
+            uint32_t color = (p[0] << 16) | (p[1] << 8) | p[2];
+            if (cell.pixels == 0)
+                cell.color = color;
+            else if (cell.color != color)
+                cell.mixed = true;
+            ++cell.pixels;
+            cell.r += p[0];
+            cell.g += p[1];
+            cell.b += p[2];
+        } });
+
+    std::vector<Cell> histogram(cells);
+    for (const auto &part : partial)
+    {
+        for (size_t c = 0; c < part.size(); ++c)
+        {
+            const Cell &from = part[c];
+            if (from.pixels == 0)
+                continue;
+            Cell &cell = histogram[c];
+            if (cell.pixels == 0)
+                cell.color = from.color;
+            else if (cell.color != from.color)
+                cell.mixed = true;
+            cell.mixed = cell.mixed || from.mixed;
+            cell.pixels += from.pixels;
+            cell.r += from.r;
+            cell.g += from.g;
+            cell.b += from.b;
+        }
+    }
+
+    std::vector<uint32_t> used;
+    bool exact = true;
+    for (size_t c = 0; c < cells; ++c)
+    {
+        if (histogram[c].pixels == 0)
+            continue;
+        used.push_back(static_cast<uint32_t>(c));
+        exact = exact && !histogram[c].mixed;
+    }
+    palette.clear();
+    lut.assign(cells, 0);
+
+    // Cells with several exact colors: the image may still have few enough colors for a lossless
+    // palette. Each worker gathers the colors of those cells in a small hash set, and all of them
+    // give up as soon as one set exceeds the palette.
+    if (!exact && used.size() <= max_colors)
+    {
+        const uint32_t empty = 0xffffffffu; // Not a 24-bit color
+        const size_t slots = 1024;          // More than twice the largest palette
+        std::vector<std::vector<uint32_t>> found(workers);
+        std::atomic<bool> overflow(false);
+        parallel_chunks(count, 1 << 18, [&](size_t begin, size_t end, unsigned int worker)
+                        {
+            std::vector<uint32_t> table(slots, empty);
+            size_t distinct = 0;
+            uint32_t last = empty;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const sf::Uint8 *p = rgba + 4 * i;
+                uint32_t color = (p[0] << 16) | (p[1] << 8) | p[2];
+                if (color == last || !histogram[cell_of(p)].mixed)
+                    continue;
+                last = color;
+                size_t slot = (color * 2654435761u) >> 22;
+                while (table[slot] != empty && table[slot] != color)
+                    slot = (slot + 1) & (slots - 1);
+                if (table[slot] == empty)
+                {
+                    table[slot] = color;
+                    if (++distinct > max_colors || ((distinct & 63) == 0 && overflow))
+                    {
+                        overflow = true;
+                        return;
+                    }
+                }
+            }
+            for (uint32_t color : table)
+            {
+                if (color != empty)
+                    found[worker].push_back(color);
+            } });
+
+        if (!overflow)
+        {
+            // (cell, color) pairs, sorted so that the colors of a cell are consecutive
+            std::vector<uint64_t> entries;
+            for (const auto &colors : found)
+            {
+                for (uint32_t color : colors)
+                {
+                    sf::Uint8 p[3] = {static_cast<sf::Uint8>(color >> 16), static_cast<sf::Uint8>(color >> 8), static_cast<sf::Uint8>(color)};
+                    entries.push_back((static_cast<uint64_t>(cell_of(p)) << 24) | color);
+                }
+            }
+            for (uint32_t c : used)
+            {
+                if (!histogram[c].mixed)
+                    entries.push_back((static_cast<uint64_t>(c) << 24) | histogram[c].color);
+            }
+            std::sort(entries.begin(), entries.end());
+            entries.erase(std::unique(entries.begin(), entries.end()), entries.end());
+            if (entries.size() <= max_colors)
+            {
+                for (size_t i = 0; i < entries.size(); ++i)
+                {
+                    uint32_t cell = static_cast<uint32_t>(entries[i] >> 24);
+                    uint32_t color = static_cast<uint32_t>(entries[i] & 0xffffff);
+                    if (i == 0 || (entries[i - 1] >> 24) != cell)
+                        lut[cell] = static_cast<uint8_t>(i);
+                    palette.push_back(sf::Color(color >> 16, (color >> 8) & 0xff, color & 0xff));
+                }
+                return true;
+            }
+        }
+    }
+
+    exact = exact && used.size() <= max_colors;
+    std::sort(used.begin(), used.end(), [&](uint32_t a, uint32_t b)
+              { return histogram[a].pixels > histogram[b].pixels; });
+
+    auto mean_color = [&](uint32_t c)
+    {
+        const Cell &cell = histogram[c];
+        if (!cell.mixed)
+            return sf::Color(cell.color >> 16, (cell.color >> 8) & 0xff, cell.color & 0xff);
+        return sf::Color(static_cast<sf::Uint8>((cell.r + cell.pixels / 2) / cell.pixels),
+                         static_cast<sf::Uint8>((cell.g + cell.pixels / 2) / cell.pixels),
+                         static_cast<sf::Uint8>((cell.b + cell.pixels / 2) / cell.pixels));
+    };
+
+    const size_t kept = std::min<size_t>(used.size(), max_colors);
+    for (size_t i = 0; i < kept; ++i)
+    {
+        palette.push_back(mean_color(used[i]));
+        lut[used[i]] = static_cast<uint8_t>(i);
+    }
+    parallel_chunks(used.size() - kept, 256, [&](size_t begin, size_t end, unsigned int)
+                    {
+        for (size_t i = kept + begin; i < kept + end; ++i)
+        {
+            sf::Color color = mean_color(used[i]);
+            int best_distance = std::numeric_limits<int>::max();
+            for (size_t k = 0; k < kept; ++k)
+            {
+                int dr = color.r - palette[k].r, dg = color.g - palette[k].g, db = color.b - palette[k].b;
+                int distance = 3 * dr * dr + 4 * dg * dg + 2 * db * db;
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    lut[used[i]] = static_cast<uint8_t>(k);
+                }
+            }
+        } });
+    return exact;
+}
+
+// Validated settings of the PNG encoder; invalid values are replaced by the defaults with a warning.
+// filter is the code of PngStream: 0 to 4 for a fixed type, 5 for "sub-up", 6 for "adaptive".
+// "auto" is "sub-up" for RGB and "none" for indexed images, whose palette indices of neighbouring
+// pixels are unrelated numbers that the prediction filters only scramble.
+void PlotGen::png_settings(const PngOptions &options, int &level, int &filter, bool &indexed, unsigned int &palette_size)
+{
+    indexed = options.color_type == "indexed";
+    level = options.compression;
+    if (level < 0 || level > 9)
+    {
+        std::cerr << "WARNING: Invalid PNG compression level. Using default 8." << std::endl;
+        level = 8;
+    }
+    static const std::map<std::string, int> filters = {
+        {"none", 0}, {"sub", 1}, {"up", 2}, {"average", 3}, {"paeth", 4}, {"sub-up", 5}, {"adaptive", 6}};
+    auto found = filters.find(options.filter == "auto" ? (indexed ? "none" : "sub-up") : options.filter);
+    if (found == filters.end())
+    {
+        std::cerr << "WARNING: Unknown PNG filter '" << options.filter << "'. Using 'sub-up'." << std::endl;
+        found = filters.find("sub-up");
+    }
+    filter = found->second;
+    if (!indexed && options.color_type != "rgb")
+    {
+        std::cerr << "WARNING: Unknown PNG color type '" << options.color_type << "'. Using 'rgb'." << std::endl;
+    }
+    palette_size = options.palette_size;
+    if (indexed && (palette_size < 2 || palette_size > 256))
+    {
+        std::cerr << "WARNING: Invalid PNG palette size. Using default 256." << std::endl;
+        palette_size = 256;
+    }
+}
+
+// Convert RGBA pixels to the rows of the PNG: RGB, or palette indices through lut (see quantize_palette).
+// With an exact palette, each pixel takes the entry of its own color among those of its cell.
+void PlotGen::pack_pixels(const sf::Uint8 *rgba, size_t count, const std::vector<uint8_t> *lut,
+                          const std::vector<sf::Color> *exact_palette, unsigned char *out)
+{
+    parallel_chunks(count, 1 << 16, [&](size_t begin, size_t end, unsigned int)
+                    {
+        if (lut && exact_palette)
+        {
+            const sf::Color *palette = exact_palette->data();
+            for (size_t i = begin; i < end; ++i)
+            {
+                const sf::Uint8 *p = rgba + 4 * i;
+                uint8_t index = (*lut)[((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3)];
+                while (palette[index].r != p[0] || palette[index].g != p[1] || palette[index].b != p[2])
+                    ++index;
+                out[i] = index;
+            }
+            return;
+        }
+        if (lut)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                const sf::Uint8 *p = rgba + 4 * i;
+                out[i] = (*lut)[((p[0] >> 3) << 10) | ((p[1] >> 3) << 5) | (p[2] >> 3)];
+            }
+            return;
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            out[3 * i] = rgba[4 * i];
+            out[3 * i + 1] = rgba[4 * i + 1];
+            out[3 * i + 2] = rgba[4 * i + 2];
+        } });
+}
+
+// Encode RGBA pixels (top row first) to an RGB or palette PNG, band by band
+void PlotGen::write_png(const ByteSink &sink, const sf::Uint8 *rgba, unsigned int width, unsigned int height,
+                        const PngOptions &options)
+{
+    int level, filter;
+    bool indexed;
+    unsigned int palette_size;
+    png_settings(options, level, filter, indexed, palette_size);
+    if (width == 0 || height == 0)
+    {
+        throw std::invalid_argument("Cannot save an empty image");
+    }
+
+    // Palette first, since it precedes the image data
+    std::vector<sf::Color> palette;
+    std::vector<uint8_t> lut;
+    bool exact = false;
+    if (indexed)
+    {
+        exact = quantize_palette(rgba, static_cast<size_t>(width) * height, palette_size, palette, lut);
+    }
+
+    const unsigned int channels = indexed ? 1 : 3;
+    PngStream png(sink, width, height, channels, level, filter, indexed ? &palette : nullptr, options.threads);
+
+    // The image is opaque: the alpha channel is dropped, a quarter less data to filter and compress
+    const size_t row_size = static_cast<size_t>(width) * channels;
+    const unsigned int band_rows = static_cast<unsigned int>(std::max<size_t>(1, (8u << 20) / row_size));
+    std::vector<unsigned char> band(std::min<size_t>(band_rows, height) * row_size);
+    for (unsigned int y = 0; y < height; y += band_rows)
+    {
+        unsigned int count = std::min(band_rows, height - y);
+        pack_pixels(rgba + static_cast<size_t>(y) * width * 4, static_cast<size_t>(count) * width, indexed ? &lut : nullptr,
+                    exact ? &palette : nullptr, band.data());
+        png.write_rows(band.data(), count);
+    }
+    png.finish();
+}
+
+// Render a tiled image band by band (one row of tiles) straight into the PNG encoder: memory is
+// bounded by one band of the image instead of the whole image. The palette of "indexed" would
+// need all the pixels before the first row, such images are written as RGB.
+void PlotGen::write_png_tiled(const ByteSink &sink, const PngOptions &options)
+{
+    // Settings of the RGB image, the "auto" filter included
+    PngOptions rgb_options = options;
+    if (options.color_type == "indexed")
+    {
+        std::cerr << "WARNING: Indexed PNG is not available for a tiled image. Using 'rgb'." << std::endl;
+        rgb_options.color_type = "rgb";
+    }
+    int level, filter;
+    bool indexed;
+    unsigned int palette_size;
+    png_settings(rgb_options, level, filter, indexed, palette_size);
+
+    PngStream png(sink, width, height, 3, level, filter, nullptr, options.threads);
+    const unsigned int band_height = texture->getSize().y;
+    const size_t row_size = static_cast<size_t>(width) * 3;
+    const unsigned int step = static_cast<unsigned int>(std::max<size_t>(1, (8u << 20) / row_size));
+    std::vector<sf::Uint8> band;
+    std::vector<unsigned char> rows(std::min(step, band_height) * row_size);
+    for (unsigned int y = 0; y < height; y += band_height)
+    {
+        unsigned int count = std::min(band_height, height - y);
+        render_band(y, count, band);
+        for (unsigned int r = 0; r < count; r += step)
+        {
+            unsigned int n = std::min(step, count - r);
+            pack_pixels(band.data() + static_cast<size_t>(r) * width * 4, static_cast<size_t>(width) * n, nullptr, nullptr, rows.data());
+            png.write_rows(rows.data(), n);
+        }
+    }
+    png.finish();
+}
+
+void PlotGen::save_png(const std::string &filename, const PngOptions &options)
+{
+    std::ofstream file(filename, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Unable to save image in PNG format");
+    }
+    encode_png(options, [&](const unsigned char *data, size_t size)
+               { file.write(reinterpret_cast<const char *>(data), static_cast<std::streamsize>(size)); });
+    if (!file.flush())
+    {
+        throw std::runtime_error("Unable to save image in PNG format");
+    }
+    std::cout << "Image saved to: " << filename << " (Dimensions: " << width << "x" << height << ")" << std::endl;
+}
+
+void PlotGen::encode_png(const PngOptions &options, const ByteSink &sink)
+{
+    render();
+    if (tiled())
+    {
+        write_png_tiled(sink, options);
+        return;
+    }
+    sf::Image screenshot = read_back();
+    write_png(sink, screenshot.getPixelsPtr(), width, height, options);
+}
+
+// Render and save the jobs on a bounded pool of threads. A worker takes the next job, lends
+// its render texture to the PlotGen when the size matches (instead of creating a new OpenGL
+// context for each plot) and takes it back afterwards. Fonts are per thread, see shared_font().
+std::vector<PlotGen::BatchResult> PlotGen::render_batch(const std::vector<BatchJob> &jobs, unsigned int threads)
+{
+    std::set<const PlotGen *> instances;
+    for (const auto &job : jobs)
+    {
+        if (!job.plot && !job.build)
+            throw std::invalid_argument("A batch job needs a PlotGen or a build function");
+        if (job.plot && !instances.insert(job.plot).second)
+            throw std::invalid_argument("A PlotGen can only appear once in a batch");
+        // Its render texture is used by a worker thread from now on
+        if (job.plot && job.plot->texture)
+            job.plot->texture->setActive(false);
+    }
+
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned int>(std::min<size_t>(threads, jobs.size()));
+
+    std::vector<BatchResult> results(jobs.size());
+    std::atomic<size_t> next(0);
+
+    auto worker = [&]()
+    {
+        std::unique_ptr<sf::RenderTexture> context; // Reused from one job to the next
+        for (size_t index = next++; index < jobs.size(); index = next++)
+        {
+            const BatchJob &job = jobs[index];
+            BatchResult &result = results[index];
+            result.filename = job.filename;
+
+            std::unique_ptr<PlotGen> owned;
+            PlotGen *plot = job.plot;
+            bool lent = false;
+            auto start = std::chrono::steady_clock::now();
+            auto elapsed_ms = [&start]()
+            {
+                auto now = std::chrono::steady_clock::now();
+                double ms = std::chrono::duration<double, std::milli>(now - start).count();
+                start = now;
+                return ms;
+            };
+
+            try
+            {
+                if (!plot)
+                {
+                    owned.reset(new PlotGen(job.width, job.height, job.rows, job.cols));
+                    plot = owned.get();
+                    job.build(*plot);
+                    result.build_ms = elapsed_ms();
+                }
+
+                const bool svg = file_format(job.filename) == "svg";
+                if (svg)
+                {
+                    plot->save(job.filename);
+                }
+                else
+                {
+                    if (!plot->texture && !plot->vector_only)
+                    {
+                        if (context && context->getSize() == sf::Vector2u(plot->width, plot->height))
+                            plot->texture = std::move(context);
+                        lent = true;
+                    }
+                    plot->render();
+                    result.render_ms = elapsed_ms();
+                    plot->encode_image(job.filename);
+                }
+                result.encode_ms = elapsed_ms();
+                result.ok = true;
+            }
+            catch (const std::exception &e)
+            {
+                result.error = e.what();
+            }
+
+            // Keep the texture created or lent for this job, it belongs to this thread
+            if (lent && plot->texture)
+                context = std::move(plot->texture);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; ++t)
+        pool.emplace_back(worker);
+    worker();
+    for (auto &t : pool)
+        t.join();
+
+    return results;
+}
+
+// Implémentation de la méthode d'export SVG
+void PlotGen::save_svg(const std::string &filename)
+{
+    // Créer un fichier SVG
+    std::ofstream svg_file(filename);
+    if (!svg_file.is_open())
+    {
+        throw std::runtime_error("Unable to create SVG file");
+    }
+    save_svg(svg_file);
+    svg_file.close();
+
+    std::cout << "SVG vectoriel exporté vers: " << filename << " (Dimensions: " << width << "x" << height << ")" << std::endl;
+}
+
+// Write the SVG document to a stream
+void PlotGen::save_svg(std::ostream &svg_file)
+{
+    // Écrire l'en-tête SVG
+    svg_file << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
+    svg_file << "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n";
+    svg_file << "<svg width=\"" << width << "\" height=\"" << height << "\" xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" version=\"1.1\">\n";
+
+    // Fond blanc
+    svg_file << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+
+    // Calculer les dimensions de chaque sous-figure
+    double subplot_width = static_cast<double>(width) / cols;
+    double subplot_height = static_cast<double>(height) / rows;
+
+    // Counter of the ids defined in this document (gradients, marker shapes). It is local, so that
+    // documents generated concurrently by several threads do not share it
+    unsigned long svg_ids = 0;
+
+    // Exporter chaque figure
+    for (size_t fig_idx = 0; fig_idx < figures.size(); ++fig_idx)
+    {
+        const Figure &fig = figures[fig_idx];
+
+        // Calculer la position de la figure
+        unsigned int row = fig_idx / cols;
+        unsigned int col = fig_idx % cols;
+        double x_offset = col * subplot_width;
+        double y_offset = row * subplot_height;
+
+        // Définir la taille effective de la figure en tenant compte de equal_axes si nécessaire
+        double effective_width = subplot_width;
+        double effective_height = subplot_height;
+        double margin = 50.0;
+
+        if (fig.equal_axes || fig.is_polar)
+        {
+            double min_size = std::min(effective_width, effective_height);
+            effective_width = min_size;
+            effective_height = min_size;
+            // Ajuster les offsets pour centrer la figure
+            x_offset += (subplot_width - effective_width) / 2.0;
+            y_offset += (subplot_height - effective_height) / 2.0;
+        }
+
+        // Créer un groupe pour cette figure avec transformation appropriée
+        svg_file << "<g transform=\"translate(" << x_offset << "," << y_offset << ")\">\n";
+
+        // Ajouter une bordure autour de la figure
+        svg_file << "<rect x=\"0\" y=\"0\" width=\"" << effective_width << "\" height=\"" << effective_height
+                 << "\" fill=\"none\" stroke=\"black\" stroke-width=\"1\"/>\n";
+
+        // Dimensions internes de la figure (zone de tracé)
+        double graph_width = effective_width - 2 * margin;
+        double graph_height = effective_height - 2 * margin;
+
+        // Dessiner les grilles avant les axes
+        if (fig.show_major_grid || fig.show_minor_grid)
+        {
+            if (fig.is_polar)
+            {
+                export_svg_polar_grid(fig, svg_file, margin, margin, graph_width, graph_height);
+            }
+            else
+            {
+                export_svg_grid(fig, svg_file, margin, margin, graph_width, graph_height);
+            }
+        }
+
+        // Dessiner les axes X et Y seulement pour les graphes non-polaires
+        if (!fig.is_polar)
+        {
+            // Axe X
+            double x_axis_y = margin + graph_height - y_fraction(fig, 0) * graph_height;
+            x_axis_y = std::min(x_axis_y, margin + graph_height);
+            x_axis_y = std::max(x_axis_y, margin);
+
+            svg_file << "<line x1=\"" << margin << "\" y1=\"" << x_axis_y
+                     << "\" x2=\"" << (margin + graph_width) << "\" y2=\"" << x_axis_y
+                     << "\" stroke=\"black\" stroke-width=\"1.5\"/>\n";
+
+            // Axe Y
+            double y_axis_x = margin + (0 - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
+            y_axis_x = std::min(y_axis_x, margin + graph_width);
+            y_axis_x = std::max(y_axis_x, margin);
+
+            svg_file << "<line x1=\"" << y_axis_x << "\" y1=\"" << margin
+                     << "\" x2=\"" << y_axis_x << "\" y2=\"" << (margin + graph_height)
+                     << "\" stroke=\"black\" stroke-width=\"1.5\"/>\n";
+
+            // Dessiner les graduations sur l'axe X
+            const int numTicksX = 5;
+            for (int i = 0; i <= numTicksX; ++i)
+            {
+                double x = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
+                double sx = margin + (x - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
+
+                // Trait de graduation
+                svg_file << "<line x1=\"" << sx << "\" y1=\"" << x_axis_y
+                         << "\" x2=\"" << sx << "\" y2=\"" << (x_axis_y + 5)
+                         << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
+
+                // Texte de la graduation
+                std::string tickText;
+                if (std::abs(x) < 0.01)
+                {
+                    tickText = "0";
+                }
+                else if (std::abs(x) < 10)
+                {
+                    char buffer[10];
+                    std::snprintf(buffer, sizeof(buffer), "%.1f", x);
+                    tickText = buffer;
+                }
+                else
+                {
+                    tickText = std::to_string(static_cast<int>(x));
+                }
+
+                svg_file << "<text x=\"" << sx << "\" y=\"" << (x_axis_y + 20)
+                         << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"12\">"
+                         << tickText << "</text>\n";
+            }
+
+            // Dessiner les graduations sur l'axe Y
+            const int numTicksY = 5;
+            for (int i = 0; i <= numTicksY; ++i)
+            {
+                double y = y_from_fraction(fig, static_cast<double>(i) / numTicksY);
+                double sy = margin + graph_height - y_fraction(fig, y) * graph_height;
+
+                // Trait de graduation
+                svg_file << "<line x1=\"" << y_axis_x << "\" y1=\"" << sy
+                         << "\" x2=\"" << (y_axis_x - 5) << "\" y2=\"" << sy
+                         << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
+
+                // Texte de la graduation
+                std::string tickText;
+                if (fig.log_y)
+                {
+                    char buffer[16];
+                    std::snprintf(buffer, sizeof(buffer), "%.0e", y);
+                    tickText = buffer;
+                }
+                else if (std::abs(y) < 0.01)
+                {
+                    tickText = "0";
+                }
+                else if (std::abs(y) < 10)
+                {
+                    char buffer[10];
+                    std::snprintf(buffer, sizeof(buffer), "%.1f", y);
+                    tickText = buffer;
+                }
+                else
+                {
+                    tickText = std::to_string(static_cast<int>(y));
+                }
+
+                svg_file << "<text x=\"" << (y_axis_x - 15) << "\" y=\"" << (sy + 5)
+                         << "\" text-anchor=\"end\" font-family=\"Arial\" font-size=\"12\">"
+                         << tickText << "</text>\n";
+            }
+        }
+
+        // Dessiner les courbes
+        for (size_t i = 0; i < fig.curves.size(); ++i)
+        {
+            if (i < fig.curve_types.size())
+            {
+                const auto &curve = fig.curves[i];
+                const auto &curve_type = fig.curve_types[i];
+
+                if (curve_type == "2D" || curve_type == "POLAR" || curve_type == "STREAM" || curve_type == "MAPPED")
+                {
+                    export_svg_curve(fig, curve, svg_file, margin, margin, graph_width, graph_height);
+                }
+                else if (curve_type == "HIST")
+                {
+                    export_svg_histogram(fig, curve, svg_file, margin, margin, graph_width, graph_height);
+                }
+                else if (curve_type == "SCATTER")
+                {
+                    export_svg_scatter(fig, curve, svg_file, margin, margin, graph_width, graph_height, svg_ids);
+                }
+                else if (curve_type == "DENSITY")
+                {
+                    export_svg_density(fig, curve, svg_file, margin, margin, graph_width, graph_height);
+                }
+                else if (curve_type == "TEXT")
+                {
+                    // Gérer le texte dans les figures
+                    if (!curve.text_content.empty() && !curve.x.empty() && !curve.y.empty())
+                    {
+                        double sx = margin + (curve.x[0] - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
+                        double sy = margin + graph_height - (curve.y[0] - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
+
+                        svg_file << "<text x=\"" << sx << "\" y=\"" << sy
+                                 << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\""
+                                 << (curve.style.thickness > 0 ? curve.style.thickness * 6 : 12)
+                                 << "\" fill=\"" << color_to_svg(curve.style.color) << "\">"
+                                 << curve.text_content << "</text>\n";
+                    }
+                }
+                else if (curve_type == "ARROW_HEAD")
+                {
+                    // Gérer les flèches
+                    if (curve.x.size() >= 2 && curve.y.size() >= 2)
+                    {
+                        double x1 = margin + (curve.x[0] - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
+                        double y1 = margin + graph_height - (curve.y[0] - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
+                        double x2 = margin + (curve.x[1] - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
+                        double y2 = margin + graph_height - (curve.y[1] - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
+
+                        // Dessiner la ligne de la flèche
+                        svg_file << "<line x1=\"" << x1 << "\" y1=\"" << y1
+                                 << "\" x2=\"" << x2 << "\" y2=\"" << y2
+                                 << "\" stroke=\"" << color_to_svg(curve.style.color)
+                                 << "\" stroke-width=\"" << curve.style.thickness << "\"/>\n";
+
+                        // Dessiner la tête de flèche
+                        double angle = std::atan2(y2 - y1, x2 - x1);
+                        double headSize = curve.head_size * 0.5;
+                        double headAngle = 30.0 * M_PI / 180.0; // 30 degrés en radians
+
+                        double x3 = x2 - headSize * std::cos(angle - headAngle);
+                        double y3 = y2 - headSize * std::sin(angle - headAngle);
+                        double x4 = x2 - headSize * std::cos(angle + headAngle);
+                        double y4 = y2 - headSize * std::sin(angle + headAngle);
+
+                        svg_file << "<polygon points=\""
+                                 << x2 << "," << y2 << " "
+                                 << x3 << "," << y3 << " "
+                                 << x4 << "," << y4
+                                 << "\" fill=\"" << color_to_svg(curve.style.color) << "\"/>\n";
+                    }
+                }
+            }
+        }
+
+        // Colorbar
+        if (fig.show_colorbar)
+        {
+            export_svg_colorbar(fig, svg_file, margin, margin, graph_width, graph_height, svg_ids);
+        }
+
+        // Ajouter le titre et les étiquettes des axes
+        if (!fig.title.empty())
+        {
+            svg_file << "<text x=\"" << (effective_width / 2) << "\" y=\"" << (margin / 2)
+                     << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"18\" font-weight=\"bold\">"
+                     << fig.title << "</text>\n";
+        }
+
+        if (!fig.xlabel.empty())
+        {
+            svg_file << "<text x=\"" << (effective_width / 2) << "\" y=\"" << (effective_height - 10)
+                     << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"14\">"
+                     << fig.xlabel << "</text>\n";
+        }
+
+        if (!fig.ylabel.empty())
+        {
+            svg_file << "<text x=\"" << (margin / 3) << "\" y=\"" << (effective_height / 2)
+                     << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"14\" "
+                     << "transform=\"rotate(-90 " << (margin / 3) << "," << (effective_height / 2) << ")\">"
+                     << fig.ylabel << "</text>\n";
+        }
+
+        // Ajouter la légende si nécessaire
+        if (fig.show_leg)
+        {
+            // Compter combien d'entrées de légende nous avons
+            int legend_entries = 0;
+            for (const auto &curve : fig.curves)
+            {
+                if (!curve.style.legend.empty())
+                {
+                    legend_entries++;
+                }
+            }
+
+            if (legend_entries > 0)
+            {
+                double legendWidth = 150;
+                double legendHeight = legend_entries * 20 + 10;
+                double legendX, legendY;
+
+                // Positionner la légende selon la configuration
+                if (fig.legend_position == "top-right")
+                {
+                    legendX = effective_width - legendWidth - 10;
+                    legendY = margin + 10;
+                }
+                else if (fig.legend_position == "top-left")
+                {
+                    legendX = margin + 10;
+                    legendY = margin + 10;
+                }
+                else if (fig.legend_position == "bottom-right")
+                {
+                    legendX = effective_width - legendWidth - 10;
+                    legendY = effective_height - legendHeight - margin;
+                }
+                else if (fig.legend_position == "bottom-left")
+                {
+                    legendX = margin + 10;
+                    legendY = effective_height - legendHeight - margin;
+                }
+                else
+                {
+                    // Position par défaut: top-right
+                    legendX = effective_width - legendWidth - 10;
+                    legendY = margin + 10;
+                }
+
+                // Dessiner le fond de la légende
+                svg_file << "<rect x=\"" << legendX << "\" y=\"" << legendY
+                         << "\" width=\"" << legendWidth << "\" height=\"" << legendHeight
+                         << "\" fill=\"white\" fill-opacity=\"0.8\" stroke=\"black\" stroke-width=\"1\"/>\n";
+
+                // Ajouter chaque entrée de légende
+                double currentY = legendY + 15;
+                for (const auto &curve : fig.curves)
+                {
+                    if (!curve.style.legend.empty())
+                    {
+                        // Dessiner l'exemple de style (ligne et symbole)
+                        if (curve.style.line_style == "solid")
+                        {
+                            svg_file << "<line x1=\"" << (legendX + 10) << "\" y1=\"" << currentY
+                                     << "\" x2=\"" << (legendX + 40) << "\" y2=\"" << currentY
+                                     << "\" stroke=\"" << color_to_svg(curve.style.color)
+                                     << "\" stroke-width=\"" << curve.style.thickness;
+
+                            // Pas de dashed/dotted pour les lignes solides
+                            svg_file << "\"/>\n";
+                        }
+                        else if (curve.style.line_style == "dashed")
+                        {
+                            svg_file << "<line x1=\"" << (legendX + 10) << "\" y1=\"" << currentY
+                                     << "\" x2=\"" << (legendX + 40) << "\" y2=\"" << currentY
+                                     << "\" stroke=\"" << color_to_svg(curve.style.color)
+                                     << "\" stroke-width=\"" << curve.style.thickness
+                                     << "\" stroke-dasharray=\"" << (5 * curve.style.thickness) << ","
+                                     << (3 * curve.style.thickness) << "\"/>\n";
+                        }
+
+                        // Ajouter le symbole si nécessaire
+                        if (curve.style.symbol_type == "circle")
+                        {
+                            svg_file << "<circle cx=\"" << (legendX + 25) << "\" cy=\"" << currentY
+                                     << "\" r=\"" << (curve.style.symbol_size / 2)
+                                     << "\" fill=\"" << color_to_svg(curve.style.color)
+                                     << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
+                        }
+                        else if (curve.style.symbol_type == "square")
+                        {
+                            double halfSize = curve.style.symbol_size / 2;
+                            svg_file << "<rect x=\"" << (legendX + 25 - halfSize) << "\" y=\"" << (currentY - halfSize)
+                                     << "\" width=\"" << curve.style.symbol_size << "\" height=\"" << curve.style.symbol_size
+                                     << "\" fill=\"" << color_to_svg(curve.style.color)
+                                     << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
+                        }
+
+                        // Ajouter le texte de la légende
+                        svg_file << "<text x=\"" << (legendX + 45) << "\" y=\"" << (currentY + 5)
+                                 << "\" font-family=\"Arial\" font-size=\"12\">"
+                                 << curve.style.legend << "</text>\n";
+
+                        currentY += 20;
+                    }
+                }
+            }
+        }
+
+        // Fermer le groupe
+        svg_file << "</g>\n";
+    }
+
+    // Fermeture de la balise SVG
+    svg_file << "</svg>\n";
+}
+
+// Create the render texture on first raster use: constructing a PlotGen only for SVG export
+// does not open an OpenGL context nor allocate the image in graphics memory
+void PlotGen::ensure_texture()
+{
+    if (vector_only)
+    {
+        throw std::runtime_error("Raster output is disabled for a vector-only PlotGen, use save_svg()");
+    }
+    if (texture)
+        return;
+    texture.reset(new sf::RenderTexture());
+    sf::Vector2u size = texture_size();
+    if (!texture->create(size.x, size.y))
+    {
+        texture.reset();
+        throw std::runtime_error("Unable to create the render texture");
+    }
+    texture->setSmooth(true);
+}
+
+void PlotGen::render()
+{
+    ensure_texture();
+
+    std::vector<bool> changed(figures.size(), false);
+    drain_streams(changed);
+
+    // A larger image is rendered tile by tile when it is read back, see render_tile()
+    if (tiled())
+        return;
+
+    texture->clear(sf::Color::White);
+
+    // Go through all subplots
+    for (size_t index = 0; index < figures.size(); ++index)
+    {
+        render_subplot(index);
+    }
+
+    // Restore default view
+    set_view(image_view());
+    texture->display();
+}
+
+// Whether the image is larger than the render texture, which then holds one tile at a time
+bool PlotGen::tiled() const
+{
+    static const unsigned int maximum = sf::Texture::getMaximumSize();
+    unsigned int limit = tile_size > 0 ? std::min(tile_size, maximum) : maximum;
+    return width > limit || height > limit;
+}
+
+// Size of the render texture: the image, or a tile of at most tile_size per side. By default, tiles
+// of 2048 pixels keep the band of tiles read back for the PNG encoder small.
+sf::Vector2u PlotGen::texture_size() const
+{
+    if (!tiled())
+        return sf::Vector2u(width, height);
+    static const unsigned int maximum = sf::Texture::getMaximumSize();
+    unsigned int limit = std::min(tile_size > 0 ? tile_size : 2048u, maximum);
+    return sf::Vector2u(std::min(width, limit), std::min(height, limit));
+}
+
+void PlotGen::set_tile_size(unsigned int size)
+{
+    if (size != 0 && size < 64)
+    {
+        throw std::invalid_argument("The tile size must be 0 (automatic) or at least 64 pixels");
+    }
+    if (size == tile_size)
+        return;
+    if (is_open())
+    {
+        throw std::runtime_error("The tile size cannot change while the window is open");
+    }
+    tile_size = size;
+    texture.reset(); // Created again with the new size by ensure_texture()
+}
+
+// View covering the whole image, in image pixels
+sf::View PlotGen::image_view() const
+{
+    return sf::View(sf::FloatRect(0, 0, static_cast<float>(width), static_cast<float>(height)));
+}
+
+// Apply a view given in image coordinates. While a tile is rendered, its viewport (in pixels, as
+// rounded by SFML) is clipped to the tile, and the view shows only the matching part of the world.
+void PlotGen::set_view(const sf::View &view)
+{
+    canvas_view = view;
+    if (!tiling)
+    {
+        texture->setView(view);
+        return;
+    }
+
+    const sf::FloatRect port = view.getViewport();
+    const int left = static_cast<int>(0.5f + width * port.left), top = static_cast<int>(0.5f + height * port.top);
+    const int right = left + static_cast<int>(0.5f + width * port.width);
+    const int bottom = top + static_cast<int>(0.5f + height * port.height);
+    const sf::Vector2u size = texture->getSize();
+    int clip_left = std::max(left, tile.left), clip_top = std::max(top, tile.top);
+    int clip_right = std::min(right, tile.left + static_cast<int>(size.x));
+    int clip_bottom = std::min(bottom, tile.top + static_cast<int>(size.y));
+    if (right <= left || bottom <= top || clip_right <= clip_left || clip_bottom <= clip_top)
+    {
+        // Not visible in this tile: keep the whole viewport, outside the texture
+        clip_left = left, clip_top = top, clip_right = right, clip_bottom = bottom;
+    }
+
+    const sf::Vector2f world_size = view.getSize();
+    const sf::Vector2f world_origin = view.getCenter() - world_size / 2.0f;
+    const float scale_x = right > left ? world_size.x / (right - left) : 0.0f;
+    const float scale_y = bottom > top ? world_size.y / (bottom - top) : 0.0f;
+    sf::View clipped(sf::FloatRect(world_origin.x + (clip_left - left) * scale_x, world_origin.y + (clip_top - top) * scale_y,
+                                   (clip_right - clip_left) * scale_x, (clip_bottom - clip_top) * scale_y));
+    clipped.setViewport(sf::FloatRect(static_cast<float>(clip_left - tile.left) / size.x, static_cast<float>(clip_top - tile.top) / size.y,
+                                      static_cast<float>(clip_right - clip_left) / size.x, static_cast<float>(clip_bottom - clip_top) / size.y));
+    texture->setView(clipped);
+}
+
+// Render the part of the image at rect (at most the texture size) into the texture
+void PlotGen::render_tile(const sf::IntRect &rect)
+{
+    tiling = true;
+    tile = rect;
+    texture->setView(texture->getDefaultView());
+    texture->clear(sf::Color::White);
+    for (size_t index = 0; index < figures.size(); ++index)
+    {
+        render_subplot(index);
+    }
+    set_view(image_view());
+    texture->display();
+    tiling = false;
+}
+
+// Render the tiles of a row band of the image and copy them into rgba (width pixels per row)
+void PlotGen::render_band(unsigned int y, unsigned int band_height, std::vector<sf::Uint8> &rgba)
+{
+    const sf::Vector2u size = texture->getSize();
+    rgba.resize(static_cast<size_t>(width) * band_height * 4);
+    for (unsigned int x = 0; x < width; x += size.x)
+    {
+        const unsigned int tile_width = std::min(size.x, width - x);
+        render_tile(sf::IntRect(x, y, tile_width, band_height));
+        sf::Image part = texture->getTexture().copyToImage();
+        if (!part.getPixelsPtr() || part.getSize() != size)
+        {
+            throw std::runtime_error("Unable to read back the rendered image");
+        }
+        for (unsigned int row = 0; row < band_height; ++row)
+        {
+            std::memcpy(rgba.data() + (static_cast<size_t>(row) * width + x) * 4,
+                        part.getPixelsPtr() + static_cast<size_t>(row) * size.x * 4, static_cast<size_t>(tile_width) * 4);
+        }
+    }
+}
+
+// Position and size in pixels of the drawing area of a subplot (square for polar graphs and equal axes)
+void PlotGen::subplot_bounds(size_t index, double &left, double &top, double &w, double &h) const
+{
+    unsigned int row = static_cast<unsigned int>(index / cols);
+    unsigned int col = static_cast<unsigned int>(index % cols);
+    const Figure &fig = figures[index];
+
+    double subplot_width = static_cast<double>(width) / cols;
+    double subplot_height = static_cast<double>(height) / rows;
+    left = col * subplot_width;
+    top = row * subplot_height;
+    w = subplot_width;
+    h = subplot_height;
+
+    if (fig.is_polar || fig.equal_axes)
+    {
+        double min_size = std::min(subplot_width, subplot_height);
+        left += (subplot_width - min_size) / 2.0;
+        top += (subplot_height - min_size) / 2.0;
+        w = h = min_size;
+    }
+}
+
+// Draw one subplot into the texture. Precomputed curve geometry (one vertex array per curve,
+// see tessellate_curve) replaces the tessellation of the "2D" and "POLAR" curves when given.
+// The caller must call texture->display() afterwards.
+void PlotGen::render_subplot(size_t index, const std::vector<sf::VertexArray> *geometry)
+{
+    const Figure &fig = figures[index];
+    double left, top, w, h;
+    subplot_bounds(index, left, top, w, h);
+
+    // Erase the previous content of the cell
+    set_view(image_view());
+    sf::RectangleShape background(sf::Vector2f(static_cast<float>(width) / cols, static_cast<float>(height) / rows));
+    background.setPosition(static_cast<float>((index % cols) * (static_cast<double>(width) / cols)),
+                           static_cast<float>((index / cols) * (static_cast<double>(height) / rows)));
+    background.setFillColor(sf::Color::White);
+    texture->draw(background);
+
+    // Define the view for this subplot
+    sf::View view(sf::FloatRect(0, 0, w, h));
+    view.setViewport(sf::FloatRect(left / width, top / height, w / width, h / height));
+    set_view(view);
+
+    // Draw the subplot frame
+    sf::RectangleShape frame(sf::Vector2f(w, h));
+    frame.setFillColor(sf::Color::Transparent);
+    frame.setOutlineColor(sf::Color::Black);
+    frame.setOutlineThickness(1.0f);
+    texture->draw(frame);
+
+    // Draw axes
+    draw_axes(fig, w, h);
+
+    // Draw curves
+    for (size_t i = 0; i < fig.curves.size(); ++i)
+    {
+        if (i < fig.curve_types.size())
+        {
+            const sf::VertexArray *vertices = geometry && i < geometry->size() ? &(*geometry)[i] : nullptr;
+            if (fig.curve_types[i] == "2D" || fig.curve_types[i] == "STREAM" || fig.curve_types[i] == "MAPPED")
+                draw_curve(fig, fig.curves[i], w, h, vertices);
+            else if (fig.curve_types[i] == "HIST")
+                draw_histogram(fig, fig.curves[i], w, h);
+            else if (fig.curve_types[i] == "POLAR")
+                draw_curve(fig, fig.curves[i], w, h, vertices);
+            else if (fig.curve_types[i] == "TEXT")
+                draw_text(fig, fig.curves[i], w, h);
+            else if (fig.curve_types[i] == "ARROW_HEAD")
+                draw_arrow_head(fig, fig.curves[i], w, h);
+            else if (fig.curve_types[i] == "SCATTER")
+                draw_scatter(fig, fig.curves[i], w, h);
+            else if (fig.curve_types[i] == "DENSITY")
+                draw_density(fig, fig.curves[i], w, h);
+        }
+    }
+
+    // Draw the colorbar
+    draw_colorbar(fig, w, h);
+
+    // Draw text (title, axes, legend)
+    draw_text(fig, w, h);
+    flush_text();
+
+    set_view(image_view());
+}
+
+void PlotGen::draw_axes(const Figure &fig, double w, double h)
+{
+    // double margin = 50.0f;
+
+    // Draw grids first (to be in the background)
+    if (fig.show_major_grid || fig.show_minor_grid)
+    {
+        draw_grid(fig, w, h);
+    }
+
+    // X axis
+    sf::VertexArray xAxis(sf::Lines, 2);
+    xAxis[0].position = to_screen(fig, fig.xmin, 0, w, h);
+    xAxis[1].position = to_screen(fig, fig.xmax, 0, w, h);
+    xAxis[0].color = sf::Color::Black;
+    xAxis[1].color = sf::Color::Black;
+
+    // Y axis
+    sf::VertexArray yAxis(sf::Lines, 2);
+    yAxis[0].position = to_screen(fig, 0, fig.ymin, w, h);
+    yAxis[1].position = to_screen(fig, 0, fig.ymax, w, h);
+    yAxis[0].color = sf::Color::Black;
+    yAxis[1].color = sf::Color::Black;
+
+    texture->draw(xAxis);
+    texture->draw(yAxis);
+
+    // Ticks on X axis
+    const int numTicksX = 5;
+    for (int i = 0; i <= numTicksX; ++i)
+    {
+        double x = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
+        sf::VertexArray tick(sf::Lines, 2);
+        tick[0].position = to_screen(fig, x, 0, w, h);
+        tick[1].position = to_screen(fig, x, 0, w, h) + sf::Vector2f(0, 5);
+        tick[0].color = sf::Color::Black;
+        tick[1].color = sf::Color::Black;
+        texture->draw(tick);
+
+        // Tick value
+        // Use appropriate decimal precision
+        std::string tickText;
+        if (std::abs(x) < 0.01)
+        {
+            tickText = "0";
+        }
+        else if (std::abs(x) < 10)
+        {
+            char buffer[10];
+            std::snprintf(buffer, sizeof(buffer), "%.1f", x);
+            tickText = buffer;
+        }
+        else
+        {
+            tickText = std::to_string(static_cast<int>(x));
+        }
+
+        queue_text(layout_text(tickText, 14), to_screen(fig, x, 0, w, h) + sf::Vector2f(-10, 8), sf::Color::Black);
+    }
+
+    // Ticks on Y axis
+    const int numTicksY = 5;
+    for (int i = 0; i <= numTicksY; ++i)
+    {
+        double y = y_from_fraction(fig, static_cast<double>(i) / numTicksY);
+        sf::VertexArray tick(sf::Lines, 2);
+        tick[0].position = to_screen(fig, 0, y, w, h);
+        tick[1].position = to_screen(fig, 0, y, w, h) + sf::Vector2f(-5, 0);
+        tick[0].color = sf::Color::Black;
+        tick[1].color = sf::Color::Black;
+        texture->draw(tick);
+
+        // Tick value
+        // Use appropriate decimal precision
+        std::string tickText;
+        if (fig.log_y)
+        {
+            char buffer[16];
+            std::snprintf(buffer, sizeof(buffer), "%.0e", y);
+            tickText = buffer;
+        }
+        else if (std::abs(y) < 0.01)
+        {
+            tickText = "0";
+        }
+        else if (std::abs(y) < 10)
+        {
+            char buffer[10];
+            std::snprintf(buffer, sizeof(buffer), "%.1f", y);
+            tickText = buffer;
+        }
+        else
+        {
+            tickText = std::to_string(static_cast<int>(y));
+        }
+
+        queue_text(layout_text(tickText, 14), to_screen(fig, 0, y, w, h) + sf::Vector2f(-30, -10), sf::Color::Black);
+    }
 }
 
-// Implémentation de la méthode d'export SVG
-void PlotGen::save_svg(const std::string &filename)
+void PlotGen::draw_grid(const Figure &fig, double w, double h)
 {
-    // Créer un fichier SVG
-    std::ofstream svg_file(filename);
-    if (!svg_file.is_open())
+    if (fig.is_polar)
     {
-        throw std::runtime_error("Unable to create SVG file");
+        draw_polar_grid(fig, w, h);
+        return;
     }
 
-    // Écrire l'en-tête SVG
-    svg_file << "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"no\"?>\n";
-    svg_file << "<!DOCTYPE svg PUBLIC \"-//W3C//DTD SVG 1.1//EN\" \"http://www.w3.org/Graphics/SVG/1.1/DTD/svg11.dtd\">\n";
-    svg_file << "<svg width=\"" << width << "\" height=\"" << height << "\" xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n";
-
-    // Fond blanc
-    svg_file << "<rect width=\"100%\" height=\"100%\" fill=\"white\"/>\n";
+    // Number of major divisions
+    const int numTicksX = 5;
+    const int numTicksY = 5;
 
-    // Calculer les dimensions de chaque sous-figure
-    double subplot_width = static_cast<double>(width) / cols;
-    double subplot_height = static_cast<double>(height) / rows;
+    // Number of minor subdivisions (between each major line)
+    const int numMinorSubdivisions = 4;
 
-    // Exporter chaque figure
-    for (size_t fig_idx = 0; fig_idx < figures.size(); ++fig_idx)
+    // Draw major grid
+    if (fig.show_major_grid)
     {
-        const Figure &fig = figures[fig_idx];
+        sf::VertexArray majorGrid(sf::Lines);
 
-        // Calculer la position de la figure
-        unsigned int row = fig_idx / cols;
-        unsigned int col = fig_idx % cols;
-        double x_offset = col * subplot_width;
-        double y_offset = row * subplot_height;
+        // Major vertical lines
+        for (int i = 0; i <= numTicksX; ++i)
+        {
+            double x = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
+            sf::Vector2f top = to_screen(fig, x, fig.ymin, w, h);
+            sf::Vector2f bottom = to_screen(fig, x, fig.ymax, w, h);
 
-        // Définir la taille effective de la figure en tenant compte de equal_axes si nécessaire
-        double effective_width = subplot_width;
-        double effective_height = subplot_height;
-        double margin = 50.0;
+            majorGrid.append(sf::Vertex(top, fig.major_grid_color));
+            majorGrid.append(sf::Vertex(bottom, fig.major_grid_color));
+        }
 
-        if (fig.equal_axes || fig.is_polar)
+        // Major horizontal lines
+        for (int i = 0; i <= numTicksY; ++i)
         {
-            double min_size = std::min(effective_width, effective_height);
-            effective_width = min_size;
-            effective_height = min_size;
-            // Ajuster les offsets pour centrer la figure
-            x_offset += (subplot_width - effective_width) / 2.0;
-            y_offset += (subplot_height - effective_height) / 2.0;
-        }
+            double y = y_from_fraction(fig, static_cast<double>(i) / numTicksY);
+            sf::Vector2f left = to_screen(fig, fig.xmin, y, w, h);
+            sf::Vector2f right = to_screen(fig, fig.xmax, y, w, h);
 
-        // Créer un groupe pour cette figure avec transformation appropriée
-        svg_file << "<g transform=\"translate(" << x_offset << "," << y_offset << ")\">\n";
+            majorGrid.append(sf::Vertex(left, fig.major_grid_color));
+            majorGrid.append(sf::Vertex(right, fig.major_grid_color));
+        }
 
-        // Ajouter une bordure autour de la figure
-        svg_file << "<rect x=\"0\" y=\"0\" width=\"" << effective_width << "\" height=\"" << effective_height
-                 << "\" fill=\"none\" stroke=\"black\" stroke-width=\"1\"/>\n";
+        texture->draw(majorGrid);
+    }
 
-        // Dimensions internes de la figure (zone de tracé)
-        double graph_width = effective_width - 2 * margin;
-        double graph_height = effective_height - 2 * margin;
+    // Draw minor grid
+    if (fig.show_minor_grid)
+    {
+        sf::VertexArray minorGrid(sf::Lines);
 
-        // Dessiner les grilles avant les axes
-        if (fig.show_major_grid || fig.show_minor_grid)
+        // Minor vertical lines
+        for (int i = 0; i < numTicksX; ++i)
         {
-            if (fig.is_polar)
+            double x_start = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
+            double x_step = (fig.xmax - fig.xmin) / (numTicksX * numMinorSubdivisions);
+
+            for (int j = 1; j < numMinorSubdivisions; ++j)
             {
-                export_svg_polar_grid(fig, svg_file, margin, margin, graph_width, graph_height);
+                double x = x_start + j * x_step;
+                sf::Vector2f top = to_screen(fig, x, fig.ymin, w, h);
+                sf::Vector2f bottom = to_screen(fig, x, fig.ymax, w, h);
+
+                minorGrid.append(sf::Vertex(top, fig.minor_grid_color));
+                minorGrid.append(sf::Vertex(bottom, fig.minor_grid_color));
             }
-            else
+        }
+
+        // Minor horizontal lines
+        for (int i = 0; i < numTicksY; ++i)
+        {
+            for (int j = 1; j < numMinorSubdivisions; ++j)
             {
-                export_svg_grid(fig, svg_file, margin, margin, graph_width, graph_height);
+                double y = y_from_fraction(fig, (i + static_cast<double>(j) / numMinorSubdivisions) / numTicksY);
+                sf::Vector2f left = to_screen(fig, fig.xmin, y, w, h);
+                sf::Vector2f right = to_screen(fig, fig.xmax, y, w, h);
+
+                minorGrid.append(sf::Vertex(left, fig.minor_grid_color));
+                minorGrid.append(sf::Vertex(right, fig.minor_grid_color));
             }
         }
 
-        // Dessiner les axes X et Y seulement pour les graphes non-polaires
-        if (!fig.is_polar)
+        texture->draw(minorGrid);
+    }
+}
+
+void PlotGen::draw_polar_grid(const Figure &fig, double w, double h)
+{
+    // Center of the polar grid
+    sf::Vector2f center = to_screen(fig, 0, 0, w, h);
+
+    // Maximum radius for circles (in pixels)
+    double max_radius = std::min(w, h) / 2 - 50;
+
+    // Maximum radius of data (in units)
+    double max_r = std::max(std::abs(fig.xmax), std::abs(fig.ymax));
+
+    // Number of concentric circles for major grid
+    const int numCircles = 5;
+
+    // Number of rays for major grid (one ray every 30 degrees)
+    const int numRays = 12;
+
+    // Draw concentric circles (major grid)
+    if (fig.show_major_grid)
+    {
+        // Concentric circles
+        for (int i = 1; i <= numCircles; ++i)
         {
-            // Axe X
-            double x_axis_y = margin + graph_height - (0 - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
-            x_axis_y = std::min(x_axis_y, margin + graph_height);
-            x_axis_y = std::max(x_axis_y, margin);
+            double radius = max_radius * i / numCircles;
+            double r_value = max_r * i / numCircles;
 
-            svg_file << "<line x1=\"" << margin << "\" y1=\"" << x_axis_y
-                     << "\" x2=\"" << (margin + graph_width) << "\" y2=\"" << x_axis_y
-                     << "\" stroke=\"black\" stroke-width=\"1.5\"/>\n";
+            sf::CircleShape circle(radius);
+            circle.setOrigin(radius, radius);
+            circle.setPosition(center);
+            circle.setFillColor(sf::Color::Transparent);
+            circle.setOutlineColor(fig.major_grid_color);
+            circle.setOutlineThickness(1.0f);
+            texture->draw(circle);
 
-            // Axe Y
-            double y_axis_x = margin + (0 - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
-            y_axis_x = std::min(y_axis_x, margin + graph_width);
-            y_axis_x = std::max(y_axis_x, margin);
+            // Add radius labels with one decimal place
+            char r_buffer[10];
+            std::snprintf(r_buffer, sizeof(r_buffer), "%.1f", r_value);
+            const TextLayout &rLabel = layout_text(r_buffer, 10);
 
-            svg_file << "<line x1=\"" << y_axis_x << "\" y1=\"" << margin
-                     << "\" x2=\"" << y_axis_x << "\" y2=\"" << (margin + graph_height)
-                     << "\" stroke=\"black\" stroke-width=\"1.5\"/>\n";
+            sf::FloatRect textRect = rLabel.bounds;
+            queue_text(rLabel, sf::Vector2f(center.x + radius * std::cos(3.14f / 4) - textRect.width / 2,
+                                            center.y - radius * std::sin(3.14f / 4) - textRect.height / 2),
+                       sf::Color::Black);
+        }
 
-            // Dessiner les graduations sur l'axe X
-            const int numTicksX = 5;
-            for (int i = 0; i <= numTicksX; ++i)
+        // Rays from center
+        sf::VertexArray rays(sf::Lines);
+        for (int i = 0; i < numRays; ++i)
+        {
+            double angle = 2 * M_PI * i / numRays;
+            sf::Vector2f end(center.x + max_radius * std::cos(angle),
+                             center.y - max_radius * std::sin(angle));
+
+            rays.append(sf::Vertex(center, fig.major_grid_color));
+            rays.append(sf::Vertex(end, fig.major_grid_color));
+
+            // Add angle labels (in degrees) with one decimal place
+            // Calculate degrees and format with one decimal place
+            double degrees = angle * 180 / M_PI;
+            if (degrees >= 360)
+                degrees -= 360;
+
+            char angle_buffer[15];
+            std::snprintf(angle_buffer, sizeof(angle_buffer), "%.1f°", degrees);
+            const TextLayout &angleLabel = layout_text(angle_buffer, 12);
+
+            sf::FloatRect textRect = angleLabel.bounds;
+
+            // Position the label slightly beyond the end of the ray
+            sf::Vector2f labelPos(center.x + (max_radius + 10) * std::cos(angle) - textRect.width / 2,
+                                  center.y - (max_radius + 10) * std::sin(angle) - textRect.height / 2);
+            queue_text(angleLabel, labelPos, sf::Color::Black);
+        }
+        texture->draw(rays);
+    }
+
+    // Draw minor grid
+    if (fig.show_minor_grid)
+    {
+        // Minor concentric circles between major ones
+        const int numMinorCircles = 4;
+        for (int i = 0; i < numCircles; ++i)
+        {
+            double radiusStart = max_radius * i / numCircles;
+            double radiusStep = max_radius / numCircles / numMinorCircles;
+
+            for (int j = 1; j < numMinorCircles; ++j)
             {
-                double x = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
-                double sx = margin + (x - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
+                double radius = radiusStart + j * radiusStep;
 
-                // Trait de graduation
-                svg_file << "<line x1=\"" << sx << "\" y1=\"" << x_axis_y
-                         << "\" x2=\"" << sx << "\" y2=\"" << (x_axis_y + 5)
-                         << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
+                sf::CircleShape circle(radius);
+                circle.setOrigin(radius, radius);
+                circle.setPosition(center);
+                circle.setFillColor(sf::Color::Transparent);
+                circle.setOutlineColor(fig.minor_grid_color);
+                circle.setOutlineThickness(1.0f);
+                texture->draw(circle);
+            }
+        }
 
-                // Texte de la graduation
-                std::string tickText;
-                if (std::abs(x) < 0.01)
-                {
-                    tickText = "0";
-                }
-                else if (std::abs(x) < 10)
-                {
-                    char buffer[10];
-                    std::snprintf(buffer, sizeof(buffer), "%.1f", x);
-                    tickText = buffer;
-                }
-                else
-                {
-                    tickText = std::to_string(static_cast<int>(x));
-                }
+        // Minor rays between major ones
+        sf::VertexArray minorRays(sf::Lines);
+        const int numMinorRays = numRays * 2; // One ray every 15 degrees
+
+        for (int i = 0; i < numMinorRays; ++i)
+        {
+            // Skip rays that are already in the major grid
+            if (i % 2 == 0)
+                continue;
+
+            double angle = 2 * M_PI * i / numMinorRays;
+            sf::Vector2f end(center.x + max_radius * std::cos(angle),
+                             center.y - max_radius * std::sin(angle));
+
+            minorRays.append(sf::Vertex(center, fig.minor_grid_color));
+            minorRays.append(sf::Vertex(end, fig.minor_grid_color));
+        }
+        texture->draw(minorRays);
+    }
+}
+
+// Build the vertices of the lines of a curve for the limits of fig (symbols are not included).
+// Only reads the curve and the limits, so it can run on a worker thread.
+void PlotGen::tessellate_curve(const Figure &fig, const Figure::Curve &curve, double w, double h, sf::VertexArray &vertices) const
+{
+    vertices.clear();
 
-                svg_file << "<text x=\"" << sx << "\" y=\"" << (x_axis_y + 20)
-                         << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"12\">"
-                         << tickText << "</text>\n";
-            }
+    // Curves with a LOD pyramid and streams only draw a few samples per pixel column
+    std::vector<double> sampled_x, sampled_y;
+    bool sampled = visible_samples(fig, curve, static_cast<unsigned int>(std::max(1.0, w - 100.0)), sampled_x, sampled_y);
+    const std::vector<double> &xs = sampled ? sampled_x : curve.x;
+    const std::vector<double> &ys = sampled ? sampled_y : curve.y;
 
-            // Dessiner les graduations sur l'axe Y
-            const int numTicksY = 5;
-            for (int i = 0; i <= numTicksY; ++i)
-            {
-                double y = fig.ymin + (fig.ymax - fig.ymin) * i / numTicksY;
-                double sy = margin + graph_height - (y - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
+    if (xs.empty() || ys.empty())
+        return;
 
-                // Trait de graduation
-                svg_file << "<line x1=\"" << y_axis_x << "\" y1=\"" << sy
-                         << "\" x2=\"" << (y_axis_x - 5) << "\" y2=\"" << sy
-                         << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
+    // Appliquer l'épaisseur des lignes en utilisant les vertex arrays avec triangles
+    // pour les lignes de plus d'un pixel d'épaisseur
+    float thickness = static_cast<float>(curve.style.thickness);
 
-                // Texte de la graduation
-                std::string tickText;
-                if (std::abs(y) < 0.01)
-                {
-                    tickText = "0";
-                }
-                else if (std::abs(y) < 10)
-                {
-                    char buffer[10];
-                    std::snprintf(buffer, sizeof(buffer), "%.1f", y);
-                    tickText = buffer;
-                }
-                else
-                {
-                    tickText = std::to_string(static_cast<int>(y));
-                }
+    // Convertir tous les points de la courbe en coordonnées d'écran
+    std::vector<sf::Vector2f> screenPoints;
+    screenPoints.reserve(xs.size());
+    for (size_t i = 0; i < xs.size(); ++i)
+    {
+        screenPoints.push_back(to_screen(fig, xs[i], ys[i], w, h));
+    }
 
-                svg_file << "<text x=\"" << (y_axis_x - 15) << "\" y=\"" << (sy + 5)
-                         << "\" text-anchor=\"end\" font-family=\"Arial\" font-size=\"12\">"
-                         << tickText << "</text>\n";
+    if (curve.style.line_style == "solid")
+    {
+        if (thickness <= 1.0f)
+        {
+            // Pour les lignes fines, utiliser LineStrip (plus efficace)
+            vertices.setPrimitiveType(sf::LineStrip);
+            vertices.resize(xs.size());
+            for (size_t i = 0; i < xs.size(); ++i)
+            {
+                vertices[i] = sf::Vertex(screenPoints[i], curve.style.color);
             }
         }
-
-        // Dessiner les courbes
-        for (size_t i = 0; i < fig.curves.size(); ++i)
+        else
         {
-            if (i < fig.curve_types.size())
+            // Pour les lignes épaisses, utiliser des triangles
+            if (xs.size() > 1)
             {
-                const auto &curve = fig.curves[i];
-                const auto &curve_type = fig.curve_types[i];
+                sf::VertexArray &thickLine = vertices;
+                thickLine.setPrimitiveType(sf::Triangles);
 
-                if (curve_type == "2D" || curve_type == "POLAR")
-                {
-                    export_svg_curve(fig, curve, svg_file, margin, margin, graph_width, graph_height);
-                }
-                else if (curve_type == "HIST")
+                for (size_t i = 0; i < xs.size() - 1; ++i)
                 {
-                    export_svg_histogram(fig, curve, svg_file, margin, margin, graph_width, graph_height);
-                }
-                else if (curve_type == "TEXT")
-                {
-                    // Gérer le texte dans les figures
-                    if (!curve.text_content.empty() && !curve.x.empty() && !curve.y.empty())
-                    {
-                        double sx = margin + (curve.x[0] - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
-                        double sy = margin + graph_height - (curve.y[0] - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
+                    sf::Vector2f p1 = screenPoints[i];
+                    sf::Vector2f p2 = screenPoints[i + 1];
 
-                        svg_file << "<text x=\"" << sx << "\" y=\"" << sy
-                                 << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\""
-                                 << (curve.style.thickness > 0 ? curve.style.thickness * 6 : 12)
-                                 << "\" fill=\"" << color_to_svg(curve.style.color) << "\">"
-                                 << curve.text_content << "</text>\n";
-                    }
-                }
-                else if (curve_type == "ARROW_HEAD")
-                {
-                    // Gérer les flèches
-                    if (curve.x.size() >= 2 && curve.y.size() >= 2)
+                    // Calculer le vecteur normalisé perpendiculaire à la ligne
+                    sf::Vector2f direction = p2 - p1;
+                    sf::Vector2f unitDirection;
+                    float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+
+                    if (length > 0)
                     {
-                        double x1 = margin + (curve.x[0] - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
-                        double y1 = margin + graph_height - (curve.y[0] - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
-                        double x2 = margin + (curve.x[1] - fig.xmin) / (fig.xmax - fig.xmin) * graph_width;
-                        double y2 = margin + graph_height - (curve.y[1] - fig.ymin) / (fig.ymax - fig.ymin) * graph_height;
+                        unitDirection = direction / length;
+                        sf::Vector2f unitPerpendicular(-unitDirection.y, unitDirection.x);
 
-                        // Dessiner la ligne de la flèche
-                        svg_file << "<line x1=\"" << x1 << "\" y1=\"" << y1
-                                 << "\" x2=\"" << x2 << "\" y2=\"" << y2
-                                 << "\" stroke=\"" << color_to_svg(curve.style.color)
-                                 << "\" stroke-width=\"" << curve.style.thickness << "\"/>\n";
+                        // Calculer les points pour former un rectangle (deux triangles)
+                        sf::Vector2f offset = unitPerpendicular * (thickness / 2.0f);
 
-                        // Dessiner la tête de flèche
-                        double angle = std::atan2(y2 - y1, x2 - x1);
-                        double headSize = curve.head_size * 0.5;
-                        double headAngle = 30.0 * M_PI / 180.0; // 30 degrés en radians
+                        sf::Vertex v1(p1 + offset, curve.style.color);
+                        sf::Vertex v2(p2 + offset, curve.style.color);
+                        sf::Vertex v3(p2 - offset, curve.style.color);
+                        sf::Vertex v4(p1 - offset, curve.style.color);
 
-                        double x3 = x2 - headSize * std::cos(angle - headAngle);
-                        double y3 = y2 - headSize * std::sin(angle - headAngle);
-                        double x4 = x2 - headSize * std::cos(angle + headAngle);
-                        double y4 = y2 - headSize * std::sin(angle + headAngle);
+                        // Premier triangle
+                        thickLine.append(v1);
+                        thickLine.append(v2);
+                        thickLine.append(v3);
 
-                        svg_file << "<polygon points=\""
-                                 << x2 << "," << y2 << " "
-                                 << x3 << "," << y3 << " "
-                                 << x4 << "," << y4
-                                 << "\" fill=\"" << color_to_svg(curve.style.color) << "\"/>\n";
+                        // Second triangle
+                        thickLine.append(v1);
+                        thickLine.append(v3);
+                        thickLine.append(v4);
                     }
                 }
             }
         }
-
-        // Ajouter le titre et les étiquettes des axes
-        if (!fig.title.empty())
-        {
-            svg_file << "<text x=\"" << (effective_width / 2) << "\" y=\"" << (margin / 2)
-                     << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"18\" font-weight=\"bold\">"
-                     << fig.title << "</text>\n";
-        }
-
-        if (!fig.xlabel.empty())
-        {
-            svg_file << "<text x=\"" << (effective_width / 2) << "\" y=\"" << (effective_height - 10)
-                     << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"14\">"
-                     << fig.xlabel << "</text>\n";
-        }
-
-        if (!fig.ylabel.empty())
-        {
-            svg_file << "<text x=\"" << (margin / 3) << "\" y=\"" << (effective_height / 2)
-                     << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"14\" "
-                     << "transform=\"rotate(-90 " << (margin / 3) << "," << (effective_height / 2) << ")\">"
-                     << fig.ylabel << "</text>\n";
-        }
-
-        // Ajouter la légende si nécessaire
-        if (fig.show_leg)
+    }
+    else if (curve.style.line_style == "dashed")
+    {
+        // Pour les lignes pointillées
+        if (thickness <= 1.0f)
         {
-            // Compter combien d'entrées de légende nous avons
-            int legend_entries = 0;
-            for (const auto &curve : fig.curves)
+            // Lignes fines
+            sf::VertexArray &line = vertices;
+            line.setPrimitiveType(sf::Lines);
+            for (size_t i = 0; i < xs.size() - 1; i += 2)
             {
-                if (!curve.style.legend.empty())
+                if (i + 1 < screenPoints.size())
                 {
-                    legend_entries++;
+                    sf::Vector2f p1 = screenPoints[i];
+                    sf::Vector2f p2 = screenPoints[i + 1];
+
+                    line.append(sf::Vertex(p1, curve.style.color));
+                    line.append(sf::Vertex(p2, curve.style.color));
                 }
             }
-
-            if (legend_entries > 0)
+        }
+        else
+        {
+            // Lignes épaisses pointillées
+            if (xs.size() > 1)
             {
-                double legendWidth = 150;
-                double legendHeight = legend_entries * 20 + 10;
-                double legendX, legendY;
+                sf::VertexArray &thickLine = vertices;
+                thickLine.setPrimitiveType(sf::Triangles);
 
-                // Positionner la légende selon la configuration
-                if (fig.legend_position == "top-right")
-                {
-                    legendX = effective_width - legendWidth - 10;
-                    legendY = margin + 10;
-                }
-                else if (fig.legend_position == "top-left")
+                for (size_t i = 0; i < xs.size() - 1; i += 2)
                 {
-                    legendX = margin + 10;
-                    legendY = margin + 10;
-                }
-                else if (fig.legend_position == "bottom-right")
-                {
-                    legendX = effective_width - legendWidth - 10;
-                    legendY = effective_height - legendHeight - margin;
-                }
-                else if (fig.legend_position == "bottom-left")
-                {
-                    legendX = margin + 10;
-                    legendY = effective_height - legendHeight - margin;
-                }
-                else
-                {
-                    // Position par défaut: top-right
-                    legendX = effective_width - legendWidth - 10;
-                    legendY = margin + 10;
-                }
+                    if (i + 1 >= screenPoints.size())
+                        continue;
 
-                // Dessiner le fond de la légende
-                svg_file << "<rect x=\"" << legendX << "\" y=\"" << legendY
-                         << "\" width=\"" << legendWidth << "\" height=\"" << legendHeight
-                         << "\" fill=\"white\" fill-opacity=\"0.8\" stroke=\"black\" stroke-width=\"1\"/>\n";
+                    sf::Vector2f p1 = screenPoints[i];
+                    sf::Vector2f p2 = screenPoints[i + 1];
 
-                // Ajouter chaque entrée de légende
-                double currentY = legendY + 15;
-                for (const auto &curve : fig.curves)
-                {
-                    if (!curve.style.legend.empty())
-                    {
-                        // Dessiner l'exemple de style (ligne et symbole)
-                        if (curve.style.line_style == "solid")
-                        {
-                            svg_file << "<line x1=\"" << (legendX + 10) << "\" y1=\"" << currentY
-                                     << "\" x2=\"" << (legendX + 40) << "\" y2=\"" << currentY
-                                     << "\" stroke=\"" << color_to_svg(curve.style.color)
-                                     << "\" stroke-width=\"" << curve.style.thickness;
+                    // Même logique que pour les lignes pleines
+                    sf::Vector2f direction = p2 - p1;
+                    sf::Vector2f unitDirection;
+                    float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
 
-                            // Pas de dashed/dotted pour les lignes solides
-                            svg_file << "\"/>\n";
-                        }
-                        else if (curve.style.line_style == "dashed")
-                        {
-                            svg_file << "<line x1=\"" << (legendX + 10) << "\" y1=\"" << currentY
-                                     << "\" x2=\"" << (legendX + 40) << "\" y2=\"" << currentY
-                                     << "\" stroke=\"" << color_to_svg(curve.style.color)
-                                     << "\" stroke-width=\"" << curve.style.thickness
-                                     << "\" stroke-dasharray=\"" << (5 * curve.style.thickness) << ","
-                                     << (3 * curve.style.thickness) << "\"/>\n";
-                        }
+                    if (length > 0)
+                    {
+                        unitDirection = direction / length;
+                        sf::Vector2f unitPerpendicular(-unitDirection.y, unitDirection.x);
 
-                        // Ajouter le symbole si nécessaire
-                        if (curve.style.symbol_type == "circle")
-                        {
-                            svg_file << "<circle cx=\"" << (legendX + 25) << "\" cy=\"" << currentY
-                                     << "\" r=\"" << (curve.style.symbol_size / 2)
-                                     << "\" fill=\"" << color_to_svg(curve.style.color)
-                                     << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
-                        }
-                        else if (curve.style.symbol_type == "square")
-                        {
-                            double halfSize = curve.style.symbol_size / 2;
-                            svg_file << "<rect x=\"" << (legendX + 25 - halfSize) << "\" y=\"" << (currentY - halfSize)
-                                     << "\" width=\"" << curve.style.symbol_size << "\" height=\"" << curve.style.symbol_size
-                                     << "\" fill=\"" << color_to_svg(curve.style.color)
-                                     << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
-                        }
+                        sf::Vector2f offset = unitPerpendicular * (thickness / 2.0f);
 
-                        // Ajouter le texte de la légende
-                        svg_file << "<text x=\"" << (legendX + 45) << "\" y=\"" << (currentY + 5)
-                                 << "\" font-family=\"Arial\" font-size=\"12\">"
-                                 << curve.style.legend << "</text>\n";
+                        sf::Vertex v1(p1 + offset, curve.style.color);
+                        sf::Vertex v2(p2 + offset, curve.style.color);
+                        sf::Vertex v3(p2 - offset, curve.style.color);
+                        sf::Vertex v4(p1 - offset, curve.style.color);
 
-                        currentY += 20;
+                        thickLine.append(v1);
+                        thickLine.append(v2);
+                        thickLine.append(v3);
+
+                        thickLine.append(v1);
+                        thickLine.append(v3);
+                        thickLine.append(v4);
                     }
                 }
             }
         }
-
-        // Fermer le groupe
-        svg_file << "</g>\n";
     }
-
-    // Fermeture de la balise SVG
-    svg_file << "</svg>\n";
-    svg_file.close();
-
-    std::cout << "SVG vectoriel exporté vers: " << filename << " (Dimensions: " << width << "x" << height << ")" << std::endl;
+    else if (curve.style.line_style == "points")
+    { // points
+        vertices.setPrimitiveType(sf::Points);
+        for (const auto &position : screenPoints)
+        {
+            vertices.append(sf::Vertex(position, curve.style.color));
+        }
+    }
 }
 
-void PlotGen::render()
+void PlotGen::draw_curve(const Figure &fig, const Figure::Curve &curve, double w, double h, const sf::VertexArray *geometry)
 {
-    texture.clear(sf::Color::White);
+    if (geometry)
+    {
+        texture->draw(*geometry);
+    }
+    else
+    {
+        sf::VertexArray vertices;
+        tessellate_curve(fig, curve, w, h, vertices);
+        texture->draw(vertices);
+    }
 
-    // Go through all subplots
-    for (unsigned int row = 0; row < rows; ++row)
+    // Dessiner les symboles après avoir dessiné toutes les lignes
+    // pour s'assurer qu'ils sont visibles par-dessus les lignes
+    if (curve.style.symbol_type != "none")
     {
-        for (unsigned int col = 0; col < cols; ++col)
+        for (size_t i = 0; i < curve.x.size() && i < curve.y.size(); ++i)
         {
-            Figure &fig = figures[row * cols + col];
-
-            // Define the view for this subplot
-            double subplot_width = static_cast<double>(width) / cols;
-            double subplot_height = static_cast<double>(height) / rows;
-
-            // For polar graphs, ensure dimensions are square
-            if (fig.is_polar)
-            {
-                double min_size = std::min(subplot_width, subplot_height);
-                double x_offset = (subplot_width - min_size) / 2.0f;
-                double y_offset = (subplot_height - min_size) / 2.0f;
-
-                sf::View view(sf::FloatRect(0, 0, min_size, min_size));
-                view.setViewport(sf::FloatRect(
-                    static_cast<double>(col) / cols + x_offset / width,
-                    static_cast<double>(row) / rows + y_offset / height,
-                    min_size / width,
-                    min_size / height));
-                texture.setView(view);
-            }
-            else if (fig.equal_axes)
-            {
-                double min_size = std::min(subplot_width, subplot_height);
-                double x_offset = (subplot_width - min_size) / 2.0f;
-                double y_offset = (subplot_height - min_size) / 2.0f;
-
-                sf::View view(sf::FloatRect(0, 0, min_size, min_size));
-                view.setViewport(sf::FloatRect(
-                    static_cast<double>(col) / cols + x_offset / width,
-                    static_cast<double>(row) / rows + y_offset / height,
-                    min_size / width,
-                    min_size / height));
-                texture.setView(view);
-            }
-            else
-            {
-                sf::View view(sf::FloatRect(0, 0, subplot_width, subplot_height));
-                view.setViewport(sf::FloatRect(
-                    static_cast<double>(col) / cols,
-                    static_cast<double>(row) / rows,
-                    1.0f / cols,
-                    1.0f / rows));
-                texture.setView(view);
-            }
-
-            // Draw the subplot frame
-            sf::RectangleShape frame;
-            if (fig.is_polar || fig.equal_axes)
-            {
-                double min_size = std::min(subplot_width, subplot_height);
-                frame.setSize(sf::Vector2f(min_size, min_size));
-            }
-            else
-            {
-                frame.setSize(sf::Vector2f(subplot_width, subplot_height));
-            }
-            frame.setFillColor(sf::Color::Transparent);
-            frame.setOutlineColor(sf::Color::Black);
-            frame.setOutlineThickness(1.0f);
-            texture.draw(frame);
-
-            // Draw axes
-            draw_axes(fig, fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_width,
-                      fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_height);
-
-            // Draw curves
-            for (size_t i = 0; i < fig.curves.size(); ++i)
-            {
-                if (i < fig.curve_types.size())
-                {
-                    if (fig.curve_types[i] == "2D")
-                        draw_curve(fig, fig.curves[i], fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_width,
-                                   fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_height);
-                    else if (fig.curve_types[i] == "HIST")
-                        draw_histogram(fig, fig.curves[i], fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_width,
-                                       fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_height);
-                    else if (fig.curve_types[i] == "POLAR")
-                        draw_curve(fig, fig.curves[i], fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_width,
-                                   fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_height);
-                    else if (fig.curve_types[i] == "TEXT")
-                        draw_text(fig, fig.curves[i], fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_width,
-                                  fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_height);
-                    else if (fig.curve_types[i] == "ARROW_HEAD")
-                        draw_arrow_head(fig, fig.curves[i], fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_width,
-                                        fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_height);
-                }
-            }
-
-            // Draw text (title, axes, legend)
-            draw_text(fig, fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_width,
-                      fig.is_polar || fig.equal_axes ? std::min(subplot_width, subplot_height) : subplot_height);
+            draw_symbol(to_screen(fig, curve.x[i], curve.y[i], w, h), curve.style.symbol_type, curve.style.symbol_size, curve.style.color);
         }
     }
-
-    // Restore default view
-    texture.setView(texture.getDefaultView());
-    texture.display();
 }
 
-void PlotGen::draw_axes(const Figure &fig, double w, double h)
+void PlotGen::draw_histogram(const Figure &fig, const Figure::Curve &curve, double w, double h)
 {
-    // double margin = 50.0f;
+    if (curve.x.empty() || curve.y.empty())
+        return;
 
-    // Draw grids first (to be in the background)
-    if (fig.show_major_grid || fig.show_minor_grid)
+    double maxY = *std::max_element(curve.y.begin(), curve.y.end());
+    if (maxY <= 0)
+        maxY = 1.0f; // Avoid division by zero
+
+    // Calculate bin width based on data
+    double bin_width = 0;
+    if (curve.x.size() > 1)
     {
-        draw_grid(fig, w, h);
+        bin_width = curve.x[1] - curve.x[0];
+    }
+    else
+    {
+        bin_width = (fig.xmax - fig.xmin) / 20.0f;
     }
 
-    // X axis
-    sf::VertexArray xAxis(sf::Lines, 2);
-    xAxis[0].position = to_screen(fig, fig.xmin, 0, w, h);
-    xAxis[1].position = to_screen(fig, fig.xmax, 0, w, h);
-    xAxis[0].color = sf::Color::Black;
-    xAxis[1].color = sf::Color::Black;
-
-    // Y axis
-    sf::VertexArray yAxis(sf::Lines, 2);
-    yAxis[0].position = to_screen(fig, 0, fig.ymin, w, h);
-    yAxis[1].position = to_screen(fig, 0, fig.ymax, w, h);
-    yAxis[0].color = sf::Color::Black;
-    yAxis[1].color = sf::Color::Black;
+    // Calculate bar width to properly fill the space
+    double bar_width = bin_width * w / (fig.xmax - fig.xmin);
 
-    texture.draw(xAxis);
-    texture.draw(yAxis);
+    // Ensure bars aren't too wide
+    bar_width *= curve.bar_width_ratio; // Use custom width ratio
 
-    // Ticks on X axis
-    const int numTicksX = 5;
-    for (int i = 0; i <= numTicksX; ++i)
+    for (size_t i = 0; i < curve.x.size(); ++i)
     {
-        double x = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
-        sf::VertexArray tick(sf::Lines, 2);
-        tick[0].position = to_screen(fig, x, 0, w, h);
-        tick[1].position = to_screen(fig, x, 0, w, h) + sf::Vector2f(0, 5);
-        tick[0].color = sf::Color::Black;
-        tick[1].color = sf::Color::Black;
-        texture.draw(tick);
+        sf::RectangleShape bar;
+        double bar_height = curve.y[i] * (h - 100) / (fig.ymax - fig.ymin); // Adjust for margins
 
-        // Tick value
-        sf::Text tickLabel;
-        tickLabel.setFont(font);
-        tickLabel.setCharacterSize(14);
-        tickLabel.setFillColor(sf::Color::Black);
+        // Correct bar position, centered on x value
+        sf::Vector2f position = to_screen(fig, curve.x[i], 0, w, h);
+        position.x -= bar_width / 2; // Center bar on x value
 
-        // Use appropriate decimal precision
-        std::string tickText;
-        if (std::abs(x) < 0.01)
-        {
-            tickText = "0";
-        }
-        else if (std::abs(x) < 10)
-        {
-            char buffer[10];
-            std::snprintf(buffer, sizeof(buffer), "%.1f", x);
-            tickText = buffer;
-        }
-        else
-        {
-            tickText = std::to_string(static_cast<int>(x));
-        }
+        bar.setSize(sf::Vector2f(bar_width, -bar_height)); // negative to draw upward
+        bar.setPosition(position);
+        bar.setFillColor(curve.style.color);
+        bar.setOutlineColor(sf::Color::Black);
+        bar.setOutlineThickness(1.0f);
 
-        tickLabel.setString(sf::String::fromUtf8(tickText.begin(), tickText.end()));
-        tickLabel.setPosition(to_screen(fig, x, 0, w, h) + sf::Vector2f(-10, 8));
-        texture.draw(tickLabel);
+        texture->draw(bar);
     }
+}
 
-    // Ticks on Y axis
-    const int numTicksY = 5;
-    for (int i = 0; i <= numTicksY; ++i)
+// Colors of the markers of a scatter curve, mapped in one pass through the colormap
+void PlotGen::scatter_colors(const Figure::Curve &curve, std::vector<sf::Uint8> &rgba)
+{
+    rgba.resize(curve.x.size() * 4);
+    if (curve.color_values.empty())
     {
-        double y = fig.ymin + (fig.ymax - fig.ymin) * i / numTicksY;
-        sf::VertexArray tick(sf::Lines, 2);
-        tick[0].position = to_screen(fig, 0, y, w, h);
-        tick[1].position = to_screen(fig, 0, y, w, h) + sf::Vector2f(-5, 0);
-        tick[0].color = sf::Color::Black;
-        tick[1].color = sf::Color::Black;
-        texture.draw(tick);
-
-        // Tick value
-        sf::Text tickLabel;
-        tickLabel.setFont(font);
-        tickLabel.setCharacterSize(14);
-        tickLabel.setFillColor(sf::Color::Black);
-
-        // Use appropriate decimal precision
-        std::string tickText;
-        if (std::abs(y) < 0.01)
-        {
-            tickText = "0";
-        }
-        else if (std::abs(y) < 10)
+        for (size_t i = 0; i < curve.x.size(); ++i)
         {
-            char buffer[10];
-            std::snprintf(buffer, sizeof(buffer), "%.1f", y);
-            tickText = buffer;
+            rgba[i * 4] = curve.style.color.r;
+            rgba[i * 4 + 1] = curve.style.color.g;
+            rgba[i * 4 + 2] = curve.style.color.b;
+            rgba[i * 4 + 3] = curve.style.color.a;
         }
-        else
+        return;
+    }
+    map_to_rgba(curve.style.colormap, curve.color_values.data(), curve.color_values.size(),
+                curve.color_min, curve.color_max, rgba.data());
+}
+
+// Append the triangles of a marker (black outline first, then the fill) to a vertex array
+void PlotGen::append_marker(sf::VertexArray &vertices, const sf::Vector2f &position, const std::string &symbol_type, double size, const sf::Color &color)
+{
+    // Polygon as a triangle fan around the center; star shapes alternate outer and inner radii
+    auto append_polygon = [&](double outer, double inner, int corners, double start_angle, const sf::Color &fill)
+    {
+        int count = inner > 0 ? corners * 2 : corners;
+        sf::Vector2f previous;
+        for (int i = 0; i <= count; ++i)
         {
-            tickText = std::to_string(static_cast<int>(y));
+            double radius = (inner > 0 && i % 2 == 1) ? inner : outer;
+            double angle = start_angle + 2 * M_PI * i / count;
+            sf::Vector2f point(position.x + static_cast<float>(radius * std::cos(angle)),
+                               position.y + static_cast<float>(radius * std::sin(angle)));
+            if (i > 0)
+            {
+                vertices.append(sf::Vertex(position, fill));
+                vertices.append(sf::Vertex(previous, fill));
+                vertices.append(sf::Vertex(point, fill));
+            }
+            previous = point;
         }
+    };
 
-        tickLabel.setString(sf::String::fromUtf8(tickText.begin(), tickText.end()));
-        tickLabel.setPosition(to_screen(fig, 0, y, w, h) + sf::Vector2f(-30, -10));
-        texture.draw(tickLabel);
+    double half = size / 2;
+    for (int pass = 0; pass < 2; ++pass)
+    {
+        // The outline is the same shape, one pixel larger, drawn below the fill
+        double grow = pass == 0 ? 1.0 : 0.0;
+        const sf::Color &fill = pass == 0 ? sf::Color::Black : color;
+
+        if (symbol_type == "square")
+            append_polygon((half + grow) * std::sqrt(2.0), 0, 4, M_PI / 4, fill);
+        else if (symbol_type == "triangle")
+            append_polygon(half + grow, 0, 3, -M_PI / 2, fill);
+        else if (symbol_type == "diamond")
+            append_polygon(half + grow, 0, 4, -M_PI / 2, fill);
+        else if (symbol_type == "star")
+            append_polygon(half + grow, half / 2 + grow, 5, -M_PI / 2, fill);
+        else
+            append_polygon(half + grow, 0, size > 8 ? 16 : 8, 0, fill);
     }
 }
 
-void PlotGen::draw_grid(const Figure &fig, double w, double h)
+// Scatter curve: every marker goes into one vertex array, drawn with a single call
+void PlotGen::draw_scatter(const Figure &fig, const Figure::Curve &curve, double w, double h)
 {
-    if (fig.is_polar)
-    {
-        draw_polar_grid(fig, w, h);
+    if (curve.x.empty() || curve.y.empty())
         return;
+
+    std::vector<sf::Uint8> rgba;
+    scatter_colors(curve, rgba);
+
+    sf::VertexArray markers(sf::Triangles);
+    for (size_t i = 0; i < curve.x.size(); ++i)
+    {
+        // Transparent colors come from NaN color values
+        if (rgba[i * 4 + 3] == 0)
+            continue;
+        double size = curve.sizes.empty() ? curve.style.symbol_size : curve.sizes[i];
+        if (!(size > 0))
+            continue;
+        sf::Color color(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2], rgba[i * 4 + 3]);
+        append_marker(markers, to_screen(fig, curve.x[i], curve.y[i], w, h), curve.style.symbol_type, size, color);
     }
+    texture->draw(markers);
+}
 
-    // Number of major divisions
-    const int numTicksX = 5;
-    const int numTicksY = 5;
+void PlotGen::draw_density(const Figure &fig, const Figure::Curve &curve, double w, double h)
+{
+    if (curve.grid.empty() || curve.grid_w == 0 || curve.grid_h == 0)
+        return;
 
-    // Number of minor subdivisions (between each major line)
-    const int numMinorSubdivisions = 4;
+    std::vector<sf::Uint8> rgba;
+    shade_density(curve, rgba);
 
-    // Draw major grid
-    if (fig.show_major_grid)
-    {
-        sf::VertexArray majorGrid(sf::Lines);
+    sf::Image image;
+    image.create(curve.grid_w, curve.grid_h, rgba.data());
+    sf::Texture grid_texture;
+    if (!grid_texture.loadFromImage(image))
+        return;
 
-        // Major vertical lines
-        for (int i = 0; i <= numTicksX; ++i)
-        {
-            double x = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
-            sf::Vector2f top = to_screen(fig, x, fig.ymin, w, h);
-            sf::Vector2f bottom = to_screen(fig, x, fig.ymax, w, h);
+    // Screen rectangle of the grid extent (not clamped, the limits may have changed since aggregation)
+    double margin = 50.0;
+    double left = margin + (curve.grid_xmin - fig.xmin) / (fig.xmax - fig.xmin) * (w - 2 * margin);
+    double right = margin + (curve.grid_xmax - fig.xmin) / (fig.xmax - fig.xmin) * (w - 2 * margin);
+    double top = h - margin - (curve.grid_ymax - fig.ymin) / (fig.ymax - fig.ymin) * (h - 2 * margin);
+    double bottom = h - margin - (curve.grid_ymin - fig.ymin) / (fig.ymax - fig.ymin) * (h - 2 * margin);
+
+    // Crop to the plot area
+    double vis_left = std::max(left, margin);
+    double vis_right = std::min(right, w - margin);
+    double vis_top = std::max(top, margin);
+    double vis_bottom = std::min(bottom, h - margin);
+    if (vis_right <= vis_left || vis_bottom <= vis_top)
+        return;
 
-            majorGrid.append(sf::Vertex(top, fig.major_grid_color));
-            majorGrid.append(sf::Vertex(bottom, fig.major_grid_color));
-        }
+    double texels_x = curve.grid_w / (right - left);
+    double texels_y = curve.grid_h / (bottom - top);
 
-        // Major horizontal lines
-        for (int i = 0; i <= numTicksY; ++i)
-        {
-            double y = fig.ymin + (fig.ymax - fig.ymin) * i / numTicksY;
-            sf::Vector2f left = to_screen(fig, fig.xmin, y, w, h);
-            sf::Vector2f right = to_screen(fig, fig.xmax, y, w, h);
+    sf::Vertex quad[4];
+    quad[0] = sf::Vertex(sf::Vector2f(vis_left, vis_top), sf::Vector2f((vis_left - left) * texels_x, (vis_top - top) * texels_y));
+    quad[1] = sf::Vertex(sf::Vector2f(vis_right, vis_top), sf::Vector2f((vis_right - left) * texels_x, (vis_top - top) * texels_y));
+    quad[2] = sf::Vertex(sf::Vector2f(vis_right, vis_bottom), sf::Vector2f((vis_right - left) * texels_x, (vis_bottom - top) * texels_y));
+    quad[3] = sf::Vertex(sf::Vector2f(vis_left, vis_bottom), sf::Vector2f((vis_left - left) * texels_x, (vis_bottom - top) * texels_y));
 
-            majorGrid.append(sf::Vertex(left, fig.major_grid_color));
-            majorGrid.append(sf::Vertex(right, fig.major_grid_color));
-        }
+    sf::RenderStates states;
+    states.texture = &grid_texture;
+    texture->draw(quad, 4, sf::Quads, states);
+}
 
-        texture.draw(majorGrid);
-    }
+// Normalize the aggregation grid and map it to RGBA pixels through the colormap of the curve
+// (empty cells stay transparent)
+void PlotGen::shade_density(const Figure::Curve &curve, std::vector<sf::Uint8> &rgba)
+{
+    const size_t cells = curve.grid.size();
+    rgba.assign(cells * 4, 0);
 
-    // Draw minor grid
-    if (fig.show_minor_grid)
+    std::vector<double> filled;
+    filled.reserve(cells);
+    for (double v : curve.grid)
     {
-        sf::VertexArray minorGrid(sf::Lines);
+        if (!std::isnan(v))
+            filled.push_back(v);
+    }
+    if (filled.empty())
+        return;
 
-        // Minor vertical lines
-        for (int i = 0; i < numTicksX; ++i)
+    auto range = std::minmax_element(filled.begin(), filled.end());
+    // Counts start at zero, means use the observed range
+    double lo = curve.aggregation == "count" ? 0.0 : *range.first;
+    double hi = *range.second;
+    double span = hi - lo > 1e-12 ? hi - lo : 1.0;
+
+    // Normalized values in [0, 1], NaN for empty cells (NaN stays NaN through each formula).
+    // The mode is resolved once, each loop has no branch per cell.
+    std::vector<double> normalized(cells);
+    const double *grid = curve.grid.data();
+    if (curve.normalization == "log")
+    {
+        const double scale = 1.0 / std::log1p(span);
+        for (size_t c = 0; c < cells; ++c)
+            normalized[c] = std::log1p(grid[c] - lo) * scale;
+    }
+    else if (curve.normalization == "eq_hist")
+    {
+        // Rank of the value among the filled cells
+        std::sort(filled.begin(), filled.end());
+        const double scale = 1.0 / filled.size();
+        for (size_t c = 0; c < cells; ++c)
         {
-            double x_start = fig.xmin + (fig.xmax - fig.xmin) * i / numTicksX;
-            double x_step = (fig.xmax - fig.xmin) / (numTicksX * numMinorSubdivisions);
-
-            for (int j = 1; j < numMinorSubdivisions; ++j)
-            {
-                double x = x_start + j * x_step;
-                sf::Vector2f top = to_screen(fig, x, fig.ymin, w, h);
-                sf::Vector2f bottom = to_screen(fig, x, fig.ymax, w, h);
-
-                minorGrid.append(sf::Vertex(top, fig.minor_grid_color));
-                minorGrid.append(sf::Vertex(bottom, fig.minor_grid_color));
-            }
+            double v = grid[c];
+            normalized[c] = std::isnan(v) ? v : (std::upper_bound(filled.begin(), filled.end(), v) - filled.begin()) * scale;
         }
+    }
+    else
+    {
+        const double scale = 1.0 / span;
+        for (size_t c = 0; c < cells; ++c)
+            normalized[c] = (grid[c] - lo) * scale;
+    }
 
-        // Minor horizontal lines
-        for (int i = 0; i < numTicksY; ++i)
-        {
-            double y_start = fig.ymin + (fig.ymax - fig.ymin) * i / numTicksY;
-            double y_step = (fig.ymax - fig.ymin) / (numTicksY * numMinorSubdivisions);
+    map_to_rgba(curve.style.colormap, normalized.data(), cells, 0.0, 1.0, rgba.data());
+}
 
-            for (int j = 1; j < numMinorSubdivisions; ++j)
-            {
-                double y = y_start + j * y_step;
-                sf::Vector2f left = to_screen(fig, fig.xmin, y, w, h);
-                sf::Vector2f right = to_screen(fig, fig.xmax, y, w, h);
+sf::Color PlotGen::getColorFromHeight(double height)
+{
+    // Blue -> cyan -> green -> yellow -> red gradient
+    const sf::Uint8 *lut = colormap_lut("rainbow");
+    double f = std::max(0.0, std::min(1.0, height)) * (COLORMAP_SIZE - 1);
+    const sf::Uint8 *entry = lut + static_cast<size_t>(f + 0.5) * 4;
+    return sf::Color(entry[0], entry[1], entry[2]);
+}
 
-                minorGrid.append(sf::Vertex(left, fig.minor_grid_color));
-                minorGrid.append(sf::Vertex(right, fig.minor_grid_color));
-            }
-        }
+// Lookup table of a colormap
+const sf::Uint8 *PlotGen::colormap_lut(const std::string &name)
+{
+    if (name == "viridis")
+        return viridis_lut.data();
+    if (name == "magma")
+        return magma_lut.data();
+    if (name == "cividis")
+        return cividis_lut.data();
+    if (name == "coolwarm")
+        return coolwarm_lut.data();
+    if (name == "grayscale")
+        return grayscale_lut.data();
+    if (name == "rainbow")
+        return rainbow_lut.data();
+
+    // Names are checked by check_colormap() when they are given, not at each frame
+    return viridis_lut.data();
+}
 
-        texture.draw(minorGrid);
+// Replace an unknown colormap name by the default one, with a warning
+void PlotGen::check_colormap(std::string &name)
+{
+    if (name != "viridis" && name != "magma" && name != "cividis" && name != "coolwarm" && name != "grayscale" &&
+        name != "rainbow")
+    {
+        std::cerr << "WARNING: Unknown colormap '" << name << "'. Using default 'viridis'." << std::endl;
+        name = "viridis";
     }
 }
 
-void PlotGen::draw_polar_grid(const Figure &fig, double w, double h)
+// Map values to RGBA pixels through a colormap
+void PlotGen::map_to_rgba(const std::string &colormap, const double *values, size_t count,
+                          double vmin, double vmax, sf::Uint8 *rgba)
 {
-    // Center of the polar grid
-    sf::Vector2f center = to_screen(fig, 0, 0, w, h);
+    // Packed table with an extra transparent entry for NaN values
+    uint32_t table[COLORMAP_SIZE + 1];
+    std::memcpy(table, colormap_lut(colormap), COLORMAP_SIZE * 4);
+    table[COLORMAP_SIZE] = 0;
 
-    // Maximum radius for circles (in pixels)
-    double max_radius = std::min(w, h) / 2 - 50;
+    const double top = COLORMAP_SIZE - 1;
+    const double scale = vmax != vmin ? top / (vmax - vmin) : 0.0;
 
-    // Maximum radius of data (in units)
-    double max_r = std::max(std::abs(fig.xmax), std::abs(fig.ymax));
+    parallel_chunks(count, 1 << 16, [&](size_t begin, size_t end, unsigned int)
+                    {
+        // Compute a block of indices without branches (vectorizable), then gather from the table
+        const size_t block = 256;
+        uint32_t index[block];
+        for (size_t i = begin; i < end; i += block)
+        {
+            size_t n = std::min(block, end - i);
+            for (size_t k = 0; k < n; ++k)
+            {
+                double v = values[i + k];
+                double f = (v - vmin) * scale;
+                f = f > 0 ? f : 0;
+                f = f < top ? f : top;
+                index[k] = v == v ? static_cast<uint32_t>(f + 0.5) : COLORMAP_SIZE;
+            }
+            for (size_t k = 0; k < n; ++k)
+            {
+                std::memcpy(rgba + (i + k) * 4, &table[index[k]], 4);
+            }
+        } });
+}
 
-    // Number of concentric circles for major grid
-    const int numCircles = 5;
+// Colorbar tick label, 3 significant digits ("%g") so that small ranges such as 0..0.005 keep distinct labels
+std::string PlotGen::format_tick(double value) const
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3g", value);
+    return buffer;
+}
 
-    // Number of rays for major grid (one ray every 30 degrees)
-    const int numRays = 12;
+// Colorbar in the right margin of the figure, the gradient texture is created once per colormap
+void PlotGen::draw_colorbar(const Figure &fig, double w, double h)
+{
+    if (!fig.show_colorbar)
+        return;
 
-    // Draw concentric circles (major grid)
-    if (fig.show_major_grid)
+    auto it = colorbar_textures.find(fig.colorbar_map);
+    if (it == colorbar_textures.end())
     {
-        // Concentric circles
-        for (int i = 1; i <= numCircles; ++i)
+        // One texel per table entry, highest value at the top
+        const sf::Uint8 *lut = colormap_lut(fig.colorbar_map);
+        std::vector<sf::Uint8> pixels(COLORMAP_SIZE * 4);
+        for (unsigned int i = 0; i < COLORMAP_SIZE; ++i)
         {
-            double radius = max_radius * i / numCircles;
-            double r_value = max_r * i / numCircles;
-
-            sf::CircleShape circle(radius);
-            circle.setOrigin(radius, radius);
-            circle.setPosition(center);
-            circle.setFillColor(sf::Color::Transparent);
-            circle.setOutlineColor(fig.major_grid_color);
-            circle.setOutlineThickness(1.0f);
-            texture.draw(circle);
-
-            // Add radius labels with one decimal place
-            sf::Text rLabel;
-            rLabel.setFont(font);
-            rLabel.setCharacterSize(10);
-            rLabel.setFillColor(sf::Color::Black);
-
-            // Format radius value with one decimal place
-            char r_buffer[10];
-            std::snprintf(r_buffer, sizeof(r_buffer), "%.1f", r_value);
-            rLabel.setString(r_buffer);
-
-            sf::FloatRect textRect = rLabel.getLocalBounds();
-            rLabel.setPosition(center.x + radius * std::cos(3.14f / 4) - textRect.width / 2,
-                               center.y - radius * std::sin(3.14f / 4) - textRect.height / 2);
-            texture.draw(rLabel);
+            std::memcpy(&pixels[i * 4], lut + (COLORMAP_SIZE - 1 - i) * 4, 4);
         }
+        sf::Image gradient;
+        gradient.create(1, COLORMAP_SIZE, pixels.data());
+        it = colorbar_textures.emplace(fig.colorbar_map, sf::Texture()).first;
+        it->second.loadFromImage(gradient);
+        it->second.setSmooth(true);
+    }
 
-        // Rays from center
-        sf::VertexArray rays(sf::Lines);
-        for (int i = 0; i < numRays; ++i)
-        {
-            double angle = 2 * M_PI * i / numRays;
-            sf::Vector2f end(center.x + max_radius * std::cos(angle),
-                             center.y - max_radius * std::sin(angle));
-
-            rays.append(sf::Vertex(center, fig.major_grid_color));
-            rays.append(sf::Vertex(end, fig.major_grid_color));
-
-            // Add angle labels (in degrees) with one decimal place
-            sf::Text angleLabel;
-            angleLabel.setFont(font);
-            angleLabel.setCharacterSize(12);
-            angleLabel.setFillColor(sf::Color::Black);
-
-            // Calculate degrees and format with one decimal place
-            double degrees = angle * 180 / M_PI;
-            if (degrees >= 360)
-                degrees -= 360;
-
-            char angle_buffer[15];
-            std::snprintf(angle_buffer, sizeof(angle_buffer), "%.1f°", degrees);
-            angleLabel.setString(sf::String::fromUtf8(angle_buffer, angle_buffer + strlen(angle_buffer)));
+    double margin = 50.0;
+    float left = static_cast<float>(w - margin + 6);
+    float right = left + 10.0f;
+    float top = static_cast<float>(margin);
+    float bottom = static_cast<float>(h - margin);
+
+    sf::Vertex quad[4] = {
+        sf::Vertex(sf::Vector2f(left, top), sf::Vector2f(0.5f, 0.5f)),
+        sf::Vertex(sf::Vector2f(right, top), sf::Vector2f(0.5f, 0.5f)),
+        sf::Vertex(sf::Vector2f(right, bottom), sf::Vector2f(0.5f, COLORMAP_SIZE - 0.5f)),
+        sf::Vertex(sf::Vector2f(left, bottom), sf::Vector2f(0.5f, COLORMAP_SIZE - 0.5f))};
+    sf::RenderStates states;
+    states.texture = &it->second;
+    texture->draw(quad, 4, sf::Quads, states);
+
+    sf::RectangleShape frame(sf::Vector2f(right - left, bottom - top));
+    frame.setPosition(left, top);
+    frame.setFillColor(sf::Color::Transparent);
+    frame.setOutlineColor(sf::Color::Black);
+    frame.setOutlineThickness(1.0f);
+    texture->draw(frame);
+
+    // Ticks
+    const int numTicks = 5;
+    for (int i = 0; i <= numTicks; ++i)
+    {
+        double value = fig.colorbar_min + (fig.colorbar_max - fig.colorbar_min) * i / numTicks;
+        if (std::abs(value) < 1e-9 * std::abs(fig.colorbar_max - fig.colorbar_min))
+            value = 0.0; // "0" rather than "1.39e-17"
+        float y = bottom - (bottom - top) * i / numTicks;
 
-            sf::FloatRect textRect = angleLabel.getLocalBounds();
+        sf::VertexArray tick(sf::Lines, 2);
+        tick[0] = sf::Vertex(sf::Vector2f(right, y), sf::Color::Black);
+        tick[1] = sf::Vertex(sf::Vector2f(right + 3, y), sf::Color::Black);
+        texture->draw(tick);
 
-            // Position the label slightly beyond the end of the ray
-            sf::Vector2f labelPos(center.x + (max_radius + 10) * std::cos(angle) - textRect.width / 2,
-                                  center.y - (max_radius + 10) * std::sin(angle) - textRect.height / 2);
-            angleLabel.setPosition(labelPos);
-            texture.draw(angleLabel);
-        }
-        texture.draw(rays);
+        queue_text(layout_text(format_tick(value), 10), sf::Vector2f(right + 5, y - 7), sf::Color::Black);
     }
 
-    // Draw minor grid
-    if (fig.show_minor_grid)
+    // Label along the right edge
+    if (!fig.colorbar_label.empty())
     {
-        // Minor concentric circles between major ones
-        const int numMinorCircles = 4;
-        for (int i = 0; i < numCircles; ++i)
-        {
-            double radiusStart = max_radius * i / numCircles;
-            double radiusStep = max_radius / numCircles / numMinorCircles;
+        const TextLayout &label = layout_text(fig.colorbar_label, 12);
+        queue_text(label, sf::Vector2f(w - 2, h / 2 - label.bounds.width / 2), sf::Color::Black, 90);
+    }
+}
 
-            for (int j = 1; j < numMinorCircles; ++j)
-            {
-                double radius = radiusStart + j * radiusStep;
+sf::Vector2f PlotGen::to_screen(const Figure &fig, double x, double y, double w, double h) const
+{
+    double margin = 50.0f;
 
-                sf::CircleShape circle(radius);
-                circle.setOrigin(radius, radius);
-                circle.setPosition(center);
-                circle.setFillColor(sf::Color::Transparent);
-                circle.setOutlineColor(fig.minor_grid_color);
-                circle.setOutlineThickness(1.0f);
-                texture.draw(circle);
-            }
-        }
+    // Calculate screen coordinates
+    double sx = margin + (x - fig.xmin) / (fig.xmax - fig.xmin) * (w - 2 * margin);
+    double sy = h - margin - y_fraction(fig, y) * (h - 2 * margin);
 
-        // Minor rays between major ones
-        sf::VertexArray minorRays(sf::Lines);
-        const int numMinorRays = numRays * 2; // One ray every 15 degrees
+    // Ensure points stay within graph boundaries
+    sx = std::max(margin, std::min(w - margin, sx));
+    sy = std::max(margin, std::min(h - margin, sy));
 
-        for (int i = 0; i < numMinorRays; ++i)
-        {
-            // Skip rays that are already in the major grid
-            if (i % 2 == 0)
-                continue;
+    return sf::Vector2f(static_cast<float>(sx), static_cast<float>(sy));
+}
 
-            double angle = 2 * M_PI * i / numMinorRays;
-            sf::Vector2f end(center.x + max_radius * std::cos(angle),
-                             center.y - max_radius * std::sin(angle));
+// Position of y between the y limits of a figure: 0 at ymin, 1 at ymax (in decades with a logarithmic axis)
+double PlotGen::y_fraction(const Figure &fig, double y) const
+{
+    if (fig.log_y)
+    {
+        double lmin = std::log10(fig.ymin);
+        return (std::log10(y) - lmin) / (std::log10(fig.ymax) - lmin);
+    }
+    return (y - fig.ymin) / (fig.ymax - fig.ymin);
+}
 
-            minorRays.append(sf::Vertex(center, fig.minor_grid_color));
-            minorRays.append(sf::Vertex(end, fig.minor_grid_color));
-        }
-        texture.draw(minorRays);
+// Inverse of y_fraction
+double PlotGen::y_from_fraction(const Figure &fig, double t) const
+{
+    if (fig.log_y)
+    {
+        double lmin = std::log10(fig.ymin);
+        return std::pow(10.0, lmin + t * (std::log10(fig.ymax) - lmin));
     }
+    return fig.ymin + t * (fig.ymax - fig.ymin);
 }
 
-void PlotGen::draw_curve(const Figure &fig, const Figure::Curve &curve, double w, double h)
+// Size in pixels of the plotting area (inside the margins) of a figure
+void PlotGen::plot_area_size(const Figure &fig, unsigned int &pixels_x, unsigned int &pixels_y) const
 {
-    if (curve.x.empty() || curve.y.empty())
-        return;
+    double margin = 50.0;
+    double w = static_cast<double>(width) / cols;
+    double h = static_cast<double>(height) / rows;
 
-    // Appliquer l'épaisseur des lignes en utilisant les vertex arrays avec triangles
-    // pour les lignes de plus d'un pixel d'épaisseur
-    float thickness = static_cast<float>(curve.style.thickness);
+    if (fig.is_polar || fig.equal_axes)
+    {
+        w = h = std::min(w, h);
+    }
 
-    // Collecter tous les points pour dessiner les symboles après les lignes
-    std::vector<sf::Vector2f> symbolPoints;
+    pixels_x = static_cast<unsigned int>(std::max(1.0, w - 2 * margin));
+    pixels_y = static_cast<unsigned int>(std::max(1.0, h - 2 * margin));
+}
 
-    // Convertir tous les points de la courbe en coordonnées d'écran
-    for (size_t i = 0; i < curve.x.size(); ++i)
+// Build the LOD pyramid of a curve whose x values are sorted (curves too short to benefit are skipped)
+void PlotGen::build_lod(Figure::Curve &curve)
+{
+    curve.lod.levels.clear();
+    curve.lod.unsorted = false;
+    const size_t base = size_t(1) << LodPyramid::BASE_SHIFT;
+    if (curve.x.size() < 4 * base)
+        return;
+    if (!std::is_sorted(curve.x.begin(), curve.x.end()))
     {
-        symbolPoints.push_back(to_screen(fig, curve.x[i], curve.y[i], w, h));
+        curve.lod.unsorted = true;
+        return;
     }
 
-    if (curve.style.line_style == "solid")
+    curve.lod.levels.emplace_back();
+    update_lod(curve, 0);
+}
+
+// Recompute the buckets covering samples from first_new_sample onwards, at every level.
+// Appending n samples costs O(n / 16 + log(N)).
+void PlotGen::update_lod(Figure::Curve &curve, size_t first_new_sample)
+{
+    auto &levels = curve.lod.levels;
+    const size_t samples = curve.y.size();
+
+    // Level 0 from the samples; the last bucket may have been partial
+    size_t shift = LodPyramid::BASE_SHIFT;
+    size_t first_bucket = first_new_sample >> shift;
+    size_t bucket_count = (samples + (size_t(1) << shift) - 1) >> shift;
+    levels[0].resize(bucket_count);
+    for (size_t b = first_bucket; b < bucket_count; ++b)
     {
-        if (thickness <= 1.0f)
+        size_t begin = b << shift;
+        size_t end = std::min(samples, begin + (size_t(1) << shift));
+        LodPyramid::Bucket bucket = {curve.y[begin], curve.y[end - 1], curve.y[begin], curve.y[begin], begin, begin};
+        for (size_t i = begin + 1; i < end; ++i)
         {
-            // Pour les lignes fines, utiliser LineStrip (plus efficace)
-            sf::VertexArray line(sf::LineStrip);
-            for (size_t i = 0; i < curve.x.size(); ++i)
+            if (curve.y[i] < bucket.ymin)
             {
-                sf::Vector2f position = symbolPoints[i];
-                sf::Vertex point(position, curve.style.color);
-                line.append(point);
+                bucket.ymin = curve.y[i];
+                bucket.imin = i;
             }
-            texture.draw(line);
-        }
-        else
-        {
-            // Pour les lignes épaisses, utiliser des triangles
-            if (curve.x.size() > 1)
+            if (curve.y[i] > bucket.ymax)
             {
-                sf::VertexArray thickLine(sf::Triangles);
-
-                for (size_t i = 0; i < curve.x.size() - 1; ++i)
-                {
-                    sf::Vector2f p1 = symbolPoints[i];
-                    sf::Vector2f p2 = symbolPoints[i + 1];
-
-                    // Calculer le vecteur normalisé perpendiculaire à la ligne
-                    sf::Vector2f direction = p2 - p1;
-                    sf::Vector2f unitDirection;
-                    float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
-
-                    if (length > 0)
-                    {
-                        unitDirection = direction / length;
-                        sf::Vector2f unitPerpendicular(-unitDirection.y, unitDirection.x);
-
-                        // Calculer les points pour former un rectangle (deux triangles)
-                        sf::Vector2f offset = unitPerpendicular * (thickness / 2.0f);
-
-                        sf::Vertex v1(p1 + offset, curve.style.color);
-                        sf::Vertex v2(p2 + offset, curve.style.color);
-                        sf::Vertex v3(p2 - offset, curve.style.color);
-                        sf::Vertex v4(p1 - offset, curve.style.color);
-
-                        // Premier triangle
-                        thickLine.append(v1);
-                        thickLine.append(v2);
-                        thickLine.append(v3);
-
-                        // Second triangle
-                        thickLine.append(v1);
-                        thickLine.append(v3);
-                        thickLine.append(v4);
-                    }
-                }
-
-                texture.draw(thickLine);
+                bucket.ymax = curve.y[i];
+                bucket.imax = i;
             }
         }
+        levels[0][b] = bucket;
     }
-    else if (curve.style.line_style == "dashed")
+
+    // Each higher level merges pairs of buckets of the level below, until a single bucket remains
+    for (size_t k = 1; levels[k - 1].size() > 1; ++k)
     {
-        // Pour les lignes pointillées
-        if (thickness <= 1.0f)
+        if (k == levels.size())
+            levels.emplace_back();
+
+        const auto &below = levels[k - 1];
+        first_bucket >>= 1;
+        bucket_count = (below.size() + 1) / 2;
+        levels[k].resize(bucket_count);
+        for (size_t b = first_bucket; b < bucket_count; ++b)
         {
-            // Lignes fines
-            sf::VertexArray line(sf::Lines);
-            for (size_t i = 0; i < curve.x.size() - 1; i += 2)
+            LodPyramid::Bucket bucket = below[2 * b];
+            if (2 * b + 1 < below.size())
             {
-                if (i + 1 < symbolPoints.size())
+                const LodPyramid::Bucket &right = below[2 * b + 1];
+                bucket.last = right.last;
+                if (right.ymin < bucket.ymin)
                 {
-                    sf::Vector2f p1 = symbolPoints[i];
-                    sf::Vector2f p2 = symbolPoints[i + 1];
-
-                    line.append(sf::Vertex(p1, curve.style.color));
-                    line.append(sf::Vertex(p2, curve.style.color));
+                    bucket.ymin = right.ymin;
+                    bucket.imin = right.imin;
+                }
+                if (right.ymax > bucket.ymax)
+                {
+                    bucket.ymax = right.ymax;
+                    bucket.imax = right.imax;
                 }
             }
-            texture.draw(line);
+            levels[k][b] = bucket;
         }
-        else
-        {
-            // Lignes épaisses pointillées
-            if (curve.x.size() > 1)
-            {
-                sf::VertexArray thickLine(sf::Triangles);
+    }
+}
 
-                for (size_t i = 0; i < curve.x.size() - 1; i += 2)
-                {
-                    if (i + 1 >= symbolPoints.size())
-                        continue;
+// Samples to draw on `pixels` columns for the limits of fig: read from the LOD pyramid, or decimated
+// from the window of a stream or from mapped files. Returns false when the samples of the curve should be used as they are.
+bool PlotGen::visible_samples(const Figure &fig, const Figure::Curve &curve, unsigned int pixels,
+                              std::vector<double> &out_x, std::vector<double> &out_y) const
+{
+    if (curve.stream)
+    {
+        const Stream &stream = *curve.stream;
+        out_x.clear();
+        out_y.clear();
+        if (stream.size > 0)
+            decimate_columns(stream.window_x(), stream.window_y(), stream.size, fig.xmin, fig.xmax, pixels, out_x, out_y);
+        return true;
+    }
+    if (curve.mapped_y)
+    {
+        decimate_mapped(curve.mapped_x.get(), *curve.mapped_y, fig.xmin, fig.xmax, pixels, out_x, out_y);
+        return true;
+    }
+    // Dashes and dots laid over min/max pairs would not follow the curve: only solid lines use the pyramid
+    if (!curve.lod.levels.empty() && curve.style.symbol_type == "none" && curve.style.line_style == "solid")
+    {
+        lod_query(curve, fig.xmin, fig.xmax, pixels, out_x, out_y);
+        return true;
+    }
+    return false;
+}
 
-                    sf::Vector2f p1 = symbolPoints[i];
-                    sf::Vector2f p2 = symbolPoints[i + 1];
+// Keep the first, lowest, highest and last samples of each run of consecutive samples falling
+// in the same pixel column, in their original order. O(count), for data without a LOD pyramid.
+void PlotGen::decimate_columns(const double *x, const double *y, size_t count, double xmin, double xmax, unsigned int pixels,
+                               std::vector<double> &out_x, std::vector<double> &out_y)
+{
+    out_x.clear();
+    out_y.clear();
+    if (count == 0)
+        return;
+    if (count <= 4 * static_cast<size_t>(pixels) || !(xmax > xmin))
+    {
+        out_x.assign(x, x + count);
+        out_y.assign(y, y + count);
+        return;
+    }
 
-                    // Même logique que pour les lignes pleines
-                    sf::Vector2f direction = p2 - p1;
-                    sf::Vector2f unitDirection;
-                    float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+    const double scale = pixels / (xmax - xmin);
+    auto column_of = [&](double value)
+    {
+        double column = std::floor((value - xmin) * scale);
+        return static_cast<long>(std::max(-1.0, std::min(static_cast<double>(pixels), column)));
+    };
 
-                    if (length > 0)
-                    {
-                        unitDirection = direction / length;
-                        sf::Vector2f unitPerpendicular(-unitDirection.y, unitDirection.x);
+    out_x.reserve(4 * pixels + 8);
+    out_y.reserve(4 * pixels + 8);
+    size_t first = 0, imin = 0, imax = 0;
+    auto flush = [&](size_t last)
+    {
+        size_t order[4] = {first, std::min(imin, imax), std::max(imin, imax), last};
+        for (int j = 0; j < 4; ++j)
+        {
+            if (j > 0 && order[j] == order[j - 1])
+                continue;
+            out_x.push_back(x[order[j]]);
+            out_y.push_back(y[order[j]]);
+        }
+    };
 
-                        sf::Vector2f offset = unitPerpendicular * (thickness / 2.0f);
+    long column = column_of(x[0]);
+    for (size_t i = 1; i < count; ++i)
+    {
+        long c = column_of(x[i]);
+        if (c != column)
+        {
+            flush(i - 1);
+            first = imin = imax = i;
+            column = c;
+            continue;
+        }
+        if (y[i] < y[imin])
+            imin = i;
+        if (y[i] > y[imax])
+            imax = i;
+    }
+    flush(count - 1);
+}
 
-                        sf::Vertex v1(p1 + offset, curve.style.color);
-                        sf::Vertex v2(p2 + offset, curve.style.color);
-                        sf::Vertex v3(p2 - offset, curve.style.color);
-                        sf::Vertex v4(p1 - offset, curve.style.color);
+// Same as decimate_columns() for mapped arrays, reading only the visible samples (found by bisection
+// on x) and at most max_reads of them per pixel column, evenly spaced: the cost does not depend on
+// the size of the files, and the extrema are exact once zoomed in enough.
+void PlotGen::decimate_mapped(const MappedArray *x, const MappedArray &y, double xmin, double xmax, unsigned int pixels,
+                              std::vector<double> &out_x, std::vector<double> &out_y)
+{
+    out_x.clear();
+    out_y.clear();
+    const size_t n = y.size();
+    if (n == 0 || !(xmax >= xmin))
+        return;
 
-                        thickLine.append(v1);
-                        thickLine.append(v2);
-                        thickLine.append(v3);
+    auto x_at = [x](size_t i) { return x ? (*x)[i] : static_cast<double>(i); };
+    // First sample with x >= value (strict: x > value)
+    auto bound = [x, n](double value, bool strict) -> size_t
+    {
+        if (!x)
+        {
+            if (value < 0)
+                return 0;
+            double first = strict ? std::floor(value) + 1 : std::ceil(value);
+            return first >= static_cast<double>(n) ? n : static_cast<size_t>(first);
+        }
+        size_t lo = 0, hi = n;
+        while (lo < hi)
+        {
+            size_t mid = lo + (hi - lo) / 2;
+            if (strict ? !((*x)[mid] > value) : (*x)[mid] < value)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        return lo;
+    };
 
-                        thickLine.append(v1);
-                        thickLine.append(v3);
-                        thickLine.append(v4);
-                    }
-                }
+    // Visible samples, plus one on each side so the line reaches the borders
+    size_t i0 = bound(xmin, false);
+    size_t i1 = std::min(n, bound(xmax, true) + 1);
+    i0 = i0 > 0 ? i0 - 1 : 0;
+    if (i1 <= i0)
+        return;
 
-                texture.draw(thickLine);
-            }
-        }
-    }
-    else if (curve.style.line_style == "points")
-    { // points
-        sf::VertexArray line(sf::Points);
-        for (const auto &position : symbolPoints)
+    if (i1 - i0 <= 4 * static_cast<size_t>(pixels) || pixels == 0)
+    {
+        out_x.reserve(i1 - i0);
+        out_y.reserve(i1 - i0);
+        for (size_t i = i0; i < i1; ++i)
         {
-            sf::Vertex point(position, curve.style.color);
-            line.append(point);
+            out_x.push_back(x_at(i));
+            out_y.push_back(y[i]);
         }
-        texture.draw(line);
+        return;
     }
 
-    // Dessiner les symboles après avoir dessiné toutes les lignes
-    // pour s'assurer qu'ils sont visibles par-dessus les lignes
-    if (curve.style.symbol_type != "none")
+    const size_t max_reads = 512;
+    out_x.reserve(4 * pixels + 8);
+    out_y.reserve(4 * pixels + 8);
+    size_t begin = i0;
+    for (unsigned int c = 0; c < pixels; ++c)
     {
-        for (const auto &position : symbolPoints)
+        size_t end = c + 1 == pixels ? i1 : std::max(begin, bound(xmin + (xmax - xmin) * (c + 1) / pixels, false));
+        if (end <= begin)
+            continue;
+
+        const size_t last = end - 1;
+        const size_t step = std::max<size_t>(1, (end - begin) / max_reads);
+        size_t imin = begin, imax = begin;
+        double ymin = y[begin], ymax = ymin;
+        for (size_t i = begin; i < end; i += step)
+        {
+            double value = y[i];
+            if (value < ymin)
+            {
+                ymin = value;
+                imin = i;
+            }
+            if (value > ymax)
+            {
+                ymax = value;
+                imax = i;
+            }
+        }
+        double ylast = y[last];
+        if (ylast < ymin)
+            imin = last;
+        if (ylast > ymax)
+            imax = last;
+
+        size_t order[4] = {begin, std::min(imin, imax), std::max(imin, imax), last};
+        for (int j = 0; j < 4; ++j)
         {
-            draw_symbol(position, curve.style.symbol_type, curve.style.symbol_size, curve.style.color);
+            if (j > 0 && order[j] == order[j - 1])
+                continue;
+            out_x.push_back(x_at(order[j]));
+            out_y.push_back(y[order[j]]);
         }
+        begin = end;
     }
 }
 
-void PlotGen::draw_histogram(const Figure &fig, const Figure::Curve &curve, double w, double h)
+// Points to draw for the x range [xmin, xmax] over a number of pixel columns: for every column,
+// the first, lowest, highest and last samples, read from the coarsest level with buckets no
+// wider than a column
+void PlotGen::lod_query(const Figure::Curve &curve, double xmin, double xmax, unsigned int pixels,
+                        std::vector<double> &out_x, std::vector<double> &out_y) const
 {
-    if (curve.x.empty() || curve.y.empty())
+    out_x.clear();
+    out_y.clear();
+
+    // Visible samples, plus one on each side so the line reaches the borders
+    size_t i0 = std::lower_bound(curve.x.begin(), curve.x.end(), xmin) - curve.x.begin();
+    size_t i1 = std::upper_bound(curve.x.begin(), curve.x.end(), xmax) - curve.x.begin();
+    i0 = i0 > 0 ? i0 - 1 : 0;
+    i1 = std::min(curve.x.size(), i1 + 1);
+    if (i1 <= i0)
         return;
 
-    double maxY = *std::max_element(curve.y.begin(), curve.y.end());
-    if (maxY <= 0)
-        maxY = 1.0f; // Avoid division by zero
+    size_t count = i1 - i0;
+    size_t samples_per_pixel = count / std::max(1u, pixels);
+    const auto &levels = curve.lod.levels;
 
-    // Calculate bin width based on data
-    double bin_width = 0;
-    if (curve.x.size() > 1)
+    size_t level = levels.size();
+    for (size_t k = 0; k < levels.size(); ++k)
     {
-        bin_width = curve.x[1] - curve.x[0];
+        if ((size_t(1) << (LodPyramid::BASE_SHIFT + k)) <= samples_per_pixel)
+            level = k;
     }
-    else
+
+    if (level == levels.size() || count <= 4 * static_cast<size_t>(pixels))
     {
-        bin_width = (fig.xmax - fig.xmin) / 20.0f;
+        // Few samples per pixel: use them directly
+        out_x.assign(curve.x.begin() + i0, curve.x.begin() + i1);
+        out_y.assign(curve.y.begin() + i0, curve.y.begin() + i1);
+        return;
     }
 
-    // Calculate bar width to properly fill the space
-    double bar_width = bin_width * w / (fig.xmax - fig.xmin);
+    const size_t shift = LodPyramid::BASE_SHIFT + level;
+    const auto &buckets = levels[level];
+    const double scale = pixels / (xmax - xmin);
 
-    // Ensure bars aren't too wide
-    bar_width *= curve.bar_width_ratio; // Use custom width ratio
+    out_x.reserve(4 * pixels + 4);
+    out_y.reserve(4 * pixels + 4);
 
-    for (size_t i = 0; i < curve.x.size(); ++i)
+    // Emit the samples of a column in index order, without duplicates
+    auto flush = [&](const LodPyramid::Bucket &column, size_t first, size_t last)
     {
-        sf::RectangleShape bar;
-        double bar_height = curve.y[i] * (h - 100) / (fig.ymax - fig.ymin); // Adjust for margins
+        size_t order[4] = {first, std::min(column.imin, column.imax), std::max(column.imin, column.imax), last};
+        for (int j = 0; j < 4; ++j)
+        {
+            if (j > 0 && order[j] == order[j - 1])
+                continue;
+            out_x.push_back(curve.x[order[j]]);
+            out_y.push_back(curve.y[order[j]]);
+        }
+    };
 
-        // Correct bar position, centered on x value
-        sf::Vector2f position = to_screen(fig, curve.x[i], 0, w, h);
-        position.x -= bar_width / 2; // Center bar on x value
+    LodPyramid::Bucket column = buckets[i0 >> shift];
+    size_t column_first = std::min(curve.x.size() - 1, (i0 >> shift) << shift);
+    size_t column_last = std::min(curve.x.size() - 1, (((i0 >> shift) + 1) << shift) - 1);
+    long current = static_cast<long>(std::floor((curve.x[column_first] - xmin) * scale));
 
-        bar.setSize(sf::Vector2f(bar_width, -bar_height)); // negative to draw upward
-        bar.setPosition(position);
-        bar.setFillColor(curve.style.color);
-        bar.setOutlineColor(sf::Color::Black);
-        bar.setOutlineThickness(1.0f);
+    for (size_t b = (i0 >> shift) + 1; b <= ((i1 - 1) >> shift); ++b)
+    {
+        const LodPyramid::Bucket &bucket = buckets[b];
+        size_t first = b << shift;
+        size_t last = std::min(curve.x.size() - 1, first + (size_t(1) << shift) - 1);
+        long pixel = static_cast<long>(std::floor((curve.x[first] - xmin) * scale));
 
-        texture.draw(bar);
+        if (pixel != current)
+        {
+            flush(column, column_first, column_last);
+            column = bucket;
+            column_first = first;
+            current = pixel;
+        }
+        else
+        {
+            if (bucket.ymin < column.ymin)
+            {
+                column.ymin = bucket.ymin;
+                column.imin = bucket.imin;
+            }
+            if (bucket.ymax > column.ymax)
+            {
+                column.ymax = bucket.ymax;
+                column.imax = bucket.imax;
+            }
+        }
+        column_last = last;
     }
+    flush(column, column_first, column_last);
 }
 
-sf::Color PlotGen::getColorFromHeight(double height)
+// Nearest sample of a curve with sorted x, descending the block pyramid of a pick index from a block of
+// the given level: blocks whose x and y ranges are farther than the best distance are skipped, so only
+// the few blocks around the query point are scanned (same units as kd_nearest)
+void PlotGen::sorted_nearest(const std::vector<double> &x, const std::vector<double> &y, const PickIndex::Entry &entry,
+                             size_t level, size_t block, double px, double py, double sx, double sy, bool log_y,
+                             double &best_distance, size_t &best_sample)
 {
-    // Create a color gradient blue->cyan->green->yellow->red
-    if (height < 0.25f)
+    const unsigned int shift = PickIndex::Entry::BASE_SHIFT + static_cast<unsigned int>(level);
+    const size_t lo = block << shift;
+    const size_t hi = std::min(x.size(), (block + 1) << shift);
+
+    // Distance from the query point to the bounding box of the block
+    const std::pair<double, double> &range = entry.y_ranges[level][block];
+    if (range.first > range.second)
+        return; // No finite sample
+    double dx = px < x[lo] ? (x[lo] - px) * sx : (px > x[hi - 1] ? (px - x[hi - 1]) * sx : 0.0);
+    double ymin = range.first, ymax = range.second;
+    if (log_y)
+    {
+        ymin = ymin > 0 ? std::log10(ymin) : -std::numeric_limits<double>::infinity();
+        ymax = ymax > 0 ? std::log10(ymax) : -std::numeric_limits<double>::infinity();
+    }
+    double dy = py < ymin ? (ymin - py) * sy : (py > ymax ? (py - ymax) * sy : 0.0);
+    if (!(dx * dx + dy * dy < best_distance))
+        return;
+
+    if (level == 0)
     {
-        // Blue to cyan
-        return sf::Color(0, static_cast<sf::Uint8>(255 * height * 4), 255);
+        for (size_t i = lo; i < hi; ++i)
+        {
+            double sample_dx = (x[i] - px) * sx;
+            double sample_dy = ((log_y ? std::log10(y[i]) : y[i]) - py) * sy;
+            double distance = sample_dx * sample_dx + sample_dy * sample_dy;
+            if (distance < best_distance)
+            {
+                best_distance = distance;
+                best_sample = i;
+            }
+        }
+        return;
     }
-    else if (height < 0.5f)
+
+    // Children, the one on the side of the query point first
+    size_t left = 2 * block, right = 2 * block + 1;
+    bool has_right = right < entry.y_ranges[level - 1].size();
+    if (has_right && px >= x[right << (shift - 1)])
+        std::swap(left, right);
+    sorted_nearest(x, y, entry, level - 1, left, px, py, sx, sy, log_y, best_distance, best_sample);
+    if (has_right)
+        sorted_nearest(x, y, entry, level - 1, right, px, py, sx, sy, log_y, best_distance, best_sample);
+}
+
+// Order the sample indices of [lo, hi) as an implicit k-d tree: the median along the axis is
+// stored in the middle of the range, the lower half before it and the upper half after it
+void PlotGen::kd_build(const std::vector<double> &x, const std::vector<double> &y, std::vector<size_t> &order,
+                       size_t lo, size_t hi, int axis)
+{
+    if (hi - lo <= 1)
+        return;
+
+    const std::vector<double> &key = axis == 0 ? x : y;
+    size_t mid = lo + (hi - lo) / 2;
+    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi,
+                     [&key](size_t a, size_t b)
+                     { return key[a] < key[b]; });
+    kd_build(x, y, order, lo, mid, 1 - axis);
+    kd_build(x, y, order, mid + 1, hi, 1 - axis);
+}
+
+// Nearest sample of an implicit k-d tree, with distances in pixels (sx, sy: pixels per data unit,
+// or per decade for y with log_y, py being then log10 of the query y)
+void PlotGen::kd_nearest(const std::vector<double> &x, const std::vector<double> &y, const std::vector<size_t> &order,
+                         size_t lo, size_t hi, int axis, double px, double py, double sx, double sy, bool log_y,
+                         double &best_distance, size_t &best_sample)
+{
+    if (hi <= lo)
+        return;
+
+    size_t mid = lo + (hi - lo) / 2;
+    size_t i = order[mid];
+    double dx = (x[i] - px) * sx;
+    double dy = ((log_y ? std::log10(y[i]) : y[i]) - py) * sy;
+    double distance = dx * dx + dy * dy;
+    if (distance < best_distance)
     {
-        // Cyan to green
-        return sf::Color(0, 255, static_cast<sf::Uint8>(255 * (1 - (height - 0.25f) * 4)));
+        best_distance = distance;
+        best_sample = i;
     }
-    else if (height < 0.75f)
+
+    // Visit the side of the query point first, the other side only if the splitting line is close enough
+    double split = axis == 0 ? dx : dy;
+    if (split > 0)
     {
-        // Green to yellow
-        return sf::Color(static_cast<sf::Uint8>(255 * (height - 0.5f) * 4), 255, 0);
+        kd_nearest(x, y, order, lo, mid, 1 - axis, px, py, sx, sy, log_y, best_distance, best_sample);
+        if (split * split < best_distance)
+            kd_nearest(x, y, order, mid + 1, hi, 1 - axis, px, py, sx, sy, log_y, best_distance, best_sample);
     }
     else
     {
-        // Yellow to red
-        return sf::Color(255, static_cast<sf::Uint8>(std::max(0, static_cast<int>(255 * (1 - (height - 0.75f) * 4)))), 0);
+        kd_nearest(x, y, order, mid + 1, hi, 1 - axis, px, py, sx, sy, log_y, best_distance, best_sample);
+        if (split * split < best_distance)
+            kd_nearest(x, y, order, lo, mid, 1 - axis, px, py, sx, sy, log_y, best_distance, best_sample);
     }
 }
 
-sf::Vector2f PlotGen::to_screen(const Figure &fig, double x, double y, double w, double h) const
+// Index the pickable curves of a figure: curves with sorted x values get a pyramid of the y ranges
+// of blocks of consecutive samples, the others a k-d tree over their finite samples
+void PlotGen::build_pick_index(const Figure &fig, PickIndex &index) const
 {
-    double margin = 50.0f;
+    index.entries.clear();
+    for (size_t c = 0; c < fig.curves.size() && c < fig.curve_types.size(); ++c)
+    {
+        const std::string &type = fig.curve_types[c];
+        const Figure::Curve &curve = fig.curves[c];
+        if ((type != "2D" && type != "POLAR" && type != "SCATTER") || curve.x.empty() || curve.x.size() != curve.y.size())
+            continue;
+
+        PickIndex::Entry entry;
+        entry.curve = c;
+        entry.sorted_x = std::is_sorted(curve.x.begin(), curve.x.end());
+        if (entry.sorted_x)
+        {
+            const size_t n = curve.x.size();
+            const size_t block = size_t(1) << PickIndex::Entry::BASE_SHIFT;
+            std::vector<std::pair<double, double>> level((n + block - 1) / block,
+                                                         {std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity()});
+            for (size_t i = 0; i < n; ++i)
+            {
+                if (!std::isfinite(curve.y[i]))
+                    continue;
+                auto &range = level[i >> PickIndex::Entry::BASE_SHIFT];
+                range.first = std::min(range.first, curve.y[i]);
+                range.second = std::max(range.second, curve.y[i]);
+            }
+            entry.y_ranges.push_back(std::move(level));
+            while (entry.y_ranges.back().size() > 1)
+            {
+                const auto &below = entry.y_ranges.back();
+                std::vector<std::pair<double, double>> above((below.size() + 1) / 2);
+                for (size_t j = 0; j < above.size(); ++j)
+                {
+                    above[j] = below[2 * j];
+                    if (2 * j + 1 < below.size())
+                    {
+                        above[j].first = std::min(above[j].first, below[2 * j + 1].first);
+                        above[j].second = std::max(above[j].second, below[2 * j + 1].second);
+                    }
+                }
+                entry.y_ranges.push_back(std::move(above));
+            }
+        }
+        else
+        {
+            entry.kd.reserve(curve.x.size());
+            for (size_t i = 0; i < curve.x.size(); ++i)
+            {
+                if (std::isfinite(curve.x[i]) && std::isfinite(curve.y[i]))
+                    entry.kd.push_back(i);
+            }
+            kd_build(curve.x, curve.y, entry.kd, 0, entry.kd.size(), 0);
+        }
+        index.entries.push_back(std::move(entry));
+    }
+}
 
-    // Calculate screen coordinates
-    double sx = margin + (x - fig.xmin) / (fig.xmax - fig.xmin) * (w - 2 * margin);
-    double sy = h - margin - (y - fig.ymin) / (fig.ymax - fig.ymin) * (h - 2 * margin);
+// Sample closest to the data point (x, y) within max_pixels on screen, over all indexed curves
+bool PlotGen::pick(const Figure &fig, const PickIndex &index, double x, double y, double w, double h, double max_pixels,
+                   size_t &curve_index, size_t &sample) const
+{
+    double margin = 50.0;
+    double sx = (w - 2 * margin) / (fig.xmax - fig.xmin);
+    // Vertical distances are measured in decades on a logarithmic axis
+    double sy = (h - 2 * margin) / (fig.log_y ? std::log10(fig.ymax) - std::log10(fig.ymin) : fig.ymax - fig.ymin);
+    double py = fig.log_y ? std::log10(y) : y;
+    double best_distance = max_pixels * max_pixels;
+    bool found = false;
+
+    for (const auto &entry : index.entries)
+    {
+        const Figure::Curve &curve = fig.curves[entry.curve];
+        double distance = best_distance;
+        size_t best = 0;
 
-    // Ensure points stay within graph boundaries
-    sx = std::max(margin, std::min(w - margin, sx));
-    sy = std::max(margin, std::min(h - margin, sy));
+        if (entry.sorted_x)
+        {
+            sorted_nearest(curve.x, curve.y, entry, entry.y_ranges.size() - 1, 0, x, py, sx, sy, fig.log_y, distance, best);
+        }
+        else
+        {
+            kd_nearest(curve.x, curve.y, entry.kd, 0, entry.kd.size(), 0, x, py, sx, sy, fig.log_y, distance, best);
+        }
 
-    return sf::Vector2f(static_cast<float>(sx), static_cast<float>(sy));
+        if (distance < best_distance)
+        {
+            best_distance = distance;
+            curve_index = entry.curve;
+            sample = best;
+            found = true;
+        }
+    }
+    return found;
 }
 
-void PlotGen::draw_text(const Figure &fig, double w, double h)
+// Split [0, count) into contiguous chunks processed by up to max_workers threads (0: hardware_concurrency()).
+// The worker index passed to the task is always below that number.
+void PlotGen::parallel_chunks(size_t count, size_t min_chunk, const std::function<void(size_t, size_t, unsigned int)> &task,
+                              unsigned int max_workers)
 {
-    sf::Text text;
-    text.setFont(font);
-    text.setFillColor(sf::Color::Black);
+    if (count == 0)
+        return;
+
+    if (max_workers == 0)
+        max_workers = std::max(1u, std::thread::hardware_concurrency());
+    size_t workers = std::min<size_t>(max_workers, (count + min_chunk - 1) / std::max<size_t>(1, min_chunk));
+    workers = std::max<size_t>(1, workers);
+
+    if (workers == 1)
+    {
+        task(0, count, 0);
+        return;
+    }
+
+    size_t chunk = (count + workers - 1) / workers;
+    std::vector<std::thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t w = 1; w < workers; ++w)
+    {
+        size_t begin = std::min(count, w * chunk);
+        size_t end = std::min(count, begin + chunk);
+        threads.emplace_back(task, begin, end, static_cast<unsigned int>(w));
+    }
+    task(0, std::min(count, chunk), 0);
+
+    for (auto &t : threads)
+        t.join();
+}
 
+void PlotGen::draw_text(const Figure &fig, double w, double h)
+{
     // Titre avec une taille de police réduite
-    text.setCharacterSize(18);
-    text.setString(sf::String::fromUtf8(fig.title.begin(), fig.title.end()));
-    sf::FloatRect textRect = text.getLocalBounds();
+    const TextLayout &title = layout_text(fig.title, 18);
+    sf::FloatRect textRect = title.bounds;
 
     // Positionner le titre en dehors de la zone de dessin
     double margin = 50.0f;
-    text.setPosition(w / 2 - textRect.width / 2, margin / 2 - textRect.height / 2);
-    texture.draw(text);
+    queue_text(title, sf::Vector2f(w / 2 - textRect.width / 2, margin / 2 - textRect.height / 2), sf::Color::Black);
 
     // X label avec police plus petite
-    text.setCharacterSize(14);
-    text.setString(sf::String::fromUtf8(fig.xlabel.begin(), fig.xlabel.end()));
-    textRect = text.getLocalBounds();
-    text.setPosition(w / 2 - textRect.width / 2, h - 20);
-    texture.draw(text);
+    const TextLayout &xlabel = layout_text(fig.xlabel, 14);
+    textRect = xlabel.bounds;
+    queue_text(xlabel, sf::Vector2f(w / 2 - textRect.width / 2, h - 20), sf::Color::Black);
 
     // Y label avec police plus petite
-    text.setCharacterSize(14);
-    text.setString(sf::String::fromUtf8(fig.ylabel.begin(), fig.ylabel.end()));
-    textRect = text.getLocalBounds();
-    text.setRotation(-90);
-    text.setPosition(10, h / 2 + textRect.width / 2);
-    texture.draw(text);
-    text.setRotation(0);
+    const TextLayout &ylabel = layout_text(fig.ylabel, 14);
+    textRect = ylabel.bounds;
+    queue_text(ylabel, sf::Vector2f(10, h / 2 + textRect.width / 2), sf::Color::Black, -90);
 
     // Légende
     if (fig.show_leg && !fig.curves.empty())
@@ -1860,9 +6901,7 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
                 std::vector<std::string> legend_lines;
                 std::string legend_text = curve.style.legend;
 
-                text.setCharacterSize(12);
-                text.setString(sf::String::fromUtf8(legend_text.begin(), legend_text.end()));
-                sf::FloatRect bounds = text.getLocalBounds();
+                sf::FloatRect bounds = layout_text(legend_text, 12).bounds;
 
                 // Couper le texte si trop long
                 if (bounds.width > max_legend_width)
@@ -1909,8 +6948,7 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
                             test_line += " ";
                         test_line += word;
 
-                        text.setString(sf::String::fromUtf8(test_line.begin(), test_line.end()));
-                        bounds = text.getLocalBounds();
+                        bounds = layout_text(test_line, 12).bounds;
 
                         if (bounds.width <= max_legend_width)
                         {
@@ -1946,8 +6984,7 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
                 // Calculer la largeur maximale du contenu
                 for (const auto &line : legend_lines)
                 {
-                    text.setString(sf::String::fromUtf8(line.begin(), line.end()));
-                    double line_width = text.getLocalBounds().width;
+                    double line_width = layout_text(line, 12).bounds.width;
                     max_content_width = std::max(max_content_width, line_width);
                 }
             }
@@ -1989,14 +7026,17 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
                 legend_x = w + padding_x;
                 legend_y = margin + padding_y;
 
+                // Le texte déjà en attente est dessiné avec la vue actuelle
+                flush_text();
+
                 // Ajuster la vue pour que la légende soit visible
-                sf::View current_view = texture.getView();
+                sf::View current_view = canvas_view;
                 sf::FloatRect viewport = current_view.getViewport();
 
                 // Élargir la vue pour inclure la légende
                 viewport.width += legend_width / w;
                 current_view.setViewport(viewport);
-                texture.setView(current_view);
+                set_view(current_view);
             }
             else
             {
@@ -2012,7 +7052,7 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
             legendBg.setFillColor(sf::Color(255, 255, 255, 220));
             legendBg.setOutlineColor(sf::Color::Black);
             legendBg.setOutlineThickness(1.0f);
-            texture.draw(legendBg);
+            texture->draw(legendBg);
 
             // Dessiner les éléments de la légende
             double current_y = legend_y + padding_y;
@@ -2035,7 +7075,7 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
                     sf::RectangleShape line(sf::Vector2f(sample_width, thickness));
                     line.setPosition(start_x, mid_y - thickness / 2);
                     line.setFillColor(curve->style.color);
-                    texture.draw(line);
+                    texture->draw(line);
                 }
                 else if (curve->style.line_style == "dashed")
                 {
@@ -2046,7 +7086,7 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
                         sf::RectangleShape dash(sf::Vector2f(dash_length, thickness));
                         dash.setPosition(start_x + i * 2 * dash_length, mid_y - thickness / 2);
                         dash.setFillColor(curve->style.color);
-                        texture.draw(dash);
+                        texture->draw(dash);
                     }
                 }
 
@@ -2058,13 +7098,10 @@ void PlotGen::draw_text(const Figure &fig, double w, double h)
                 }
 
                 // Texte de la légende
-                text.setCharacterSize(12);
                 float text_y = current_y;
                 for (const auto &line : legend_lines)
                 {
-                    text.setString(sf::String::fromUtf8(line.begin(), line.end()));
-                    text.setPosition(start_x + sample_width + 10, text_y);
-                    texture.draw(text);
+                    queue_text(layout_text(line, 12), sf::Vector2f(start_x + sample_width + 10, text_y), sf::Color::Black);
                     text_y += 16;
                 }
 
@@ -2089,7 +7126,7 @@ void PlotGen::draw_symbol(const sf::Vector2f &position, const std::string &symbo
         circle.setFillColor(color);
         circle.setOutlineColor(sf::Color::Black);
         circle.setOutlineThickness(1.0f);
-        texture.draw(circle);
+        texture->draw(circle);
     }
     else if (symbol_type == "square")
     {
@@ -2099,7 +7136,7 @@ void PlotGen::draw_symbol(const sf::Vector2f &position, const std::string &symbo
         square.setFillColor(color);
         square.setOutlineColor(sf::Color::Black);
         square.setOutlineThickness(1.0f);
-        texture.draw(square);
+        texture->draw(square);
     }
     else if (symbol_type == "triangle")
     {
@@ -2109,7 +7146,7 @@ void PlotGen::draw_symbol(const sf::Vector2f &position, const std::string &symbo
         triangle.setFillColor(color);
         triangle.setOutlineColor(sf::Color::Black);
         triangle.setOutlineThickness(1.0f);
-        texture.draw(triangle);
+        texture->draw(triangle);
     }
     else if (symbol_type == "diamond")
     {
@@ -2120,7 +7157,7 @@ void PlotGen::draw_symbol(const sf::Vector2f &position, const std::string &symbo
         diamond.setFillColor(color);
         diamond.setOutlineColor(sf::Color::Black);
         diamond.setOutlineThickness(1.0f);
-        texture.draw(diamond);
+        texture->draw(diamond);
     }
     else if (symbol_type == "star")
     {
@@ -2145,7 +7182,7 @@ void PlotGen::draw_symbol(const sf::Vector2f &position, const std::string &symbo
             star.setPoint(i, point);
         }
 
-        texture.draw(star);
+        texture->draw(star);
     }
 }
 
@@ -2158,24 +7195,135 @@ void PlotGen::draw_text(const Figure &fig, const Figure::Curve &curve, double w,
     // Get screen position for the text
     sf::Vector2f position = to_screen(fig, curve.x[0], curve.y[0], w, h);
 
-    // Create the text object
-    sf::Text text_obj;
-    text_obj.setFont(font);
-    text_obj.setString(sf::String::fromUtf8(curve.text_content.begin(), curve.text_content.end()));
-    text_obj.setFillColor(curve.style.color);
-
     // Set character size based on style thickness or use default
     unsigned int char_size = curve.style.thickness > 0 ? static_cast<unsigned int>(curve.style.thickness * 6) : 12;
-    text_obj.setCharacterSize(char_size);
 
     // Get text bounds to center it on the position point
-    sf::FloatRect textRect = text_obj.getLocalBounds();
+    const TextLayout &layout = layout_text(curve.text_content, char_size);
+    sf::FloatRect textRect = layout.bounds;
 
     // Position the text with a slight offset to avoid overlapping the exact point
-    text_obj.setPosition(position.x - textRect.width / 2, position.y - textRect.height - 5);
+    queue_text(layout, sf::Vector2f(position.x - textRect.width / 2, position.y - textRect.height - 5), curve.style.color);
+}
+
+// Glyph quads of a string at the origin, laid out like sf::Text once per font, character size
+// and string: rendering the same text again only copies the cached vertices
+const PlotGen::TextLayout &PlotGen::layout_text(const std::string &str, unsigned int size)
+{
+    // The layouts hold texture rectangles of the glyph atlas of one font. Rendering from another
+    // thread uses another font, and the font of a finished thread may be freed and its address
+    // reused: the cache is dropped whenever the font changes
+    const sf::Font &font = get_font();
+    if (&font != layout_font)
+    {
+        text_layouts.clear();
+        layout_font = &font;
+    }
+    auto key = std::make_pair(size, str);
+    auto it = text_layouts.find(key);
+    if (it != text_layouts.end())
+        return it->second;
+
+    // Tick labels change at each pan or zoom: start again rather than grow without bound
+    if (text_layouts.size() >= 4096)
+        text_layouts.clear();
+
+    TextLayout layout;
+    layout.size = size;
+    layout.vertices.setPrimitiveType(sf::Triangles);
+    const sf::String text = sf::String::fromUtf8(str.begin(), str.end());
+    if (text.isEmpty())
+        return text_layouts.emplace(key, std::move(layout)).first->second;
+
+    const float whitespace = font.getGlyph(U' ', size, false).advance;
+    const float line_spacing = font.getLineSpacing(size);
+    const float padding = 1.0f; // Same padding around glyphs as sf::Text
+    float x = 0, y = static_cast<float>(size);
+    float min_x = y, min_y = y, max_x = 0, max_y = 0;
+    sf::Uint32 previous = 0;
+    for (std::size_t i = 0; i < text.getSize(); ++i)
+    {
+        const sf::Uint32 c = text[i];
+        if (c == U'\r')
+            continue;
+        x += font.getKerning(previous, c, size);
+        previous = c;
+
+        if (c == U' ' || c == U'\t' || c == U'\n')
+        {
+            min_x = std::min(min_x, x);
+            min_y = std::min(min_y, y);
+            if (c == U' ')
+                x += whitespace;
+            else if (c == U'\t')
+                x += whitespace * 4;
+            else
+            {
+                y += line_spacing;
+                x = 0;
+            }
+            max_x = std::max(max_x, x);
+            max_y = std::max(max_y, y);
+            continue;
+        }
+
+        const sf::Glyph &glyph = font.getGlyph(c, size, false);
+        const float left = x + glyph.bounds.left - padding;
+        const float top = y + glyph.bounds.top - padding;
+        const float right = x + glyph.bounds.left + glyph.bounds.width + padding;
+        const float bottom = y + glyph.bounds.top + glyph.bounds.height + padding;
+        const float u1 = glyph.textureRect.left - padding;
+        const float v1 = glyph.textureRect.top - padding;
+        const float u2 = glyph.textureRect.left + glyph.textureRect.width + padding;
+        const float v2 = glyph.textureRect.top + glyph.textureRect.height + padding;
+        layout.vertices.append(sf::Vertex(sf::Vector2f(left, top), sf::Color::White, sf::Vector2f(u1, v1)));
+        layout.vertices.append(sf::Vertex(sf::Vector2f(right, top), sf::Color::White, sf::Vector2f(u2, v1)));
+        layout.vertices.append(sf::Vertex(sf::Vector2f(left, bottom), sf::Color::White, sf::Vector2f(u1, v2)));
+        layout.vertices.append(sf::Vertex(sf::Vector2f(left, bottom), sf::Color::White, sf::Vector2f(u1, v2)));
+        layout.vertices.append(sf::Vertex(sf::Vector2f(right, top), sf::Color::White, sf::Vector2f(u2, v1)));
+        layout.vertices.append(sf::Vertex(sf::Vector2f(right, bottom), sf::Color::White, sf::Vector2f(u2, v2)));
+
+        min_x = std::min(min_x, x + glyph.bounds.left);
+        max_x = std::max(max_x, x + glyph.bounds.left + glyph.bounds.width);
+        min_y = std::min(min_y, y + glyph.bounds.top);
+        max_y = std::max(max_y, y + glyph.bounds.top + glyph.bounds.height);
+        x += glyph.advance;
+    }
+    layout.bounds = sf::FloatRect(min_x, min_y, max_x - min_x, max_y - min_y);
+    return text_layouts.emplace(key, std::move(layout)).first->second;
+}
+
+// Add laid out text to the batch of the subplot, drawn by flush_text()
+void PlotGen::queue_text(const TextLayout &layout, const sf::Vector2f &position, const sf::Color &color, float rotation)
+{
+    if (layout.vertices.getVertexCount() == 0)
+        return;
+    sf::Transform transform;
+    transform.translate(position.x, position.y).rotate(rotation);
+    sf::VertexArray &batch = text_batch[layout.size];
+    batch.setPrimitiveType(sf::Triangles);
+    for (std::size_t i = 0; i < layout.vertices.getVertexCount(); ++i)
+    {
+        sf::Vertex vertex = layout.vertices[i];
+        vertex.position = transform.transformPoint(vertex.position);
+        vertex.color = color;
+        batch.append(vertex);
+    }
+}
 
-    // Draw the text
-    texture.draw(text_obj);
+// Draw the queued text: one draw call per character size, each size having its glyph atlas in the font
+void PlotGen::flush_text()
+{
+    const sf::Font &font = get_font();
+    for (auto &entry : text_batch)
+    {
+        if (entry.second.getVertexCount() == 0)
+            continue;
+        sf::RenderStates states;
+        states.texture = &font.getTexture(entry.first);
+        texture->draw(entry.second, states);
+        entry.second.clear(); // Keeps the memory for the next subplot
+    }
 }
 
 // Method for drawing an arrow head
@@ -2231,7 +7379,7 @@ void PlotGen::draw_arrow_head(const Figure &fig, const Figure::Curve &curve, dou
     arrowhead.setOutlineThickness(1.0f);
 
     // Draw the arrowhead
-    texture.draw(arrowhead);
+    texture->draw(arrowhead);
 }
 
 // Cubic Bezier curve with control points (x0,y0), (x1,y1), (x2,y2), (x3,y3)
@@ -2285,7 +7433,7 @@ void PlotGen::bezier(Figure &fig, double x0, double y0, double x1, double y1,
     }
 
     // Store the bezier curve as a 2D curve
-    fig.curves.push_back({x, y, style});
+    fig.curves.push_back(make_curve(x, y, style));
     fig.curve_types.push_back("2D");
 }
 
@@ -2363,7 +7511,7 @@ void PlotGen::bezier(Figure &fig, const std::vector<double> &x, const std::vecto
     }
 
     // Store the bezier curve as a 2D curve
-    fig.curves.push_back({result_x, result_y, style});
+    fig.curves.push_back(make_curve(result_x, result_y, style));
     fig.curve_types.push_back("2D");
 }
 
@@ -2528,7 +7676,7 @@ void PlotGen::spline(Figure &fig, const std::vector<double> &x, const std::vecto
     }
 
     // Store the spline curve as a 2D curve
-    fig.curves.push_back({result_x, result_y, style});
+    fig.curves.push_back(make_curve(result_x, result_y, style));
     fig.curve_types.push_back("2D");
 }
 
@@ -2695,7 +7843,7 @@ void PlotGen::cardinal_spline(Figure &fig, const std::vector<double> &x, const s
     }
 
     // Store the cardinal spline curve as a 2D curve
-    fig.curves.push_back({result_x, result_y, style});
+    fig.curves.push_back(make_curve(result_x, result_y, style));
     fig.curve_types.push_back("2D");
 }
 
@@ -2721,20 +7869,57 @@ std::string PlotGen::line_style_to_svg(const std::string &line_style, float thic
     return ""; // solid line
 }
 
+// Base64 encoding, used to embed raster images in SVG
+std::string PlotGen::base64_encode(const std::vector<unsigned char> &data)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    std::string out;
+    out.reserve((data.size() + 2) / 3 * 4);
+
+    size_t i = 0;
+    for (; i + 2 < data.size(); i += 3)
+    {
+        uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+        out += table[(v >> 18) & 63];
+        out += table[(v >> 12) & 63];
+        out += table[(v >> 6) & 63];
+        out += table[v & 63];
+    }
+    if (i < data.size())
+    {
+        uint32_t v = data[i] << 16;
+        if (i + 1 < data.size())
+            v |= data[i + 1] << 8;
+        out += table[(v >> 18) & 63];
+        out += table[(v >> 12) & 63];
+        out += i + 1 < data.size() ? table[(v >> 6) & 63] : '=';
+        out += '=';
+    }
+    return out;
+}
+
 // Export curve to SVG
-void PlotGen::export_svg_curve(const Figure &fig, const Figure::Curve &curve, std::ofstream &svg_file,
+void PlotGen::export_svg_curve(const Figure &fig, const Figure::Curve &curve, std::ostream &svg_file,
                                double x_offset, double y_offset, double width, double height)
 {
-    // Si c'est une courbe "none" (pas de ligne), ne rien faire ici, les symboles seront ajoutés plus bas
-    if (curve.style.line_style != "none" && curve.style.line_style != "points")
+    // Curves with a LOD pyramid and streams only draw a few samples per pixel column
+    std::vector<double> sampled_x, sampled_y;
+    bool sampled = visible_samples(fig, curve, static_cast<unsigned int>(std::max(1.0, width)), sampled_x, sampled_y);
+    const std::vector<double> &xs = sampled ? sampled_x : curve.x;
+    const std::vector<double> &ys = sampled ? sampled_y : curve.y;
+
+    // Si c'est une courbe "none" (pas de ligne), ne rien faire ici, les symboles seront ajoutés plus bas.
+    // No path either when no sample is visible, "M" alone is not valid path data.
+    if (curve.style.line_style != "none" && curve.style.line_style != "points" && !xs.empty())
     {
         // Path for the line
         svg_file << "<path d=\"M";
 
-        for (size_t i = 0; i < curve.x.size(); ++i)
+        for (size_t i = 0; i < xs.size(); ++i)
         {
-            double sx = x_offset + (curve.x[i] - fig.xmin) / (fig.xmax - fig.xmin) * width;
-            double sy = y_offset + height - (curve.y[i] - fig.ymin) / (fig.ymax - fig.ymin) * height;
+            double sx = x_offset + (xs[i] - fig.xmin) / (fig.xmax - fig.xmin) * width;
+            double sy = y_offset + height - y_fraction(fig, ys[i]) * height;
 
             if (i == 0)
             {
@@ -2768,10 +7953,10 @@ void PlotGen::export_svg_curve(const Figure &fig, const Figure::Curve &curve, st
     // Add symbols if needed
     if (curve.style.symbol_type != "none" && curve.style.symbol_size > 0)
     {
-        for (size_t i = 0; i < curve.x.size(); ++i)
+        for (size_t i = 0; i < xs.size(); ++i)
         {
-            double sx = x_offset + (curve.x[i] - fig.xmin) / (fig.xmax - fig.xmin) * width;
-            double sy = y_offset + height - (curve.y[i] - fig.ymin) / (fig.ymax - fig.ymin) * height;
+            double sx = x_offset + (xs[i] - fig.xmin) / (fig.xmax - fig.xmin) * width;
+            double sy = y_offset + height - y_fraction(fig, ys[i]) * height;
 
             // Draw different symbols based on symbol_type
             if (curve.style.symbol_type == "circle")
@@ -2848,7 +8033,7 @@ void PlotGen::export_svg_curve(const Figure &fig, const Figure::Curve &curve, st
 }
 
 // Export grid to SVG
-void PlotGen::export_svg_grid(const Figure &fig, std::ofstream &svg_file,
+void PlotGen::export_svg_grid(const Figure &fig, std::ostream &svg_file,
                               double x_offset, double y_offset, double width, double height)
 {
     // Draw major grid lines
@@ -2873,8 +8058,8 @@ void PlotGen::export_svg_grid(const Figure &fig, std::ofstream &svg_file,
         // Draw horizontal lines
         for (int i = 0; i <= numTicksY; ++i)
         {
-            double y = fig.ymin + (fig.ymax - fig.ymin) * i / numTicksY;
-            double sy = y_offset + height - (y - fig.ymin) / (fig.ymax - fig.ymin) * height;
+            double y = y_from_fraction(fig, static_cast<double>(i) / numTicksY);
+            double sy = y_offset + height - y_fraction(fig, y) * height;
 
             svg_file << "<line x1=\"" << x_offset << "\" y1=\"" << sy
                      << "\" x2=\"" << (x_offset + width) << "\" y2=\"" << sy
@@ -2914,13 +8099,10 @@ void PlotGen::export_svg_grid(const Figure &fig, std::ofstream &svg_file,
         // Draw minor horizontal lines
         for (int i = 0; i < numMajorY; ++i)
         {
-            double y_start = fig.ymin + (fig.ymax - fig.ymin) * i / numMajorY;
-            double y_step = (fig.ymax - fig.ymin) / (numMajorY * numMinorSubdivisions);
-
             for (int j = 1; j < numMinorSubdivisions; ++j)
             {
-                double y = y_start + j * y_step;
-                double sy = y_offset + height - (y - fig.ymin) / (fig.ymax - fig.ymin) * height;
+                double y = y_from_fraction(fig, (i + static_cast<double>(j) / numMinorSubdivisions) / numMajorY);
+                double sy = y_offset + height - y_fraction(fig, y) * height;
 
                 svg_file << "<line x1=\"" << x_offset << "\" y1=\"" << sy
                          << "\" x2=\"" << (x_offset + width) << "\" y2=\"" << sy
@@ -2932,7 +8114,7 @@ void PlotGen::export_svg_grid(const Figure &fig, std::ofstream &svg_file,
 }
 
 // Export une grille polaire en SVG
-void PlotGen::export_svg_polar_grid(const Figure &fig, std::ofstream &svg_file,
+void PlotGen::export_svg_polar_grid(const Figure &fig, std::ostream &svg_file,
                                     double x_offset, double y_offset, double width, double height)
 {
     // Centre de la grille polaire
@@ -3052,7 +8234,7 @@ void PlotGen::export_svg_polar_grid(const Figure &fig, std::ofstream &svg_file,
 }
 
 // Export histogram to SVG
-void PlotGen::export_svg_histogram(const Figure &fig, const Figure::Curve &curve, std::ofstream &svg_file,
+void PlotGen::export_svg_histogram(const Figure &fig, const Figure::Curve &curve, std::ostream &svg_file,
                                    double x_offset, double y_offset, double width, double height)
 {
     if (curve.x.empty() || curve.y.empty())
@@ -3099,9 +8281,184 @@ void PlotGen::export_svg_histogram(const Figure &fig, const Figure::Curve &curve
     }
 }
 
+// Export scatter curve to SVG: one group, markers as <circle> or references to a shared unit shape
+void PlotGen::export_svg_scatter(const Figure &fig, const Figure::Curve &curve, std::ostream &svg_file,
+                                 double x_offset, double y_offset, double width, double height, unsigned long &svg_ids)
+{
+    if (curve.x.empty() || curve.y.empty())
+        return;
+
+    std::vector<sf::Uint8> rgba;
+    scatter_colors(curve, rgba);
+
+    const std::string &symbol = curve.style.symbol_type;
+    bool circles = symbol != "square" && symbol != "triangle" && symbol != "diamond" && symbol != "star";
+    bool uniform_color = curve.color_values.empty();
+
+    // Marker shapes and clip paths must have unique ids in the document
+    std::string id = "marker" + std::to_string(svg_ids++);
+    std::string clip_id = "clip" + std::to_string(svg_ids++);
+
+    // Markers are clipped to the plot area, as in the window
+    svg_file << "<defs><clipPath id=\"" << clip_id << "\"><rect x=\"" << x_offset << "\" y=\"" << y_offset
+             << "\" width=\"" << width << "\" height=\"" << height << "\"/></clipPath></defs>\n";
+
+    if (!circles)
+    {
+        // Unit shape (size 1), scaled per point
+        std::string path;
+        if (symbol == "square")
+            path = "M-0.5 -0.5 H0.5 V0.5 H-0.5 Z";
+        else if (symbol == "triangle")
+            path = "M0 -0.5 L0.433 0.25 L-0.433 0.25 Z";
+        else if (symbol == "diamond")
+            path = "M0 -0.5 L0.5 0 L0 0.5 L-0.5 0 Z";
+        else
+        {
+            for (int j = 0; j < 10; j++)
+            {
+                double radius = (j % 2 == 0) ? 0.5 : 0.25;
+                double angle = j * M_PI / 5;
+                char buffer[48];
+                std::snprintf(buffer, sizeof(buffer), "%s%.4f %.4f ", j == 0 ? "M" : "L",
+                              radius * std::sin(angle), -radius * std::cos(angle));
+                path += buffer;
+            }
+            path += "Z";
+        }
+        svg_file << "<defs><path id=\"" << id << "\" d=\"" << path << "\" vector-effect=\"non-scaling-stroke\"/></defs>\n";
+    }
+
+    svg_file << "<g clip-path=\"url(#" << clip_id << ")\" stroke=\"black\" stroke-width=\"1\"";
+    if (uniform_color)
+        svg_file << " fill=\"" << color_to_svg(curve.style.color) << "\"";
+    svg_file << ">\n";
+
+    for (size_t i = 0; i < curve.x.size(); ++i)
+    {
+        if (rgba[i * 4 + 3] == 0)
+            continue;
+        double size = curve.sizes.empty() ? curve.style.symbol_size : curve.sizes[i];
+        if (!(size > 0))
+            continue;
+
+        double sx = x_offset + (curve.x[i] - fig.xmin) / (fig.xmax - fig.xmin) * width;
+        double sy = y_offset + height - y_fraction(fig, curve.y[i]) * height;
+
+        if (circles)
+            svg_file << "<circle cx=\"" << sx << "\" cy=\"" << sy << "\" r=\"" << size / 2 << "\"";
+        else
+            svg_file << "<use xlink:href=\"#" << id << "\" transform=\"translate(" << sx << " " << sy << ") scale(" << size << ")\"";
+
+        if (!uniform_color)
+            svg_file << " fill=\"" << color_to_svg(sf::Color(rgba[i * 4], rgba[i * 4 + 1], rgba[i * 4 + 2])) << "\"";
+        svg_file << "/>\n";
+    }
+    svg_file << "</g>\n";
+}
+
+// Export colorbar to SVG as a linear gradient
+void PlotGen::export_svg_colorbar(const Figure &fig, std::ostream &svg_file,
+                                  double x_offset, double y_offset, double width, double height, unsigned long &svg_ids)
+{
+    double left = x_offset + width + 6;
+    double bar_width = 10;
+    double top = y_offset;
+    double bottom = y_offset + height;
+
+    // Gradient ids must be unique in the document
+    std::string id = "colorbar" + std::to_string(svg_ids++);
+
+    const sf::Uint8 *lut = colormap_lut(fig.colorbar_map);
+    const int numStops = 16;
+    svg_file << "<defs><linearGradient id=\"" << id << "\" x1=\"0\" y1=\"1\" x2=\"0\" y2=\"0\">\n";
+    for (int i = 0; i <= numStops; ++i)
+    {
+        const sf::Uint8 *entry = lut + (i * (COLORMAP_SIZE - 1) / numStops) * 4;
+        svg_file << "<stop offset=\"" << static_cast<double>(i) / numStops << "\" stop-color=\""
+                 << color_to_svg(sf::Color(entry[0], entry[1], entry[2])) << "\"/>\n";
+    }
+    svg_file << "</linearGradient></defs>\n";
+
+    svg_file << "<rect x=\"" << left << "\" y=\"" << top << "\" width=\"" << bar_width << "\" height=\"" << (bottom - top)
+             << "\" fill=\"url(#" << id << ")\" stroke=\"black\" stroke-width=\"1\"/>\n";
+
+    const int numTicks = 5;
+    for (int i = 0; i <= numTicks; ++i)
+    {
+        double value = fig.colorbar_min + (fig.colorbar_max - fig.colorbar_min) * i / numTicks;
+        if (std::abs(value) < 1e-9 * std::abs(fig.colorbar_max - fig.colorbar_min))
+            value = 0.0; // "0" rather than "1.39e-17"
+        double y = bottom - (bottom - top) * i / numTicks;
+
+        svg_file << "<line x1=\"" << (left + bar_width) << "\" y1=\"" << y
+                 << "\" x2=\"" << (left + bar_width + 3) << "\" y2=\"" << y
+                 << "\" stroke=\"black\" stroke-width=\"1\"/>\n";
+        svg_file << "<text x=\"" << (left + bar_width + 5) << "\" y=\"" << (y + 4)
+                 << "\" font-family=\"Arial\" font-size=\"10\">" << format_tick(value) << "</text>\n";
+    }
+
+    if (!fig.colorbar_label.empty())
+    {
+        double label_x = width + 2 * x_offset - 6;
+        double label_y = y_offset + height / 2;
+        svg_file << "<text x=\"" << label_x << "\" y=\"" << label_y
+                 << "\" text-anchor=\"middle\" font-family=\"Arial\" font-size=\"12\" "
+                 << "transform=\"rotate(90 " << label_x << "," << label_y << ")\">"
+                 << fig.colorbar_label << "</text>\n";
+    }
+}
+
+// Export density grid to SVG as an embedded PNG image
+void PlotGen::export_svg_density(const Figure &fig, const Figure::Curve &curve, std::ostream &svg_file,
+                                 double x_offset, double y_offset, double width, double height)
+{
+    if (curve.grid.empty() || curve.grid_w == 0 || curve.grid_h == 0)
+        return;
+
+    std::vector<sf::Uint8> rgba;
+    shade_density(curve, rgba);
+
+    std::vector<unsigned char> png;
+    auto append = [](void *context, void *data, int size)
+    {
+        auto *out = static_cast<std::vector<unsigned char> *>(context);
+        out->insert(out->end(), static_cast<unsigned char *>(data), static_cast<unsigned char *>(data) + size);
+    };
+    if (!stbi_write_png_to_func(append, &png, curve.grid_w, curve.grid_h, 4, rgba.data(), curve.grid_w * 4))
+        return;
+
+    // Rectangle of the grid extent in SVG coordinates
+    double left = x_offset + (curve.grid_xmin - fig.xmin) / (fig.xmax - fig.xmin) * width;
+    double right = x_offset + (curve.grid_xmax - fig.xmin) / (fig.xmax - fig.xmin) * width;
+    double top = y_offset + height - (curve.grid_ymax - fig.ymin) / (fig.ymax - fig.ymin) * height;
+    double bottom = y_offset + height - (curve.grid_ymin - fig.ymin) / (fig.ymax - fig.ymin) * height;
+
+    double vis_left = std::max(left, x_offset);
+    double vis_right = std::min(right, x_offset + width);
+    double vis_top = std::max(top, y_offset);
+    double vis_bottom = std::min(bottom, y_offset + height);
+    if (vis_right <= vis_left || vis_bottom <= vis_top)
+        return;
+
+    double texels_x = curve.grid_w / (right - left);
+    double texels_y = curve.grid_h / (bottom - top);
+
+    // The nested <svg> crops the image to the plot area
+    svg_file << "<svg x=\"" << vis_left << "\" y=\"" << vis_top
+             << "\" width=\"" << (vis_right - vis_left) << "\" height=\"" << (vis_bottom - vis_top)
+             << "\" viewBox=\"" << (vis_left - left) * texels_x << " " << (vis_top - top) * texels_y << " "
+             << (vis_right - vis_left) * texels_x << " " << (vis_bottom - vis_top) * texels_y
+             << "\" preserveAspectRatio=\"none\">\n";
+    svg_file << "<image x=\"0\" y=\"0\" width=\"" << curve.grid_w << "\" height=\"" << curve.grid_h
+             << "\" preserveAspectRatio=\"none\" style=\"image-rendering:pixelated\" xlink:href=\"data:image/png;base64,"
+             << base64_encode(png) << "\"/>\n";
+    svg_file << "</svg>\n";
+}
+
 #ifdef HAVE_GTK_WEBKIT
 // Implementation of the HTMLViewer class
-HTMLViewer::HTMLViewer() : window_handle(nullptr), initialized(false), svg_width(800), svg_height(600), current_svg_content(""), temp_svg_file("")
+HTMLViewer::HTMLViewer() : window_handle(nullptr), initialized(false), svg_width(800), svg_height(600), current_svg_content("")
 {
 }
 
@@ -3127,6 +8484,12 @@ bool HTMLViewer::initialize()
 }
 
 bool HTMLViewer::loadAndDisplayHTML(const std::string &html_file)
+{
+    return showWindow(html_file, "");
+}
+
+// Window with the menus and a WebKit view, showing html_file or, if it is empty, the html_content string
+bool HTMLViewer::showWindow(const std::string &html_file, const std::string &html_content)
 {
     if (!initialized && !initialize())
         return false;
@@ -3154,14 +8517,10 @@ bool HTMLViewer::loadAndDisplayHTML(const std::string &html_file)
     struct ViewerData
     {
         std::string svg_content;
-        std::string current_file_path;
-        std::string temp_svg_file; // Path to the temporary SVG file to be deleted
     };
 
     ViewerData *data = new ViewerData();
     data->svg_content = this->current_svg_content;
-    data->current_file_path = html_file;
-    data->temp_svg_file = this->temp_svg_file;
 
     // Create a vertical box to contain the menu and webview
     GtkWidget *vbox = gtk_box_new(GTK_ORIENTATION_VERTICAL, 0);
@@ -3279,26 +8638,10 @@ bool HTMLViewer::loadAndDisplayHTML(const std::string &html_file)
     GtkWidget *webview = webkit_web_view_new();
     gtk_box_pack_start(GTK_BOX(vbox), webview, TRUE, TRUE, 0);
 
-    // Connect destroy signal to free data and delete temporary files
+    // Connect destroy signal to free data
     g_signal_connect(window, "destroy", G_CALLBACK(+[](GtkWidget *widget, gpointer user_data) -> void
                                                    {
-                                                       ViewerData *data = static_cast<ViewerData *>(user_data);
-
-                                                       // Delete the temporary SVG file if it exists
-                                                       if (!data->temp_svg_file.empty())
-                                                       {
-                                                           std::remove(data->temp_svg_file.c_str());
-                                                           std::cout << "Temporary file deleted: " << data->temp_svg_file << std::endl;
-                                                       }
-
-                                                       // Also delete the temporary HTML file
-                                                       if (!data->current_file_path.empty() && data->current_file_path.find("/tmp/plotgencpp_") == 0)
-                                                       {
-                                                           std::remove(data->current_file_path.c_str());
-                                                           std::cout << "Temporary HTML file deleted: " << data->current_file_path << std::endl;
-                                                       }
-
-                                                       delete data;
+                                                       delete static_cast<ViewerData *>(user_data);
                                                    }),
                      data);
 
@@ -3323,9 +8666,16 @@ bool HTMLViewer::loadAndDisplayHTML(const std::string &html_file)
                                                    }),
                      nullptr);
 
-    // Load the HTML file
-    std::string uri = "file://" + html_file;
-    webkit_web_view_load_uri(WEBKIT_WEB_VIEW(webview), uri.c_str());
+    // Load the HTML file, or the page given as a string (no file is written)
+    if (html_file.empty())
+    {
+        webkit_web_view_load_html(WEBKIT_WEB_VIEW(webview), html_content.c_str(), nullptr);
+    }
+    else
+    {
+        std::string uri = "file://" + html_file;
+        webkit_web_view_load_uri(WEBKIT_WEB_VIEW(webview), uri.c_str());
+    }
 
     // Store the window pointer
     window_handle = window;
@@ -3340,18 +8690,12 @@ bool HTMLViewer::loadAndDisplayHTML(const std::string &html_file)
     return true;
 }
 
-bool HTMLViewer::loadAndDisplaySVG(const std::string &svg_content, const std::string &temp_svg_file)
+bool HTMLViewer::loadAndDisplaySVG(const std::string &svg_content)
 {
-    // Store the SVG content and temporary file path
+    // Store the SVG content, used by "Save SVG"
     current_svg_content = svg_content;
-    this->temp_svg_file = temp_svg_file;
-
-    // Create a temporary HTML file containing the SVG
-    std::string html_file = createTempHTMLWithSVG(svg_content);
-    if (html_file.empty())
-        return false;
 
-    return loadAndDisplayHTML(html_file);
+    return showWindow("", createHTMLWithSVG(svg_content));
 }
 
 void HTMLViewer::close()
@@ -3363,18 +8707,9 @@ void HTMLViewer::close()
     }
 }
 
-std::string HTMLViewer::createTempHTMLWithSVG(const std::string &svg_content)
+std::string HTMLViewer::createHTMLWithSVG(const std::string &svg_content)
 {
-    // Generate a unique temporary filename
-    std::string temp_filename = "/tmp/plotgencpp_" + std::to_string(time(nullptr)) + ".html";
-
-    // Create the HTML file
-    std::ofstream html_file(temp_filename);
-    if (!html_file.is_open())
-    {
-        std::cerr << "Error: Unable to create temporary HTML file" << std::endl;
-        return "";
-    }
+    std::ostringstream html_file;
 
     // Parse SVG width and height from content
     size_t width_pos = svg_content.find("width=\"");
@@ -3428,32 +8763,15 @@ std::string HTMLViewer::createTempHTMLWithSVG(const std::string &svg_content)
               << "</body>\n"
               << "</html>";
 
-    html_file.close();
-    return temp_filename;
+    return html_file.str();
 }
 
 // Implementation of the PlotGen::show_with_viewer method
 void PlotGen::show_with_viewer()
 {
-    // Generate a unique temporary SVG filename
-    std::string svg_filename = "plot_" + std::to_string(time(nullptr)) + ".svg";
-
-    // Save as SVG
-    save_svg(svg_filename);
-
-    std::cout << "Graph generated in SVG format: " << svg_filename << std::endl;
-
-    // Read the SVG file contents
-    std::ifstream svg_file(svg_filename);
-    if (!svg_file.is_open())
-    {
-        std::cerr << "Error: Unable to open SVG file" << std::endl;
-        return;
-    }
-
-    std::stringstream buffer;
-    buffer << svg_file.rdbuf();
-    svg_file.close();
+    // Generate the SVG in memory, there is no file to write and read back
+    std::ostringstream buffer;
+    save_svg(buffer);
 
     // Initialize the HTML viewer if it doesn't exist yet
     if (!html_viewer)
@@ -3461,7 +8779,7 @@ void PlotGen::show_with_viewer()
         html_viewer = std::make_shared<HTMLViewer>();
     }
 
-    // Display the SVG in the viewer and pass the temporary file path to be deleted on close
-    html_viewer->loadAndDisplaySVG(buffer.str(), svg_filename);
+    // Display the SVG in the viewer
+    html_viewer->loadAndDisplaySVG(buffer.str());
 }
 #endif // HAVE_GTK_WEBKIT
\ No newline at end of file
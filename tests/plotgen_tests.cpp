@@ -0,0 +1,216 @@
+// Checks of the parts of PlotGen that do not need a window or a GPU: the PNG encoder
+// (decoded back with stb_image) and the live streams. Returns the number of failed checks.
+#include "plotgen.h"
+#include <vector>
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <sstream>
+#include <atomic>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+static int failures = 0;
+
+#define CHECK(condition, message)                                                  \
+    do {                                                                           \
+        if (!(condition)) {                                                        \
+            std::cerr << "FAILED: " << message << " (" << #condition << ")" << std::endl; \
+            ++failures;                                                            \
+        }                                                                          \
+    } while (0)
+
+static uint32_t read_u32(const unsigned char* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+static uint32_t crc32(const unsigned char* data, size_t size) {
+    uint32_t crc = 0xffffffffu;
+    for (size_t i = 0; i < size; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k)
+            crc = (crc >> 1) ^ (0xedb88320u & (0u - (crc & 1)));
+    }
+    return ~crc;
+}
+
+static uint32_t adler32(const unsigned char* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < size; ++i) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+// Test image: flat areas, lines, a gradient and noise, so that both matches and literals are coded.
+// With colors > 0, that many exact colors instead, their blue levels blue_step apart.
+static std::vector<sf::Uint8> test_image(unsigned int width, unsigned int height, unsigned int colors,
+                                         unsigned int blue_step = 40) {
+    std::vector<sf::Uint8> rgba(size_t(width) * height * 4);
+    uint32_t seed = 12345;
+    for (unsigned int y = 0; y < height; ++y) {
+        for (unsigned int x = 0; x < width; ++x) {
+            sf::Uint8* p = &rgba[(size_t(y) * width + x) * 4];
+            seed = seed * 1664525u + 1013904223u;
+            if (colors > 0) {
+                // Few exact colors; with a blue step below 8, several of them share a 5-5-5 cell
+                unsigned int c = (x / 7 + y / 5 + (seed >> 28)) % colors;
+                p[0] = static_cast<sf::Uint8>(200 + c);
+                p[1] = static_cast<sf::Uint8>(100 + 2 * c);
+                p[2] = static_cast<sf::Uint8>(c * blue_step);
+            } else if (y % 97 == 0 || x % 131 == 0) {
+                p[0] = 200; p[1] = 200; p[2] = 200;
+            } else if (x < width / 3) {
+                p[0] = 255; p[1] = 255; p[2] = 255;
+            } else if (x < 2 * width / 3) {
+                p[0] = static_cast<sf::Uint8>(x); p[1] = static_cast<sf::Uint8>(y); p[2] = static_cast<sf::Uint8>(x + y);
+            } else {
+                p[0] = static_cast<sf::Uint8>(seed >> 24); p[1] = static_cast<sf::Uint8>(seed >> 16); p[2] = static_cast<sf::Uint8>(seed >> 8);
+            }
+            p[3] = 255;
+        }
+    }
+    return rgba;
+}
+
+// Encode, then check the chunks (CRC), the zlib stream (inflated by stb_image, Adler-32) and the decoded pixels
+static void check_png(const std::vector<sf::Uint8>& rgba, unsigned int width, unsigned int height,
+                      const PlotGen::PngOptions& options, const std::string& name) {
+    std::vector<unsigned char> png;
+    PlotGen::write_png([&png](const unsigned char* data, size_t size) { png.insert(png.end(), data, data + size); },
+                       rgba.data(), width, height, options);
+
+    CHECK(png.size() > 8 && png[0] == 137 && png[1] == 'P', name << ": PNG signature");
+    std::vector<char> zlib_stream;
+    size_t idat_count = 0;
+    for (size_t pos = 8; pos + 12 <= png.size();) {
+        uint32_t length = read_u32(&png[pos]);
+        if (pos + 12 + length > png.size()) {
+            CHECK(false, name << ": chunk beyond the end of the file");
+            break;
+        }
+        const unsigned char* type = &png[pos + 4];
+        CHECK(crc32(type, length + 4) == read_u32(&png[pos + 8 + length]), name << ": CRC of chunk " << std::string(type, type + 4));
+        if (std::string(type, type + 4) == "IDAT") {
+            zlib_stream.insert(zlib_stream.end(), type + 4, type + 4 + length);
+            ++idat_count;
+        }
+        pos += 12 + length;
+    }
+
+    int inflated_size = 0;
+    char* inflated = stbi_zlib_decode_malloc(zlib_stream.data(), static_cast<int>(zlib_stream.size()), &inflated_size);
+    CHECK(inflated != nullptr, name << ": zlib stream inflates");
+    if (inflated) {
+        size_t bytes_per_pixel = options.color_type == "indexed" ? 1 : 3;
+        CHECK(size_t(inflated_size) == height * (width * bytes_per_pixel + 1), name << ": inflated size");
+        const unsigned char* tail = reinterpret_cast<const unsigned char*>(zlib_stream.data()) + zlib_stream.size() - 4;
+        CHECK(adler32(reinterpret_cast<unsigned char*>(inflated), inflated_size) == read_u32(tail), name << ": Adler-32");
+        STBI_FREE(inflated);
+    }
+
+    int w = 0, h = 0, channels = 0;
+    stbi_uc* decoded = stbi_load_from_memory(png.data(), static_cast<int>(png.size()), &w, &h, &channels, 4);
+    CHECK(decoded != nullptr && w == int(width) && h == int(height), name << ": decodes to " << width << "x" << height);
+    if (decoded && w == int(width) && h == int(height)) {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < size_t(width) * height * 4; ++i)
+            mismatches += (i % 4 != 3) && decoded[i] != rgba[i];
+        CHECK(mismatches == 0, name << ": " << mismatches << " wrong bytes");
+    }
+    stbi_image_free(decoded);
+    std::cout << name << ": " << png.size() << " bytes, " << idat_count << " IDAT chunks" << std::endl;
+}
+
+static void test_png_round_trip() {
+    // 8 MB bands: 1500 RGB pixels per row give two bands, each split in up to 4 compressed segments
+    const unsigned int width = 1500, height = 2000;
+    std::vector<sf::Uint8> rgba = test_image(width, height, 0);
+    for (int level : {0, 1, 8}) {
+        for (const char* filter : {"sub-up", "paeth"}) {
+            PlotGen::PngOptions options;
+            options.compression = level;
+            options.filter = filter;
+            options.threads = 4;
+            check_png(rgba, width, height, options, "rgb level " + std::to_string(level) + " " + filter);
+        }
+    }
+
+    // Single thread, adaptive filter, image smaller than a segment
+    PlotGen::PngOptions options;
+    options.filter = "adaptive";
+    options.threads = 1;
+    std::vector<sf::Uint8> small = test_image(37, 23, 0);
+    check_png(small, 37, 23, options, "rgb 37x23 adaptive");
+
+    // Indexed output of an image with few colors is lossless
+    std::vector<sf::Uint8> few = test_image(640, 480, 12);
+    options = PlotGen::PngOptions();
+    options.color_type = "indexed";
+    options.threads = 4;
+    check_png(few, 640, 480, options, "indexed 12 colors");
+
+    // 40 colors in a few 5-5-5 cells (8 per cell, one blue level apart) still fit the palette exactly
+    std::vector<sf::Uint8> shared = test_image(640, 480, 40, 1);
+    check_png(shared, 640, 480, options, "indexed 40 colors sharing cells");
+
+    // More exact colors than the palette holds: the quantized image decodes, but is not compared
+    options.palette_size = 16;
+    std::vector<unsigned char> png;
+    PlotGen::write_png([&png](const unsigned char* data, size_t size) { png.insert(png.end(), data, data + size); },
+                       shared.data(), 640, 480, options);
+    int w = 0, h = 0, channels = 0;
+    stbi_uc* decoded = stbi_load_from_memory(png.data(), static_cast<int>(png.size()), &w, &h, &channels, 4);
+    CHECK(decoded != nullptr && w == 640 && h == 480, "indexed 16 of 40 colors: decodes");
+    stbi_image_free(decoded);
+}
+
+// 1M samples/s into a small ring, drained at 60 fps: no sample is dropped and the
+// limits follow the newest sample
+static void test_stream_rate() {
+    PlotGen plt(400, 300, 1, 1, true);
+    auto& fig = plt.subplot(0, 0);
+    auto stream = plt.stream(fig, 1000);
+
+    const long total = 1000000;
+    std::atomic<bool> done(false);
+    std::thread producer([stream, total, &done]() {
+        auto start = std::chrono::steady_clock::now();
+        for (long sample = 0; sample < total;) {
+            for (int i = 0; i < 1000; ++i, ++sample)
+                stream->push(double(sample), std::sin(sample * 1e-3));
+            std::this_thread::sleep_until(start + std::chrono::microseconds(sample));
+        }
+        done = true;
+    });
+
+    // Each SVG encoding drains the queue, like a frame of the window
+    auto next_frame = std::chrono::steady_clock::now();
+    while (!done) {
+        std::ostringstream svg;
+        plt.encode("svg", svg);
+        next_frame += std::chrono::microseconds(16667);
+        std::this_thread::sleep_until(next_frame);
+    }
+    producer.join();
+    std::ostringstream svg;
+    plt.encode("svg", svg);
+
+    CHECK(stream->dropped() == 0, "stream: " << stream->dropped() << " samples dropped at 1M samples/s");
+    CHECK(fig.xmax >= total - 1, "stream: newest sample shown (xmax " << fig.xmax << ")");
+}
+
+int main() {
+    test_png_round_trip();
+    test_stream_rate();
+    if (failures)
+        std::cerr << failures << " check(s) failed" << std::endl;
+    else
+        std::cout << "All checks passed" << std::endl;
+    return failures == 0 ? 0 : 1;
+}